@@ -0,0 +1,313 @@
+/**
+ * @file Agents.h
+ * @brief Crowd agents on the ECS: goal seeking with separation and alignment, neighbours found through a spatial grid.
+ * @date 2025-07-28
+ * @details CrowdSystem copies the position, velocity and goal of every agent into dense arrays, builds a
+ * SpatialGrid over the positions, then steers the agents in parallel chunks on a JobSystem. Each agent only
+ * reads the copies and writes its own results, so the chunks need no locks and the outcome doesn't depend on
+ * the thread count. The results are written back to the components, also in parallel; the registry isn't
+ * changed structurally during the update, so the concurrent component lookups are safe.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+#include "Components.h"
+#include "Systems.h"
+#include "JobSystem.h"
+
+// Agent components, positions use ecs::Position
+namespace ecs
+{
+    struct Velocity
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    struct Goal
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+    };
+
+    struct Agent
+    {
+        float maxSpeed = 60.0f; // units per second
+        float maxForce = 240.0f; // steering acceleration limit, units per second squared
+    };
+}
+
+/// @brief uniform grid over the bounding box of a point list, rebuilt every frame
+/// @details The points are counting-sorted by cell in row-major order, so a build is two linear passes and
+/// allocates nothing once the vectors have grown. Queries report slots, positions in Order(); the slots of a
+/// row of cells are contiguous, so a caller that copies its per-point data into that order reads a query's
+/// candidates as a few sequential runs. The cell size starts at the minimum and doubles while the box would
+/// need more than about 4 cells per point, which keeps far-flung points from blowing up the grid. Queries
+/// return candidates; the caller checks the distance.
+class SpatialGrid
+{
+public:
+    explicit SpatialGrid(float minCellSize = 16.0f) : m_minCellSize(minCellSize) {}
+
+    float CellSize() const { return m_cellSize; }
+
+    void Build(const std::vector<ecs::Vec2D> &points)
+    {
+        float minX = 0.0f, minY = 0.0f, maxX = 0.0f, maxY = 0.0f;
+        if (!points.empty())
+        {
+            minX = maxX = points[0].x;
+            minY = maxY = points[0].y;
+        }
+        for (const ecs::Vec2D &p : points)
+        {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+        }
+        m_cellSize = m_minCellSize;
+        const double maxCells = 4.0 * static_cast<double>(points.size()) + 64.0;
+        while (static_cast<double>((maxX - minX) / m_cellSize + 1.0f) * ((maxY - minY) / m_cellSize + 1.0f) > maxCells)
+            m_cellSize *= 2.0f;
+        m_inverseCell = 1.0f / m_cellSize;
+        m_originX = minX;
+        m_originY = minY;
+        m_columns = static_cast<int>((maxX - minX) * m_inverseCell) + 1;
+        m_rows = static_cast<int>((maxY - minY) * m_inverseCell) + 1;
+
+        const size_t cells = static_cast<size_t>(m_columns) * static_cast<size_t>(m_rows);
+        m_starts.assign(cells + 1, 0);
+        m_cellOf.resize(points.size());
+        m_entries.resize(points.size());
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            m_cellOf[i] = static_cast<uint32_t>(Row(points[i].y) * m_columns + Column(points[i].x));
+            ++m_starts[m_cellOf[i] + 1];
+        }
+        for (size_t c = 0; c < cells; ++c)
+            m_starts[c + 1] += m_starts[c];
+        for (size_t i = 0; i < points.size(); ++i)
+            m_entries[m_starts[m_cellOf[i]]++] = static_cast<uint32_t>(i);
+        // filling advanced each cell's start to its end, shift them back
+        for (size_t c = cells; c > 0; --c)
+            m_starts[c] = m_starts[c - 1];
+        m_starts[0] = 0;
+    }
+
+    /// @brief point indices sorted by cell, Order()[slot] is the point at a slot
+    const std::vector<uint32_t> &Order() const { return m_entries; }
+
+    /// @brief call fn(slot) for every point in the cells within radius of (x, y), until it returns false
+    template <typename Fn>
+    void ForEachNear(float x, float y, float radius, Fn &&fn) const
+    {
+        const int x0 = Column(x - radius), x1 = Column(x + radius), y0 = Row(y - radius), y1 = Row(y + radius);
+        for (int row = y0; row <= y1; ++row)
+        {
+            const size_t first = static_cast<size_t>(row) * m_columns;
+            for (uint32_t slot = m_starts[first + x0], end = m_starts[first + x1 + 1]; slot < end; ++slot)
+                if (!fn(slot))
+                    return;
+        }
+    }
+
+private:
+    // cell coordinates, clamped so queries reaching past the box read its border cells
+    int Column(float x) const { return std::clamp(static_cast<int>((x - m_originX) * m_inverseCell), 0, m_columns - 1); }
+    int Row(float y) const { return std::clamp(static_cast<int>((y - m_originY) * m_inverseCell), 0, m_rows - 1); }
+
+    float m_minCellSize;
+    float m_cellSize = 0.0f;
+    float m_inverseCell = 0.0f;
+    float m_originX = 0.0f, m_originY = 0.0f; // corner of the bounding box
+    int m_columns = 1, m_rows = 1;
+    std::vector<uint32_t> m_starts;  // first slot of each cell, plus the end
+    std::vector<uint32_t> m_cellOf;  // cell of each point
+    std::vector<uint32_t> m_entries; // point indices sorted by cell
+};
+
+/// @brief tuning of CrowdSystem
+struct CrowdSettings
+{
+    float neighbourRadius = 16.0f;  // agents closer than this separate and align
+    int maxNeighbours = 12;         // neighbours considered per agent, bounds the cost in dense crowds
+    float separationWeight = 2.0f;
+    float alignmentWeight = 0.5f;
+    float seekWeight = 1.0f;
+    float arrivalRadius = 32.0f;    // agents slow down inside this distance of their goal
+    float responsiveness = 4.0f;    // 1 / seconds taken to reach the steered velocity
+};
+
+/// @brief steers every entity with Position, Velocity, Goal and Agent toward its goal while keeping apart from its neighbours
+class CrowdSystem : public ISystem
+{
+public:
+    using Reads = ComponentList<ecs::Goal, ecs::Agent>;
+    using Writes = ComponentList<ecs::Position, ecs::Velocity>;
+
+    const char *Name() const override { return "crowd"; }
+
+    static constexpr size_t CHUNK = 1024; // agents per parallel work item
+
+    explicit CrowdSystem(JobSystem &jobs, const CrowdSettings &settings = {})
+        : m_settings(settings), m_grid(settings.neighbourRadius / 2) { UseJobs(&jobs); }
+
+    bool OnUpdate(entt::registry &registry, float deltaTime) override
+    {
+        Gather(registry);
+        if (m_agents.empty())
+            return false;
+        m_grid.Build(m_points);
+
+        // neighbour data in grid order, so the agents of a cell are read together
+        const size_t count = m_agents.size();
+        const std::vector<uint32_t> &order = m_grid.Order();
+        m_position.resize(count);
+        m_velocity.resize(count);
+        m_nextPosition.resize(count);
+        m_nextVelocity.resize(count);
+        ForEachChunk(count, [&](size_t slot)
+                     {
+            const AgentState &agent = m_agents[order[slot]];
+            m_position[slot] = agent.position;
+            m_velocity[slot] = agent.velocity; });
+
+        ForEachChunk(count, [&](size_t slot)
+                     { Steer(slot, m_agents[order[slot]], deltaTime); });
+
+        auto &positions = registry.storage<ecs::Position>();
+        auto &velocities = registry.storage<ecs::Velocity>();
+        ForEachChunk(count, [&](size_t slot)
+                     {
+            const entt::entity e = m_agents[order[slot]].entity;
+            positions.get(e) = {m_nextPosition[slot].x, m_nextPosition[slot].y};
+            velocities.get(e) = {m_nextVelocity[slot].x, m_nextVelocity[slot].y}; });
+        return true;
+    }
+
+    const CrowdSettings &GetSettings() const { return m_settings; }
+
+private:
+    struct AgentState
+    {
+        entt::entity entity;
+        ecs::Vec2D position;
+        ecs::Vec2D velocity;
+        ecs::Vec2D goal;
+        ecs::Agent agent;
+    };
+
+    /// @brief fn(i) for every i in [0, count), up to CHUNK consecutive indices per job
+    template <typename Fn>
+    void ForEachChunk(size_t count, Fn &&fn)
+    {
+        auto range = [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; ++i)
+                fn(i);
+        };
+        if (m_jobs)
+            m_jobs->ParallelForRange(count, CHUNK, range);
+        else
+            range(0, count);
+    }
+
+    void Gather(entt::registry &registry)
+    {
+        m_agents.clear();
+        m_points.clear();
+        auto view = registry.view<ecs::Position, ecs::Velocity, ecs::Goal, ecs::Agent>();
+        view.each([&](entt::entity e, const ecs::Position &position, const ecs::Velocity &velocity, const ecs::Goal &goal, const ecs::Agent &agent)
+                  {
+            m_agents.push_back({e, {position.x, position.y}, {velocity.x, velocity.y}, {goal.x, goal.y}, agent});
+            m_points.push_back({position.x, position.y}); });
+    }
+
+    /// @brief new velocity and position of the agent at a grid slot, from the gathered state only
+    void Steer(size_t slot, const AgentState &state, float deltaTime)
+    {
+        const ecs::Vec2D p = state.position, v = state.velocity;
+        const ecs::Agent &agent = state.agent;
+        const float radius = m_settings.neighbourRadius, radiusSq = radius * radius;
+
+        ecs::Vec2D separation, alignment;
+        int neighbours = 0;
+        if (m_settings.maxNeighbours > 0)
+            m_grid.ForEachNear(p.x, p.y, radius, [&](uint32_t j)
+                               {
+                const float dx = p.x - m_position[j].x, dy = p.y - m_position[j].y;
+                const float distSq = dx * dx + dy * dy;
+                // about half the candidates are in range, an unpredictable branch, so the range test weighs them by 0 or 1;
+                // the rare coincident agents and the cap still branch
+                const float in = static_cast<float>((distSq < radiusSq) & (j != slot));
+                if (distSq < 1e-6f && j != slot)
+                {
+                    separation.x += j < slot ? 1.0f : -1.0f; // coincident agents are split by slot
+                    return ++neighbours < m_settings.maxNeighbours;
+                }
+                // push away harder the closer the neighbour is, 1/distance falloff
+                const float scale = in / std::max(distSq, 1e-6f);
+                separation.x += dx * scale;
+                separation.y += dy * scale;
+                alignment.x += in * m_velocity[j].x;
+                alignment.y += in * m_velocity[j].y;
+                neighbours += static_cast<int>(in);
+                return neighbours < m_settings.maxNeighbours; });
+
+        // seek the goal, slowing down on arrival
+        ecs::Vec2D force;
+        const float gx = state.goal.x - p.x, gy = state.goal.y - p.y;
+        const float goalDist = std::sqrt(gx * gx + gy * gy);
+        if (goalDist > 1e-3f)
+        {
+            const float speed = agent.maxSpeed * std::min(1.0f, goalDist / m_settings.arrivalRadius);
+            force.x += m_settings.seekWeight * (gx / goalDist * speed - v.x);
+            force.y += m_settings.seekWeight * (gy / goalDist * speed - v.y);
+        }
+        if (neighbours > 0)
+        {
+            force.x += m_settings.separationWeight * agent.maxSpeed * separation.x + m_settings.alignmentWeight * (alignment.x / neighbours - v.x);
+            force.y += m_settings.separationWeight * agent.maxSpeed * separation.y + m_settings.alignmentWeight * (alignment.y / neighbours - v.y);
+        }
+
+        // force is the wanted velocity change, applied over 1/responsiveness seconds and limited like an engine
+        force.x *= m_settings.responsiveness;
+        force.y *= m_settings.responsiveness;
+        Limit(force, agent.maxForce);
+        ecs::Vec2D velocity = {v.x + force.x * deltaTime, v.y + force.y * deltaTime};
+        Limit(velocity, agent.maxSpeed);
+        m_nextVelocity[slot] = velocity;
+        m_nextPosition[slot] = {p.x + velocity.x * deltaTime, p.y + velocity.y * deltaTime};
+    }
+
+    static void Limit(ecs::Vec2D &v, float length)
+    {
+        const float lengthSq = v.x * v.x + v.y * v.y;
+        if (lengthSq > length * length)
+        {
+            const float scale = length / std::sqrt(lengthSq);
+            v.x *= scale;
+            v.y *= scale;
+        }
+    }
+
+    CrowdSettings m_settings;
+    SpatialGrid m_grid;
+
+    std::vector<AgentState> m_agents; // gathered from the view at the start of the update
+    std::vector<ecs::Vec2D> m_points; // positions of m_agents, for building the grid
+
+    // by grid slot
+    std::vector<ecs::Vec2D> m_position;
+    std::vector<ecs::Vec2D> m_velocity;
+    std::vector<ecs::Vec2D> m_nextPosition;
+    std::vector<ecs::Vec2D> m_nextVelocity;
+};
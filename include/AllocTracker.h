@@ -0,0 +1,277 @@
+/**
+ * @file AllocTracker.h
+ * @brief Optional heap allocation counting per frame and per scope, built in with TRACK_ALLOCATIONS.
+ * @date 2025-07-31
+ * @details With TRACK_ALLOCATIONS defined (make TRACK_ALLOCATIONS=TRUE), the global operator new is replaced by
+ * versions that count every allocation and the bytes it asked for. operator delete is replaced only to match
+ * them and just frees: frees aren't counted, so the numbers are allocation traffic, not live memory, and leaks
+ * don't show. An AllocTracker::Scope names the code running on the current thread, so allocations are
+ * attributed to the innermost open scope, or to "other".
+ * ISimulation::Run calls EndFrame() after every frame, which moves the counts into the last-frame report that
+ * the debug overlay draws, and prints a summary when a headless or replayed run ends.
+ *
+ * Without TRACK_ALLOCATIONS every function here is an empty inline, so scopes can stay in the code for free.
+ * The operator replacements are defined where ALLOC_TRACKER_IMPLEMENTATION is defined before the include,
+ * which main.cpp does; the project is a single translation unit.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#include <raylib.h>
+
+/// @brief heap allocations and the bytes they asked for
+struct AllocStats
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+};
+
+// AllocStats that the operators can bump from any thread
+struct AllocCounter
+{
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+class AllocTracker
+{
+public:
+#ifdef TRACK_ALLOCATIONS
+    static constexpr bool ENABLED = true;
+#else
+    static constexpr bool ENABLED = false;
+#endif
+    static constexpr int MAX_SCOPES = 64;
+
+    using Stats = AllocStats;
+
+    /// @brief attributes the allocations of this thread to name until destroyed; name must outlive the program
+    class Scope
+    {
+    public:
+        explicit Scope(const char *name)
+        {
+            if constexpr (ENABLED)
+            {
+                m_previous = t_scope;
+                t_scope = Find(name);
+            }
+        }
+        ~Scope()
+        {
+            if constexpr (ENABLED)
+                t_scope = m_previous;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        int m_previous = 0;
+    };
+
+    /// @brief close the current frame: its counts become the last-frame report and the totals grow
+    static void EndFrame()
+    {
+        if constexpr (!ENABLED)
+            return;
+        Stats frame;
+        const int scopes = s_scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < scopes; ++i)
+        {
+            AllocCounter &counter = s_counters[i];
+            s_lastFrame[i] = {counter.count.exchange(0, std::memory_order_relaxed), counter.bytes.exchange(0, std::memory_order_relaxed)};
+            s_total[i].count += s_lastFrame[i].count;
+            s_total[i].bytes += s_lastFrame[i].bytes;
+            frame.count += s_lastFrame[i].count;
+            frame.bytes += s_lastFrame[i].bytes;
+        }
+        s_lastFrameTotal = frame;
+        ++s_frames;
+        s_peakFrame = std::max(s_peakFrame, frame.count);
+        if (frame.count == 0)
+            ++s_cleanFrames;
+    }
+
+    static Stats LastFrame() { return s_lastFrameTotal; }
+
+    /// @brief allocations made since the last EndFrame(), all scopes
+    static Stats Pending()
+    {
+        Stats pending;
+        const int scopes = s_scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < scopes; ++i)
+        {
+            pending.count += s_counters[i].count.load(std::memory_order_relaxed);
+            pending.bytes += s_counters[i].bytes.load(std::memory_order_relaxed);
+        }
+        return pending;
+    }
+
+    /// @brief per-scope totals of every closed frame, for the headless runner
+    static void PrintSummary(std::ostream &out)
+    {
+        if constexpr (!ENABLED)
+            return;
+        Stats total;
+        const int scopes = s_scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < scopes; ++i)
+        {
+            total.count += s_total[i].count;
+            total.bytes += s_total[i].bytes;
+        }
+        out << "Allocations: " << total.count << " (" << total.bytes << " bytes) over " << s_frames << " frames, "
+            << (s_frames ? static_cast<double>(total.count) / s_frames : 0.0) << " per frame, peak " << s_peakFrame
+            << ", " << s_cleanFrames << " frames without any" << std::endl;
+        for (int i = 0; i < scopes; ++i)
+        {
+            if (s_total[i].count > 0)
+                out << "  " << s_names[i] << ": " << s_total[i].count << " (" << s_total[i].bytes << " bytes)" << std::endl;
+        }
+    }
+
+    /// @brief last frame's allocations, total and per scope that allocated, from (x, y) downward
+    static void DrawOverlay(int x, int y)
+    {
+        if constexpr (!ENABLED)
+            return;
+        constexpr int FONT_SIZE = 10, LINE = 12;
+        DrawText(TextFormat("allocs/frame: %llu (%llu bytes)", static_cast<unsigned long long>(s_lastFrameTotal.count),
+                            static_cast<unsigned long long>(s_lastFrameTotal.bytes)),
+                 x, y, FONT_SIZE, MAROON);
+        const int scopes = s_scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < scopes; ++i)
+        {
+            if (s_lastFrame[i].count == 0)
+                continue;
+            y += LINE;
+            DrawText(TextFormat("  %s: %llu", s_names[i], static_cast<unsigned long long>(s_lastFrame[i].count)), x, y, FONT_SIZE, MAROON);
+        }
+    }
+
+    // called by the replaced operators
+    static void Record(size_t bytes)
+    {
+        AllocCounter &counter = s_counters[t_scope];
+        counter.count.fetch_add(1, std::memory_order_relaxed);
+        counter.bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+private:
+    /// @brief index of the scope called name, registering it on first use; the table is full past MAX_SCOPES and "other" is used
+    static int Find(const char *name)
+    {
+        // fast path: the same string literal was seen before
+        const int scopes = s_scopeCount.load(std::memory_order_acquire);
+        for (int i = 0; i < scopes; ++i)
+        {
+            if (s_names[i] == name)
+                return i;
+        }
+        std::lock_guard lock(s_registerMutex);
+        const int count = s_scopeCount.load(std::memory_order_relaxed);
+        for (int i = 0; i < count; ++i)
+        {
+            if (std::strcmp(s_names[i], name) == 0)
+                return i;
+        }
+        if (count == MAX_SCOPES)
+            return 0;
+        s_names[count] = name;
+        s_scopeCount.store(count + 1, std::memory_order_release);
+        return count;
+    }
+
+    static inline const char *s_names[MAX_SCOPES] = {"other"};
+    static inline std::atomic<int> s_scopeCount{1};
+    static inline std::mutex s_registerMutex;
+    static inline AllocCounter s_counters[MAX_SCOPES];
+    static inline thread_local int t_scope = 0; // innermost open scope of this thread
+
+    // owned by the thread calling EndFrame()
+    static inline Stats s_lastFrame[MAX_SCOPES];
+    static inline Stats s_total[MAX_SCOPES];
+    static inline Stats s_lastFrameTotal;
+    static inline uint64_t s_frames = 0;
+    static inline uint64_t s_peakFrame = 0;
+    static inline uint64_t s_cleanFrames = 0;
+};
+
+#if defined(TRACK_ALLOCATIONS) && defined(ALLOC_TRACKER_IMPLEMENTATION)
+// Replacement allocation functions can't be inline, so they are only compiled into the one file that asks.
+
+namespace AllocTrackerDetail
+{
+    inline void *Allocate(size_t size)
+    {
+        AllocTracker::Record(size);
+        return std::malloc(size ? size : 1);
+    }
+
+    inline void *AllocateAligned(size_t size, size_t alignment)
+    {
+        AllocTracker::Record(size);
+        size = (size + alignment - 1) / alignment * alignment; // aligned_alloc wants a multiple of the alignment
+#ifdef _WIN32
+        return _aligned_malloc(size ? size : alignment, alignment);
+#else
+        return std::aligned_alloc(alignment, size ? size : alignment);
+#endif
+    }
+
+    inline void FreeAligned(void *pointer)
+    {
+#ifdef _WIN32
+        _aligned_free(pointer);
+#else
+        std::free(pointer);
+#endif
+    }
+
+    inline void *AllocateOrThrow(size_t size)
+    {
+        if (void *pointer = Allocate(size))
+            return pointer;
+        throw std::bad_alloc();
+    }
+
+    inline void *AllocateAlignedOrThrow(size_t size, std::align_val_t alignment)
+    {
+        if (void *pointer = AllocateAligned(size, static_cast<size_t>(alignment)))
+            return pointer;
+        throw std::bad_alloc();
+    }
+}
+
+void *operator new(size_t size) { return AllocTrackerDetail::AllocateOrThrow(size); }
+void *operator new[](size_t size) { return AllocTrackerDetail::AllocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return AllocTrackerDetail::Allocate(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return AllocTrackerDetail::Allocate(size); }
+void *operator new(size_t size, std::align_val_t alignment) { return AllocTrackerDetail::AllocateAlignedOrThrow(size, alignment); }
+void *operator new[](size_t size, std::align_val_t alignment) { return AllocTrackerDetail::AllocateAlignedOrThrow(size, alignment); }
+void *operator new(size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return AllocTrackerDetail::AllocateAligned(size, static_cast<size_t>(alignment)); }
+void *operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return AllocTrackerDetail::AllocateAligned(size, static_cast<size_t>(alignment)); }
+
+// not counted, see the file comment
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+void operator delete[](void *pointer) noexcept { std::free(pointer); }
+void operator delete(void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, size_t) noexcept { std::free(pointer); }
+void operator delete(void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept { std::free(pointer); }
+void operator delete(void *pointer, std::align_val_t) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+void operator delete[](void *pointer, std::align_val_t) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+void operator delete(void *pointer, size_t, std::align_val_t) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+void operator delete[](void *pointer, size_t, std::align_val_t) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept { AllocTrackerDetail::FreeAligned(pointer); }
+#endif
@@ -0,0 +1,369 @@
+/**
+ * @file AssetArchive.h
+ * @brief Single-file asset pack: a sorted table of contents over aligned blobs, memory-mapped at runtime.
+ * @date 2025-08-05
+ * @details `game --pack assets assets.pak [--decode]` packs every file under assets/ into one archive. Entries are
+ * named by their path as the code loads it ("assets/owo.png") and sorted, so lookup is a binary search over the
+ * table. Blobs start on ALIGNMENT boundaries. With --decode, images are decoded while packing and stored as raw
+ * pixels, so loading them skips the PNG decoder too.
+ *
+ * At runtime the archive is opened with a single mmap (one read of the whole file on platforms without it) and
+ * textures are built straight from the mapped bytes with LoadImageFromMemory or, for decoded images, an Image
+ * pointing into the mapping. LoadAssetTexture() looks in the mounted archive first and falls back to the loose
+ * file, so a build without an archive keeps working.
+ *
+ * Layout, native byte order: AssetHeader, AssetEntry[count] sorted by name, the names, then the blobs.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ASSET_ARCHIVE_MMAP 1
+#else
+#define ASSET_ARCHIVE_MMAP 0 // windows.h clashes with raylib, the archive is read in one go instead
+#endif
+
+#include <raylib.h>
+
+#include "JobSystem.h"
+#include "Log.h"
+
+struct AssetHeader
+{
+    char magic[4] = {'R', 'P', 'A', 'K'};
+    uint32_t version = 0;
+    uint32_t count = 0;    // entries in the table
+    uint32_t reserved = 0;
+};
+
+struct AssetEntry
+{
+    enum Kind : uint32_t
+    {
+        File = 0,  // the file as it was on disk
+        Pixels = 1 // a decoded image: width, height, mipmaps and format describe the blob
+    };
+
+    uint64_t offset = 0; // blob position in the archive
+    uint64_t size = 0;   // blob bytes
+    uint32_t nameOffset = 0;
+    uint32_t nameSize = 0;
+    uint32_t kind = File;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t mipmaps = 0;
+    int32_t format = 0;
+    uint32_t reserved = 0;
+};
+
+class AssetArchive
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 64; // blob alignment, enough for any pixel format and SIMD reads
+
+    AssetArchive() = default;
+    ~AssetArchive() { Close(); }
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+
+    /// @brief the archive LoadAssetTexture() reads from
+    static AssetArchive &Mounted()
+    {
+        static AssetArchive archive;
+        return archive;
+    }
+
+    /// @brief map an archive and check its table; logs and returns false if it isn't a valid one
+    bool Open(const std::string &path)
+    {
+        Close();
+#if ASSET_ARCHIVE_MMAP
+        const int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0)
+        {
+            Log::Error("Failed to open asset archive: {}", path);
+            return false;
+        }
+        struct stat info;
+        if (::fstat(file, &info) == 0 && info.st_size > 0)
+        {
+            void *mapping = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED)
+            {
+                m_data = static_cast<const unsigned char *>(mapping);
+                m_size = static_cast<size_t>(info.st_size);
+            }
+        }
+        ::close(file); // the mapping stays valid
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (file)
+        {
+            m_buffer.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            if (file.read(reinterpret_cast<char *>(m_buffer.data()), static_cast<std::streamsize>(m_buffer.size())))
+            {
+                m_data = m_buffer.data();
+                m_size = m_buffer.size();
+            }
+        }
+#endif
+        if (!m_data)
+        {
+            Log::Error("Failed to map asset archive: {}", path);
+            return false;
+        }
+        if (!Validate())
+        {
+            Log::Error("Not a valid asset archive (version {}): {}", VERSION, path);
+            Close();
+            return false;
+        }
+        Log::Info("Mounted asset archive {} with {} assets", path, Count());
+        return true;
+    }
+
+    void Close()
+    {
+#if ASSET_ARCHIVE_MMAP
+        if (m_data)
+            ::munmap(const_cast<unsigned char *>(m_data), m_size);
+#else
+        m_buffer = {};
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+
+    bool IsOpen() const { return m_data != nullptr; }
+
+    size_t Count() const { return m_data ? Header().count : 0; }
+    const AssetEntry &Entry(size_t index) const { return Entries()[index]; }
+
+    std::string_view Name(const AssetEntry &entry) const
+    {
+        return {reinterpret_cast<const char *>(m_data) + entry.nameOffset, entry.nameSize};
+    }
+
+    const unsigned char *Data(const AssetEntry &entry) const { return m_data + entry.offset; }
+
+    /// @brief the entry called name, nullptr if the archive has none (or isn't open)
+    const AssetEntry *Find(std::string_view name) const
+    {
+        if (!m_data)
+            return nullptr;
+        const AssetEntry *begin = Entries(), *end = begin + Header().count;
+        const AssetEntry *it = std::lower_bound(begin, end, name, [this](const AssetEntry &entry, std::string_view key)
+                                                { return Name(entry) < key; });
+        return it != end && Name(*it) == name ? it : nullptr;
+    }
+
+    /// @brief upload an entry as a texture, straight from the mapped bytes; id 0 if it isn't an image
+    Texture2D Texture(const AssetEntry &entry) const
+    {
+        Texture2D texture = {0};
+        if (entry.kind == AssetEntry::Pixels)
+        {
+            // points into the mapping, only read by the upload and never unloaded
+            Image image = {const_cast<unsigned char *>(Data(entry)), entry.width, entry.height, entry.mipmaps, entry.format};
+            texture = LoadTextureFromImage(image);
+        }
+        else
+        {
+            const std::string type = std::filesystem::path(Name(entry)).extension().string(); // ".png"
+            Image image = LoadImageFromMemory(type.c_str(), Data(entry), static_cast<int>(entry.size));
+            if (image.data)
+            {
+                texture = LoadTextureFromImage(image);
+                UnloadImage(image);
+            }
+        }
+        return texture;
+    }
+
+    /// @brief write every file under directory into one archive, named by their path relative to its parent
+    /// @param decode store images as decoded pixels instead of their files
+    static bool Pack(const std::string &directory, const std::string &archivePath, bool decode)
+    {
+        namespace fs = std::filesystem;
+        struct Source
+        {
+            std::string name;
+            fs::path path;
+            std::vector<unsigned char> bytes;
+            AssetEntry entry;
+        };
+
+        std::error_code error;
+        fs::path root = fs::path(directory).lexically_normal();
+        if (!root.has_filename())
+            root = root.parent_path(); // "assets/"
+        const fs::path base = root.has_parent_path() ? root.parent_path() : fs::path();
+        std::vector<Source> sources;
+        for (fs::recursive_directory_iterator it(root, error), end; !error && it != end; it.increment(error))
+        {
+            if (it->is_regular_file())
+                sources.push_back({it->path().lexically_relative(base).generic_string(), it->path()});
+        }
+        if (error || sources.empty())
+        {
+            Log::Error("No assets to pack in {}", directory);
+            return false;
+        }
+        std::sort(sources.begin(), sources.end(), [](const Source &a, const Source &b)
+                  { return a.name < b.name; });
+
+        // read, and decode if asked, every file on the job system
+        std::vector<char> failed(sources.size(), 0);
+        JobSystem jobs;
+        jobs.ParallelFor(sources.size(), [&](size_t i)
+                         {
+            Source &source = sources[i];
+            Image image = {0};
+            if (decode && IsImage(source.path))
+                image = LoadImage(source.path.string().c_str());
+            if (image.data)
+            {
+                const int size = GetPixelDataSize(image.width, image.height, image.format);
+                const unsigned char *pixels = static_cast<const unsigned char *>(image.data);
+                source.bytes.assign(pixels, pixels + size);
+                source.entry.kind = AssetEntry::Pixels;
+                source.entry.width = image.width;
+                source.entry.height = image.height;
+                source.entry.mipmaps = 1; // only the base level is kept
+                source.entry.format = image.format;
+                UnloadImage(image);
+                return;
+            }
+            std::ifstream file(source.path, std::ios::binary | std::ios::ate);
+            if (!file)
+            {
+                failed[i] = 1;
+                return;
+            }
+            source.bytes.resize(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            failed[i] = !file.read(reinterpret_cast<char *>(source.bytes.data()), static_cast<std::streamsize>(source.bytes.size())); });
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            if (failed[i])
+            {
+                Log::Error("Failed to read asset: {}", sources[i].path.string());
+                return false;
+            }
+        }
+
+        // header, table and names first, then the blobs at aligned offsets
+        AssetHeader header;
+        header.version = VERSION;
+        header.count = static_cast<uint32_t>(sources.size());
+        uint64_t position = sizeof(AssetHeader) + sources.size() * sizeof(AssetEntry);
+        for (Source &source : sources)
+        {
+            source.entry.nameOffset = static_cast<uint32_t>(position);
+            source.entry.nameSize = static_cast<uint32_t>(source.name.size());
+            position += source.name.size();
+        }
+        for (Source &source : sources)
+        {
+            position = Align(position);
+            source.entry.offset = position;
+            source.entry.size = source.bytes.size();
+            position += source.bytes.size();
+        }
+
+        std::ofstream out(archivePath, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            Log::Error("Failed to create asset archive: {}", archivePath);
+            return false;
+        }
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        for (const Source &source : sources)
+            out.write(reinterpret_cast<const char *>(&source.entry), sizeof(AssetEntry));
+        for (const Source &source : sources)
+            out.write(source.name.data(), static_cast<std::streamsize>(source.name.size()));
+        uint64_t written = static_cast<uint64_t>(out.tellp());
+        static constexpr char PADDING[ALIGNMENT] = {};
+        for (const Source &source : sources)
+        {
+            out.write(PADDING, static_cast<std::streamsize>(source.entry.offset - written));
+            out.write(reinterpret_cast<const char *>(source.bytes.data()), static_cast<std::streamsize>(source.bytes.size()));
+            written = source.entry.offset + source.entry.size;
+        }
+        if (!out.flush())
+        {
+            Log::Error("Failed to write asset archive: {}", archivePath);
+            return false;
+        }
+        Log::Info("Packed {} assets into {} ({} bytes{})", sources.size(), archivePath, written, decode ? ", images decoded" : "");
+        return true;
+    }
+
+private:
+    const AssetHeader &Header() const { return *reinterpret_cast<const AssetHeader *>(m_data); }
+    const AssetEntry *Entries() const { return reinterpret_cast<const AssetEntry *>(m_data + sizeof(AssetHeader)); }
+
+    static uint64_t Align(uint64_t position) { return (position + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    static bool IsImage(const std::filesystem::path &path)
+    {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        return extension == ".png" || extension == ".bmp" || extension == ".tga" || extension == ".jpg" ||
+               extension == ".gif" || extension == ".qoi";
+    }
+
+    /// @brief every table entry, name and pixel blob has to lie inside the file, so neither lookups nor uploads read past the mapping
+    bool Validate() const
+    {
+        if (m_size < sizeof(AssetHeader))
+            return false;
+        const AssetHeader &header = Header();
+        if (std::memcmp(header.magic, AssetHeader{}.magic, sizeof(header.magic)) != 0 || header.version != VERSION)
+            return false;
+        if (header.count > (m_size - sizeof(AssetHeader)) / sizeof(AssetEntry))
+            return false;
+        for (uint32_t i = 0; i < header.count; ++i)
+        {
+            const AssetEntry &entry = Entries()[i];
+            if (uint64_t{entry.nameOffset} + entry.nameSize > m_size || entry.offset > m_size || entry.size > m_size - entry.offset)
+                return false;
+            // Pack stores the base level only, and Texture() hands mipmaps to the upload, which would read the chain
+            if (entry.kind == AssetEntry::Pixels &&
+                (entry.mipmaps != 1 || static_cast<uint64_t>(std::max(0, GetPixelDataSize(entry.width, entry.height, entry.format))) > entry.size))
+                return false;
+        }
+        return true;
+    }
+
+    const unsigned char *m_data = nullptr; // the mapped archive
+    size_t m_size = 0;
+#if !ASSET_ARCHIVE_MMAP
+    std::vector<unsigned char> m_buffer;
+#endif
+};
+
+/// @brief texture for an asset path: from the mounted archive if it has it, otherwise from the loose file
+inline Texture2D LoadAssetTexture(const std::string &path)
+{
+    if (const AssetEntry *entry = AssetArchive::Mounted().Find(path))
+        return AssetArchive::Mounted().Texture(*entry);
+    return LoadTexture(path.c_str());
+}
@@ -0,0 +1,105 @@
+/**
+ * @file Autotile.h
+ * @brief Compile-time tables mapping a tile's 8-neighbour mask to one of the 47 "blob" autotile frames.
+ * @date 2025-07-26
+ * @details A mask has one bit per neighbour holding the same tile value. A diagonal only matters when both
+ * edges next to it are set, so Reduce() clears the others, which leaves 47 distinct masks. Frames are
+ * numbered in ascending order of reduced mask. Both tables and the frame artwork are built by constexpr
+ * functions, so looking up a frame is one array index at run time.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace Autotile
+{
+    // neighbour bits, clockwise from north
+    enum : uint8_t
+    {
+        N = 1 << 0,
+        NE = 1 << 1,
+        E = 1 << 2,
+        SE = 1 << 3,
+        S = 1 << 4,
+        SW = 1 << 5,
+        W = 1 << 6,
+        NW = 1 << 7
+    };
+
+    static constexpr int FRAME_COUNT = 47;
+    static constexpr int TEXELS = 8; // frame artwork is TEXELS x TEXELS shades
+
+    /// @brief drop the diagonals that aren't backed by both neighbouring edges
+    constexpr uint8_t Reduce(uint8_t mask)
+    {
+        if ((mask & (N | E)) != (N | E))
+            mask &= ~NE;
+        if ((mask & (S | E)) != (S | E))
+            mask &= ~SE;
+        if ((mask & (S | W)) != (S | W))
+            mask &= ~SW;
+        if ((mask & (N | W)) != (N | W))
+            mask &= ~NW;
+        return mask;
+    }
+
+    /// @brief reduced mask of every frame, ascending
+    constexpr std::array<uint8_t, FRAME_COUNT> BuildFrameMasks()
+    {
+        std::array<uint8_t, FRAME_COUNT> masks{};
+        int count = 0;
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            if (Reduce(static_cast<uint8_t>(mask)) == mask)
+                masks[count++] = static_cast<uint8_t>(mask);
+        }
+        return masks;
+    }
+
+    constexpr std::array<uint8_t, 256> BuildFrameOfMask(const std::array<uint8_t, FRAME_COUNT> &frameMasks)
+    {
+        std::array<uint8_t, 256> frames{};
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            const uint8_t reduced = Reduce(static_cast<uint8_t>(mask));
+            for (int frame = 0; frame < FRAME_COUNT; ++frame)
+            {
+                if (frameMasks[frame] == reduced)
+                    frames[mask] = static_cast<uint8_t>(frame);
+            }
+        }
+        return frames;
+    }
+
+    /// @brief shade per texel, 255 inside and darker along the sides and inner corners that face other tiles
+    constexpr std::array<std::array<uint8_t, TEXELS * TEXELS>, FRAME_COUNT> BuildFrameShades(const std::array<uint8_t, FRAME_COUNT> &frameMasks)
+    {
+        constexpr uint8_t EDGE = 140;
+        std::array<std::array<uint8_t, TEXELS * TEXELS>, FRAME_COUNT> shades{};
+        for (int frame = 0; frame < FRAME_COUNT; ++frame)
+        {
+            const uint8_t m = frameMasks[frame];
+            for (int y = 0; y < TEXELS; ++y)
+            {
+                for (int x = 0; x < TEXELS; ++x)
+                {
+                    const bool top = y == 0, bottom = y == TEXELS - 1, left = x == 0, right = x == TEXELS - 1;
+                    bool edge = (top && !(m & N)) || (bottom && !(m & S)) || (left && !(m & W)) || (right && !(m & E));
+                    edge |= (top && left && !(m & NW)) || (top && right && !(m & NE)) ||
+                            (bottom && left && !(m & SW)) || (bottom && right && !(m & SE));
+                    shades[frame][y * TEXELS + x] = edge ? EDGE : 255;
+                }
+            }
+        }
+        return shades;
+    }
+
+    inline constexpr std::array<uint8_t, FRAME_COUNT> FRAME_MASKS = BuildFrameMasks();
+    inline constexpr std::array<uint8_t, 256> FRAME_OF_MASK = BuildFrameOfMask(FRAME_MASKS);
+    inline constexpr std::array<std::array<uint8_t, TEXELS * TEXELS>, FRAME_COUNT> FRAME_SHADES = BuildFrameShades(FRAME_MASKS);
+
+    static_assert(FRAME_MASKS[FRAME_COUNT - 1] == 0xFF, "47 reduced masks, the last one fully surrounded");
+    static_assert(FRAME_OF_MASK[N | NE] == FRAME_OF_MASK[N], "unsupported diagonals are ignored");
+}
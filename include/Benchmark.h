@@ -0,0 +1,1215 @@
+/**
+ * @file Benchmark.h
+ * @brief Console benchmarks, run with --bench [filter] instead of opening a window.
+ * @date 2025-07-25
+ * @details Each benchmark times its workload a few times, reports the best run as a rate, and checks its own
+ * results (for example that a parallel run matches the serial one). main() returns failure if any check
+ * failed, so the benchmarks double as a smoke test. --check runs every workload once and prints no timings, for
+ * checking correctness (conservation, determinism, golden images) without waiting on timing runs.
+ *
+ * Golden images live in golden/ at the project root (PROJECT_DIR, set by the Makefile) and are committed with
+ * the code. A missing or differing one fails; --update-golden records the current frames after an intended change.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Agents.h"
+#include "AllocTracker.h"
+#include "FrameArena.h"
+#include "GravityGame.h"
+#include "JobSystem.h"
+#include "TileGenerator.h"
+#include "Particles.h"
+#include "Pathfinding.h"
+#include "RenderBackend.h"
+#include "SandSimulation.h"
+
+#ifndef PROJECT_DIR
+#define PROJECT_DIR "" // a string literal when set; otherwise fall back to this header's location, see GoldenPath()
+#endif
+
+struct Benchmark
+{
+    inline static bool updateGolden = false; // record golden images instead of comparing with them
+    inline static bool checkOnly = false;    // run each workload once and report no timings
+
+    /// @return path of a golden image, anchored to the project rather than the working directory
+    static std::string GoldenPath(const char *name)
+    {
+        std::filesystem::path root = PROJECT_DIR;
+        if (root.empty())
+            root = std::filesystem::path(__FILE__).parent_path().parent_path(); // include/ -> project root
+        return (root / "golden" / name).string();
+    }
+
+    /// @return best wall time of fn over the given number of runs, in seconds
+    template <typename Fn>
+    static double Time(int runs, Fn &&fn)
+    {
+        double best = 1e30;
+        if (checkOnly)
+            runs = 1;
+        for (int run = 0; run < runs; ++run)
+        {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    static void Report(const std::string &name, double seconds, double units, const char *unit)
+    {
+        if (checkOnly)
+            return;
+        std::cout << "  " << name << ": " << seconds * 1000.0 << " ms, " << units / seconds / 1e6 << " M" << unit << "/s" << std::endl;
+    }
+
+    static std::string FormatSpeedup(double speedup)
+    {
+        return std::format("{:.2f}", speedup);
+    }
+
+    static bool Check(bool ok, const std::string &what)
+    {
+        if (!ok)
+            std::cerr << "  CHECK FAILED: " << what << std::endl;
+        return ok;
+    }
+
+    // --- benchmarks ---
+
+    /// @brief tiles generated per second, serial and on the pool, outputs must match
+    static bool TileGeneration()
+    {
+        constexpr int CHUNKS = 64; // 2048 x 2048 tiles
+        const TileRect area = {-CHUNKS / 2 * TileChunk::SIZE, -CHUNKS / 2 * TileChunk::SIZE, CHUNKS / 2 * TileChunk::SIZE, CHUNKS / 2 * TileChunk::SIZE};
+        const double tiles = static_cast<double>(CHUNKS) * CHUNKS * TileChunk::SIZE * TileChunk::SIZE;
+        JobSystem serial(1), parallel;
+
+        bool ok = true;
+        for (int type = 0; type < static_cast<int>(GeneratorType::Count); ++type)
+        {
+            const GeneratorType generator = static_cast<GeneratorType>(type);
+            std::vector<uint64_t> keys;
+            std::vector<TileChunk> serialChunks, parallelChunks;
+
+            double one = Time(1, [&]
+                              { TileGenerator::GenerateChunks(generator, 1234, area, serial, keys, serialChunks); });
+            double all = Time(3, [&]
+                              { TileGenerator::GenerateChunks(generator, 1234, area, parallel, keys, parallelChunks); });
+            Report(std::string(GeneratorTypeName(generator)) + ", 1 thread", one, tiles, "tiles");
+            Report(std::string(GeneratorTypeName(generator)) + ", " + std::to_string(parallel.Size()) + " threads", all, tiles, "tiles");
+
+            bool same = serialChunks.size() == parallelChunks.size();
+            for (size_t i = 0; same && i < serialChunks.size(); ++i)
+                same = std::equal(serialChunks[i].tiles.begin(), serialChunks[i].tiles.end(), parallelChunks[i].tiles.begin(),
+                                  [](const ecs::Tile &a, const ecs::Tile &b)
+                                  { return a.value == b.value; });
+            ok &= Check(same, std::string(GeneratorTypeName(generator)) + " output depends on the thread count");
+        }
+
+        Tilemap tm;
+        double apply = Time(1, [&]
+                            { TileGenerator::Generate(tm, 0, GeneratorType::Caves, 1234, area, parallel); });
+        Report("Caves into a tilemap", apply, tiles, "tiles");
+        return ok;
+    }
+
+    /// @brief thousands of agents pathing across a 1024 x 1024 room map with A*, the path cache and a flow field
+    static bool Pathfinding()
+    {
+        constexpr int SIDE = 1024;
+        constexpr int AGENTS = 2000;
+        const TileRect bounds = {0, 0, SIDE, SIDE};
+        JobSystem pool;
+        Tilemap tm;
+        TileGenerator::Generate(tm, 0, GeneratorType::Rooms, 99, bounds, pool);
+        Pathfinder pathfinder;
+        pathfinder.Reset(tm.layers[0], bounds);
+
+        // random open starts, each agent heading for an open tile up to RANGE away; far shared goals use the flow field
+        constexpr int RANGE = 64;
+        std::vector<GridPoint> starts, goals;
+        uint64_t rng = 7;
+        auto randomOpen = [&](GridPoint centre, int range)
+        {
+            while (true)
+            {
+                rng = TileGenerator::Mix(rng);
+                GridPoint p = {centre.x + static_cast<int>(rng % (2 * range)) - range, centre.y + static_cast<int>((rng >> 32) % (2 * range)) - range};
+                if (pathfinder.IsWalkable(p.x, p.y))
+                    return p;
+            }
+        };
+        for (int i = 0; i < AGENTS; ++i)
+        {
+            starts.push_back(randomOpen({SIDE / 2, SIDE / 2}, SIDE / 2));
+            goals.push_back(randomOpen(starts.back(), RANGE));
+        }
+
+        std::vector<GridPoint> path;
+        size_t found = 0, steps = 0;
+        double search = Time(1, [&]
+                             {
+            found = steps = 0;
+            for (int i = 0; i < AGENTS; ++i)
+            {
+                if (pathfinder.Search(starts[i], goals[i], path))
+                {
+                    ++found;
+                    steps += path.size();
+                }
+            } });
+        Report("A*, " + std::to_string(found) + "/" + std::to_string(AGENTS) + " paths found, " + std::to_string(steps / std::max<size_t>(found, 1)) + " steps each",
+               search, AGENTS, "paths");
+
+        for (int i = 0; i < AGENTS; ++i)
+            pathfinder.FindPath(starts[i], goals[i]);
+        double cached = Time(3, [&]
+                             {
+            for (int i = 0; i < AGENTS; ++i)
+                pathfinder.FindPath(starts[i], goals[i]); });
+        Report("A*, cached", cached, AGENTS, "paths");
+
+        // an edit that only adds walls drops just the paths passing near it
+        const TileRect edit = {SIDE / 2 - 8, SIDE / 2 - 8, SIDE / 2 + 8, SIDE / 2 + 8};
+        for (int y = edit.y0; y < edit.y1; ++y)
+            Tilemap::FillSpan(tm, y, edit.x0, edit.x1 - 1, 1);
+        const size_t before = pathfinder.CachedPaths();
+        pathfinder.OnTilesChanged(tm.layers[0], edit);
+        std::cout << "  a 16x16 edit kept " << pathfinder.CachedPaths() << " of " << before << " cached paths" << std::endl;
+
+        // all agents walking to one goal through a flow field
+        const GridPoint goal = randomOpen({SIDE / 2, SIDE / 2}, SIDE / 2);
+        FlowField field;
+        double build = Time(1, [&]
+                            { pathfinder.BuildFlowField(goal, field); });
+        Report("flow field", build, double(SIDE) * SIDE, "tiles");
+        size_t walked = 0;
+        double follow = Time(1, [&]
+                             {
+            walked = 0;
+            for (int i = 0; i < AGENTS; ++i)
+            {
+                GridPoint at = starts[i], next;
+                while (field.Next(at.x, at.y, next))
+                {
+                    at = next;
+                    ++walked;
+                }
+            } });
+        Report("flow field, following", follow, static_cast<double>(walked), "steps");
+
+        // A* must agree with the field's exact distances
+        bool ok = true;
+        for (int i = 0; i < 100 && ok; ++i)
+        {
+            const uint32_t expected = field.distance[(starts[i].y - bounds.y0) * SIDE + (starts[i].x - bounds.x0)];
+            uint32_t cost = FlowField::UNREACHABLE;
+            if (pathfinder.Search(starts[i], goal, path))
+            {
+                cost = 0;
+                for (size_t p = 1; p < path.size(); ++p)
+                    cost += (path[p].x != path[p - 1].x && path[p].y != path[p - 1].y) ? Pathfinder::DIAGONAL_COST : Pathfinder::STRAIGHT_COST;
+            }
+            ok = Check(cost == expected, "A* path cost differs from the flow field distance");
+        }
+        return ok;
+    }
+
+    /// @brief 100k crowd agents stepped at 60 Hz without a window; the frame time has to fit the 16.7 ms budget
+    static bool Crowd()
+    {
+        constexpr int AGENTS = 100000;
+        constexpr int FRAMES = 60;
+        constexpr float SIDE = 2000.0f; // about 40 square units per agent
+        constexpr float DT = 1.0f / 60.0f;
+
+        // two registries with the same agents, stepped on one thread and on the whole pool
+        auto spawn = [](entt::registry &registry)
+        {
+            uint64_t rng = 11;
+            auto random = [&]
+            {
+                rng = TileGenerator::Mix(rng);
+                return static_cast<float>(rng >> 40) / static_cast<float>(1 << 24) * SIDE;
+            };
+            for (int i = 0; i < AGENTS; ++i)
+            {
+                entt::entity e = registry.create();
+                registry.emplace<ecs::Position>(e, random(), random());
+                registry.emplace<ecs::Velocity>(e);
+                registry.emplace<ecs::Goal>(e, random(), random());
+                registry.emplace<ecs::Agent>(e);
+            }
+        };
+        entt::registry serialRegistry, parallelRegistry;
+        spawn(serialRegistry);
+        spawn(parallelRegistry);
+        JobSystem serial(1), parallel;
+        CrowdSystem serialCrowd(serial), parallelCrowd(parallel);
+
+        double one = Time(1, [&]
+                          {
+            for (int frame = 0; frame < FRAMES; ++frame)
+                serialCrowd.OnUpdate(serialRegistry, DT); });
+        double all = Time(1, [&]
+                          {
+            for (int frame = 0; frame < FRAMES; ++frame)
+                parallelCrowd.OnUpdate(parallelRegistry, DT); });
+        Report("frame, 1 thread", one / FRAMES, AGENTS, "agents");
+        Report("frame, " + std::to_string(parallel.Size()) + " threads", all / FRAMES, AGENTS, "agents");
+
+        bool same = true;
+        auto serialView = serialRegistry.view<ecs::Position>();
+        for (entt::entity e : serialView)
+        {
+            const ecs::Position &a = serialView.get<ecs::Position>(e), &b = parallelRegistry.get<ecs::Position>(e);
+            same &= a.x == b.x && a.y == b.y;
+        }
+        bool ok = Check(same, "crowd positions depend on the thread count");
+        if (all / FRAMES > 1.0 / 60.0 && !checkOnly)
+            std::cout << "  note: slower than 60 Hz on " << parallel.Size() << " threads" << std::endl;
+        return ok;
+    }
+
+    /// @brief 1M live particles: the SIMD and scalar kernels on their own, then updates with bursts refilling what dies
+    static bool Particles()
+    {
+        constexpr size_t PARTICLES = 1000000;
+        constexpr int FRAMES = 60;
+        constexpr float DT = 1.0f / 60.0f;
+        EmitterSettings settings = EmitterSettings::Sparks();
+        settings.lifeMin = settings.lifeMax = 10.0f; // nothing dies while the kernels are timed
+
+        // same seed, so both emitters spawn the same particles
+        ParticleEmitter simd(settings, PARTICLES), scalar(settings, PARTICLES);
+        simd.Burst(0.0f, 0.0f, PARTICLES);
+        scalar.Burst(0.0f, 0.0f, PARTICLES);
+        double simdTime = Time(1, [&]
+                               {
+            for (int frame = 0; frame < FRAMES; ++frame)
+                simd.Update(DT); });
+        double scalarTime = Time(1, [&]
+                                 {
+            for (int frame = 0; frame < FRAMES; ++frame)
+                scalar.Pool().UpdateScalar(DT, settings.forces); });
+        Report(std::string(PARTICLES_SSE ? "SSE" : "scalar fallback") + " kernel", simdTime / FRAMES, PARTICLES, "particles");
+        Report("scalar kernel", scalarTime / FRAMES, PARTICLES, "particles");
+
+        const ParticlePool &a = simd.Pool(), &b = scalar.Pool();
+        bool same = a.Count() == b.Count();
+        for (size_t i = 0; same && i < a.Count(); ++i)
+            same = std::abs(a.X(i) - b.X(i)) <= 1e-3f && std::abs(a.Y(i) - b.Y(i)) <= 1e-3f;
+        bool ok = Check(same, "SIMD and scalar particle kernels disagree");
+
+        // short lives: every frame recycles the dead and bursts refill the pool
+        simd.Settings().lifeMin = 0.2f;
+        simd.Settings().lifeMax = 0.6f;
+        simd.Pool().Clear();
+        simd.Burst(0.0f, 0.0f, PARTICLES);
+        size_t spawned = 0;
+        double churn = Time(1, [&]
+                            {
+            for (int frame = 0; frame < FRAMES; ++frame)
+            {
+                simd.Update(DT);
+                spawned += simd.Burst(0.0f, 0.0f, PARTICLES);
+            } });
+        Report("update and refill, " + std::to_string(spawned / FRAMES) + " spawned per frame", churn / FRAMES, PARTICLES, "particles");
+        ok &= Check(simd.Pool().Count() == PARTICLES, "the pool didn't refill to capacity");
+        return ok;
+    }
+
+    /// @brief the job system itself, then the physics and tilemap kernels on 1, 2, 4 ... threads up to the hardware count;
+    /// every thread count has to produce the serial result
+    static bool Jobs()
+    {
+        std::vector<size_t> threadCounts;
+        const size_t hardware = std::max<size_t>(2, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads < hardware; threads *= 2)
+            threadCounts.push_back(threads);
+        threadCounts.push_back(hardware);
+
+        // dependencies: a tree of jobs splitting down to leaves, the root is done only when every leaf ran
+        bool ok = true;
+        for (size_t threads : threadCounts)
+        {
+            JobSystem jobs(threads);
+            constexpr int DEPTH = 10;
+            std::atomic<int> leaves{0};
+            struct Tree
+            {
+                JobSystem &jobs;
+                std::atomic<int> &leaves;
+                void Branch(JobSystem::Job &self, int depth)
+                {
+                    if (depth == 0)
+                    {
+                        leaves.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    for (int child = 0; child < 2; ++child)
+                        jobs.Schedule([this, depth](JobSystem::Job &job)
+                                      { Branch(job, depth - 1); }, &self);
+                }
+            } tree{jobs, leaves};
+            double spawn = Time(3, [&]
+                                {
+                leaves = 0;
+                JobSystem::Job *root = jobs.Schedule([&](JobSystem::Job &self)
+                                                     { tree.Branch(self, DEPTH); });
+                jobs.Wait(root); });
+            Report("job tree, " + std::to_string(threads) + " threads", spawn, double(2 << DEPTH), "jobs");
+            ok &= Check(leaves == 1 << DEPTH, "a parent job finished before its children");
+        }
+
+        // physics: gravity integration over 1M rigid bodies, the system's view split across the threads
+        constexpr int BODIES = 1000000;
+        constexpr int FRAMES = 20;
+        constexpr float DT = 1.0f / 60.0f;
+        entt::registry registry;
+        registry.ctx().emplace<ecs::Gravity>();
+        for (int i = 0; i < BODIES; ++i)
+        {
+            const entt::entity e = registry.create();
+            registry.emplace<ecs::RigidBody>(e);
+            registry.emplace<::Rectangle>(e, ::Rectangle{static_cast<float>(i % 1000), static_cast<float>(i / 1000), 1.0f, 1.0f});
+            if (i % 4 == 0)
+                registry.emplace<ecs::Grounded>(e);
+        }
+        PhysicsBodies(registry); // the system's group, built outside the timing
+        float expected = 0.0f;
+        for (int frame = 0; frame < FRAMES; ++frame)
+            expected += registry.ctx().get<ecs::Gravity>().value * DT;
+        double physicsOne = 0.0;
+        for (size_t threads : threadCounts)
+        {
+            JobSystem jobs(threads);
+            PhysicsSystem physics;
+            physics.UseJobs(&jobs);
+            double time = Time(1, [&]
+                               {
+                registry.view<ecs::RigidBody>().each([](ecs::RigidBody &body)
+                                                     { body.velocity = {}; });
+                for (int frame = 0; frame < FRAMES; ++frame)
+                    physics.OnUpdate(registry, DT); });
+            physicsOne = threads == 1 ? time : physicsOne;
+            Report("physics, " + std::to_string(threads) + " threads, x" + FormatSpeedup(physicsOne / time), time / FRAMES, BODIES, "bodies");
+
+            bool same = true;
+            registry.view<ecs::RigidBody>().each([&](entt::entity e, const ecs::RigidBody &body)
+                                                 { same &= body.velocity.y == (registry.all_of<ecs::Grounded>(e) ? 0.0f : expected); });
+            ok &= Check(same, "physics result depends on the thread count");
+        }
+
+        // tilemap: autotile masks of a 2048 x 2048 cave layer, recomputed in rows of chunks
+        constexpr int CHUNKS = 64;
+        const TileRect area = {0, 0, CHUNKS * TileChunk::SIZE, CHUNKS * TileChunk::SIZE};
+        Tilemap tm;
+        {
+            JobSystem jobs;
+            TileGenerator::Generate(tm, 0, GeneratorType::Caves, 77, area, jobs);
+        }
+        TileLayer &layer = tm.layers[0];
+        auto clearMasks = [&]
+        {
+            for (auto &[key, chunk] : layer.chunks)
+                chunk->masks.fill(0);
+        };
+        clearMasks();
+        Tilemap::UpdateMasks(layer, area);
+        std::vector<uint8_t> serialMasks;
+        for (uint64_t key : Tilemap::SortedKeys(layer))
+            serialMasks.insert(serialMasks.end(), layer.chunks.at(key)->masks.begin(), layer.chunks.at(key)->masks.end());
+
+        double masksOne = 0.0;
+        for (size_t threads : threadCounts)
+        {
+            JobSystem jobs(threads);
+            double time = Time(3, [&]
+                               {
+                clearMasks();
+                Tilemap::UpdateMasks(layer, area, jobs); });
+            masksOne = threads == 1 ? time : masksOne;
+            Report("tile masks, " + std::to_string(threads) + " threads, x" + FormatSpeedup(masksOne / time), time,
+                   double(area.x1) * area.y1, "tiles");
+
+            std::vector<uint8_t> masks;
+            for (uint64_t key : Tilemap::SortedKeys(layer))
+                masks.insert(masks.end(), layer.chunks.at(key)->masks.begin(), layer.chunks.at(key)->masks.end());
+            ok &= Check(masks == serialMasks, "tile masks depend on the thread count");
+        }
+        if (std::thread::hardware_concurrency() <= 1)
+            std::cout << "  note: one hardware thread, the extra threads only show the overhead" << std::endl;
+        return ok;
+    }
+
+    /// @brief frames of scratch work (entity lists, a serialized map, GUI labels) on the frame arena and on the heap;
+    /// after the first frame the arena must not take anything from the heap, and neither may the game's own frames
+    static bool FrameScratch()
+    {
+        constexpr int FRAMES = 200;
+        Tilemap tm;
+        for (int y = 0; y < 64; ++y)
+            Tilemap::FillSpan(tm, y, 0, 63, (y / 4) % 3);
+        FrameArena arena(4096); // deliberately small, the first frame has to grow it
+
+        auto frame = [&](auto &&makeVector, auto &&makeString)
+        {
+            size_t bytes = 0;
+            auto entities = makeVector();
+            for (uint32_t i = 0; i < 1000; ++i)
+                entities.push_back(static_cast<entt::entity>(i));
+            auto text = makeString();
+            Tilemap::Serialize(tm, text);
+            bytes += entities.size() + text.size();
+            for (int label = 0; label < 32; ++label)
+            {
+                auto line = makeString();
+                std::format_to(std::back_inserter(line), "Brush Size: {}", label);
+                bytes += line.size();
+            }
+            return bytes;
+        };
+
+        size_t sink = 0;
+        uint64_t afterWarmUp = 0;
+        double onArena = Time(1, [&]
+                              {
+            for (int i = 0; i < FRAMES; ++i)
+            {
+                sink += frame([&] { return MakeFrameVector<entt::entity>(arena); }, [&] { return MakeFrameString(arena); });
+                arena.Reset();
+                if (i == 0)
+                    afterWarmUp = arena.UpstreamAllocations();
+            } });
+        double onHeap = Time(1, [&]
+                             {
+            for (int i = 0; i < FRAMES; ++i)
+                sink += frame([] { return std::vector<entt::entity>(); }, [] { return std::string(); }); });
+        Report("frame arena", onArena, FRAMES, "frames");
+        Report("heap", onHeap, FRAMES, "frames");
+        std::cout << "  " << sink / (2 * FRAMES) << " bytes of scratch per frame, the arena grew to " << arena.Capacity()
+                  << " bytes, high water " << arena.HighWater() << std::endl;
+        bool ok = Check(arena.UpstreamAllocations() == afterWarmUp, "the frame arena allocated from the heap after the first frame");
+        return ok & GameFrames();
+    }
+
+    /// @brief real frames of the gravity game on a hidden window, the box dropped after the warm-up; every
+    /// operator new after the warm-up fails the check. Only TRACK_ALLOCATIONS builds can count them.
+    static bool GameFrames()
+    {
+        if constexpr (!AllocTracker::ENABLED)
+        {
+            std::cout << "  note: build with TRACK_ALLOCATIONS=TRUE to check the game's frames for heap allocations" << std::endl;
+            return true;
+        }
+        constexpr int WARM_UP = 60, FRAMES = 600;
+        constexpr float FRAME_TIME = 1.0f / 60.0f;
+
+        GravityGame game(800, 600, "frames", FLAG_WINDOW_HIDDEN, 0);
+        game.Init();
+        uint64_t allocations = 0, worst = 0;
+        for (int i = 0; i < WARM_UP + FRAMES; ++i)
+        {
+            InputFrame input;
+            input.deltaTime = FRAME_TIME;
+            if (i == WARM_UP)
+                input.keys[input.keyCount++] = KEY_SPACE; // drop the box
+            Input::BeginFrame(input);
+            game.HandleInput();
+            game.Update(FRAME_TIME);
+            game.Render();
+            FrameArena::Frame().Reset();
+            AllocTracker::EndFrame();
+            if (i >= WARM_UP)
+            {
+                allocations += AllocTracker::LastFrame().count;
+                worst = std::max(worst, AllocTracker::LastFrame().count);
+            }
+        }
+        game.Cleanup();
+        std::cout << "  game: " << allocations << " heap allocations in " << FRAMES << " frames after the warm-up, at most "
+                  << worst << " in one" << std::endl;
+        return Check(allocations == 0, "the game allocated from the heap after the warm-up");
+    }
+
+    /// @brief a frame of boxes, grid and tiles: building its draw list and rasterizing it on the CPU, timed apart;
+    /// the list must replay to the same pixels as drawing directly, and the frame must match golden/render.png
+    /// (re-record it with --update-golden after an intended change)
+    static bool Render()
+    {
+        constexpr int WIDTH = 800, HEIGHT = 600, BOXES = 2000, RUNS = 20;
+
+        // 2 x 2 chunks of caves at one texel per pixel in the top-left corner, over boxes covering the screen
+        Tilemap tm;
+        tm.tileSize = Autotile::TEXELS;
+        {
+            JobSystem jobs;
+            TileGenerator::Generate(tm, 0, GeneratorType::Caves, 5, {0, 0, 2 * TileChunk::SIZE, 2 * TileChunk::SIZE}, jobs);
+        }
+        GravitySnapshot snapshot;
+        snapshot.drawGrid = true;
+        uint64_t rng = 3;
+        for (int i = 0; i < BOXES; ++i)
+        {
+            rng = TileGenerator::Mix(rng);
+            const float x = static_cast<float>(rng % WIDTH), y = static_cast<float>((rng >> 16) % HEIGHT);
+            const float size = static_cast<float>(4 + (rng >> 32) % 60);
+            const Color tint = {static_cast<unsigned char>(rng >> 40), static_cast<unsigned char>(rng >> 48), static_cast<unsigned char>(rng >> 56),
+                                static_cast<unsigned char>(i % 4 == 0 ? 128 : 255)}; // every fourth one translucent
+            snapshot.boxes.push_back({{x, y, size, size}, tint, i % 16 == 0});
+        }
+        snapshot.labels.push_back({"not rasterized on the CPU", {10, 10}, 20, BLACK});
+
+        const Rectangle marker = {700, 500, 40, 40};
+        auto drawFrame = [&](IRenderBackend &backend)
+        {
+            GravityGame::DrawSnapshot(snapshot, WIDTH, HEIGHT, backend);
+            Tilemap::Draw(tm, {0, 0}, WIDTH, HEIGHT, backend);
+            backend.FillRect(marker, RED);
+            backend.RectLines(marker, BLACK);
+        };
+
+        DrawList list;
+        double building = Time(RUNS, [&]
+                               {
+            list.Reset();
+            drawFrame(list); });
+        SoftwareRenderer replayed(WIDTH, HEIGHT);
+        double rasterizing = Time(RUNS, [&]
+                                  { list.Replay(replayed); });
+        Report("draw list, " + std::to_string(list.Size()) + " commands", building, static_cast<double>(list.Size()), "commands");
+        Report("software raster", rasterizing, static_cast<double>(WIDTH) * HEIGHT, "pixels");
+
+        SoftwareRenderer direct(WIDTH, HEIGHT);
+        drawFrame(direct);
+        bool ok = Check(CompareImages(direct.Frame(), replayed.Frame()) == 0, "replaying the draw list differs from drawing directly");
+
+        auto same = [](Color a, Color b)
+        { return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a; };
+        ok &= Check(same(direct.Pixel(720, 520), RED) && same(direct.Pixel(700, 500), BLACK) && same(direct.Pixel(739, 539), BLACK) &&
+                        !same(direct.Pixel(740, 540), RED) && !same(direct.Pixel(740, 540), BLACK),
+                    "the marker rectangle doesn't cover exactly its pixels");
+
+        std::vector<Color> texels(Tilemap::BAKED_SIZE * Tilemap::BAKED_SIZE);
+        Tilemap::ShadeChunk(*tm.layers[0].chunks.at(TileChunk::Key(1, 1)), texels.data());
+        bool tiles = true;
+        for (int y = 0; y < Tilemap::BAKED_SIZE; ++y)
+        {
+            for (int x = 0; x < Tilemap::BAKED_SIZE; ++x)
+            {
+                const Color texel = texels[y * Tilemap::BAKED_SIZE + x];
+                tiles &= texel.a == 0 || same(direct.Pixel(Tilemap::BAKED_SIZE + x, Tilemap::BAKED_SIZE + y), texel);
+            }
+        }
+        ok &= Check(tiles, "tile pixels differ from the chunk's shaded texels");
+
+        // the 4-wide blend and its scalar tail must round the same way
+        Color blended[7];
+        std::fill_n(blended, 7, Color{10, 200, 90, 255});
+        SoftwareRenderer::BlendSpan(blended, 7, {250, 20, 130, 77});
+        ok &= Check(std::all_of(blended, blended + 7, [&](Color c)
+                                { return same(c, blended[0]); }),
+                    "vector and scalar blending differ");
+
+        return ok & Check(MatchGolden(direct.Frame(), GoldenPath("render.png"), 0, updateGolden), "the frame doesn't match golden/render.png");
+    }
+
+    /// @brief sand and water poured over a 2048 x 2048 cave map, stepped on 1..N threads; the result must not
+    /// depend on the thread count and no sand or water may appear or vanish
+    static bool Sand()
+    {
+        constexpr int SIDE = 2048, STEPS = 60;
+        const TileRect bounds = {0, 0, SIDE, SIDE};
+        const size_t hardware = std::max(2u, std::thread::hardware_concurrency());
+        std::vector<size_t> threadCounts = {1, hardware};
+
+        auto count = [](const TileLayer &layer, int value)
+        {
+            size_t n = 0;
+            for (const auto &[key, chunk] : layer.chunks)
+                n += std::count_if(chunk->tiles.begin(), chunk->tiles.end(), [&](const ecs::Tile &tile)
+                                   { return tile.value == value; });
+            return n;
+        };
+
+        bool ok = true;
+        uint64_t expected = 0;
+        double one = 0.0;
+        for (size_t threads : threadCounts)
+        {
+            // caves as stone, the open space of the top half filled with sand on the left and water on the right
+            Tilemap tm;
+            JobSystem jobs(threads);
+            TileGenerator::Generate(tm, 0, GeneratorType::Caves, 21, bounds, jobs);
+            for (int y = 0; y < SIDE; ++y)
+            {
+                for (int x = 0; x < SIDE;)
+                {
+                    const int value = Tilemap::Get(tm, x, y);
+                    int end = x + 1;
+                    while (end < SIDE && Tilemap::Get(tm, end, y) == value)
+                        ++end;
+                    const int fill = value != 0 ? TILE_STONE : y >= SIDE / 2 ? 0 : x < SIDE / 2 ? TILE_SAND : TILE_WATER;
+                    if (fill != value)
+                        Tilemap::FillSpan(tm, y, x, end - 1, fill);
+                    x = end;
+                }
+            }
+            TileLayer &layer = tm.layers[0];
+            const size_t sand = count(layer, TILE_SAND), water = count(layer, TILE_WATER);
+
+            SandSimulation simulation(bounds);
+            size_t awake = 0;
+            double time = Time(1, [&]
+                               {
+                for (int step = 0; step < STEPS; ++step)
+                {
+                    simulation.Step(layer, jobs);
+                    awake += simulation.AwakeChunks();
+                } });
+            one = threads == 1 ? time : one;
+            Report("sand, " + std::to_string(threads) + " threads, x" + FormatSpeedup(one / time), time / STEPS, double(SIDE) * SIDE, "tiles");
+            std::cout << "  " << awake / STEPS << " of " << layer.chunks.size() << " chunks awake per step on average" << std::endl;
+
+            ok &= Check(count(layer, TILE_SAND) == sand && count(layer, TILE_WATER) == water, "sand or water appeared or vanished");
+            const uint64_t hash = Tilemap::Hash(tm);
+            if (threads == 1)
+                expected = hash;
+            ok &= Check(hash == expected, "the sand simulation depends on the thread count");
+        }
+        if (std::thread::hardware_concurrency() <= 1)
+            std::cout << "  note: one hardware thread, the extra threads only show the overhead" << std::endl;
+        return ok;
+    }
+
+    /// @brief the physics and collision passes over views, as they were, and over the owning body group, at the game's
+    /// scale up to a million bodies; both must leave every body in the same state
+    static bool Groups()
+    {
+        constexpr float DT = 1.0f / 60.0f;
+        constexpr int FRAMES = 10;
+
+        // bodies scattered over a square, a quarter grounded, one in eight a droppable box, half collidable ground
+        auto populate = [](entt::registry &registry, int count)
+        {
+            registry.ctx().emplace<ecs::Gravity>();
+            const float side = std::sqrt(static_cast<float>(count)) * 24.0f;
+            uint64_t rng = 17;
+            for (int i = 0; i < count; ++i)
+            {
+                rng = TileGenerator::Mix(rng);
+                const entt::entity e = registry.create();
+                registry.emplace<ecs::RigidBody>(e);
+                registry.emplace<::Rectangle>(e, ::Rectangle{static_cast<float>(rng % 65536) / 65536.0f * side, static_cast<float>((rng >> 16) % 65536) / 65536.0f * side,
+                                                             static_cast<float>(4 + (rng >> 32) % 16), static_cast<float>(4 + (rng >> 40) % 16)});
+                if (i % 4 == 0)
+                    registry.emplace<ecs::Grounded>(e);
+                if (i % 8 == 1)
+                    registry.emplace<ecs::Droppable>(e);
+                if (i % 8 == 1 || i % 2 == 0)
+                    registry.emplace<ecs::Collidable>(e);
+            }
+        };
+
+        // the systems as they were before the group: views probing the other pools, droppables against every collidable
+        auto physicsOverViews = [](entt::registry &registry, float dt)
+        {
+            const float gravity = registry.ctx().get<ecs::Gravity>().value;
+            registry.view<ecs::RigidBody, ::Rectangle>(entt::exclude<ecs::Grounded>).each([&](ecs::RigidBody &body, ::Rectangle &)
+                                                                                         { body.velocity.y += gravity * dt; });
+        };
+        auto collisionsOverViews = [](entt::registry &registry)
+        {
+            auto droppables = registry.view<ecs::Droppable, ::Rectangle, ecs::RigidBody, ecs::Collidable>();
+            auto collidables = registry.view<ecs::Collidable, ::Rectangle, ecs::RigidBody>(entt::exclude<ecs::Droppable>);
+            droppables.each([&](ecs::Droppable &, ::Rectangle &droppableRect, ecs::RigidBody &droppableBody, ecs::Collidable &droppableCollidable)
+                            { collidables.each([&](ecs::Collidable &collidable, ::Rectangle &collidableRect, ecs::RigidBody &collidableBody)
+                                               {
+                if (CheckCollisionRecs(droppableRect, collidableRect))
+                {
+                    collidable.isColliding = true; // both sides now, as the contact manager keeps them
+                    droppableCollidable.isColliding = true;
+                    droppableBody.velocity.y = 0.0f;
+                    droppableBody.velocity.x = collidableBody.velocity.x;
+                } }); });
+        };
+
+        // CollisionSystem's sweep and prune over a view: the same pruning and contacts, but the order is a vector of
+        // entities and every body is looked up in each pool, so it tells the iteration speedup apart from the pruning one
+        struct ViewSweep
+        {
+            struct Candidate
+            {
+                entt::entity entity;
+                ::Rectangle *rect;
+                ecs::RigidBody *body;
+                ecs::Collidable *collidable;
+                bool droppable;
+            };
+            std::vector<entt::entity> order; // collidable bodies by left edge
+            std::vector<Candidate> active;
+            ContactManager contacts;
+
+            void Attach(entt::registry &registry)
+            {
+                auto view = registry.view<::Rectangle, ecs::RigidBody, ecs::Collidable>();
+                order.assign(view.begin(), view.end());
+                std::sort(order.begin(), order.end(), [&](entt::entity a, entt::entity b)
+                          { return view.get<::Rectangle>(a).x < view.get<::Rectangle>(b).x; });
+            }
+
+            void Update(entt::registry &registry)
+            {
+                auto view = registry.view<::Rectangle, ecs::RigidBody, ecs::Collidable>();
+                const auto &droppables = registry.storage<ecs::Droppable>();
+                for (size_t i = 1; i < order.size(); ++i) // insertion sort, as the group's
+                {
+                    const entt::entity e = order[i];
+                    const float x = view.get<::Rectangle>(e).x;
+                    size_t j = i;
+                    for (; j > 0 && view.get<::Rectangle>(order[j - 1]).x > x; --j)
+                        order[j] = order[j - 1];
+                    order[j] = e;
+                }
+                contacts.Begin();
+                active.clear();
+                for (const entt::entity e : order)
+                {
+                    auto [rect, body, collidable] = view.get(e);
+                    std::erase_if(active, [&](const Candidate &candidate)
+                                  { return candidate.rect->x + candidate.rect->width <= rect.x; });
+                    const Candidate current = {e, &rect, &body, &collidable, droppables.contains(e)};
+                    for (const Candidate &other : active)
+                    {
+                        if (current.droppable == other.droppable || !CheckCollisionRecs(*current.rect, *other.rect))
+                            continue;
+                        const Candidate &droppable = current.droppable ? current : other, &ground = current.droppable ? other : current;
+                        contacts.Add(droppable.entity, ground.entity, {droppable.rect->x + droppable.rect->width * 0.5f, droppable.rect->y + droppable.rect->height});
+                        droppable.body->velocity.y = 0.0f;
+                        droppable.body->velocity.x = ground.body->velocity.x;
+                    }
+                    active.push_back(current);
+                }
+                contacts.End();
+                for (const Contact &contact : contacts.Began()) // one update from rest, nothing has ended
+                {
+                    view.get<ecs::Collidable>(contact.a).isColliding = view.get<ecs::Collidable>(contact.b).isColliding = true;
+                    ++view.get<ecs::Collidable>(contact.a).contacts;
+                    ++view.get<ecs::Collidable>(contact.b).contacts;
+                    if (!registry.all_of<ecs::Grounded>(contact.a))
+                        registry.emplace<ecs::Grounded>(contact.a);
+                }
+            }
+        };
+
+        bool ok = true;
+        for (int count : {16, 1000, 10000, 100000, 1000000})
+        {
+            entt::registry viewRegistry, groupRegistry;
+            populate(viewRegistry, count);
+            populate(groupRegistry, count);
+            PhysicsSystem physics;
+            physics.OnAttach(groupRegistry);
+
+            const double bodies = static_cast<double>(count) * FRAMES;
+            const int runs = count < 100000 ? 20 : 3;
+            double views = Time(runs, [&]
+                                {
+                for (int frame = 0; frame < FRAMES; ++frame)
+                    physicsOverViews(viewRegistry, DT); });
+            double group = Time(runs, [&]
+                                {
+                for (int frame = 0; frame < FRAMES; ++frame)
+                    physics.OnUpdate(groupRegistry, DT); });
+            Report("physics, " + std::to_string(count) + " bodies, views", views, bodies, "bodies");
+            Report("physics, " + std::to_string(count) + " bodies, group x" + FormatSpeedup(views / group), group, bodies, "bodies");
+
+            // pairwise against the sweep over views is the pruning speedup, that against the sweep over the group the
+            // iteration one. The pairwise test is quadratic, it only runs where it finishes in reasonable time.
+            const std::string collisionsName = "collisions, " + std::to_string(count) + " bodies, ";
+            const bool pairwise = count <= 10000;
+            double pairwiseTime = 0.0;
+            if (pairwise)
+            {
+                pairwiseTime = Time(1, [&]
+                                    { collisionsOverViews(viewRegistry); });
+                Report(collisionsName + "pairwise over views", pairwiseTime, count, "bodies");
+            }
+            ViewSweep viewSweep;
+            viewSweep.Attach(viewRegistry);
+            CollisionSystem collisions;
+            collisions.OnAttach(groupRegistry);
+            double sweepViews = Time(1, [&]
+                                     { viewSweep.Update(viewRegistry); }); // both sorted on attach
+            double sweepGroup = Time(1, [&]
+                                     { collisions.OnUpdate(groupRegistry, DT); });
+            Report(collisionsName + "sweep over views" + (pairwise ? ", pruning x" + FormatSpeedup(pairwiseTime / sweepViews) : std::string()),
+                   sweepViews, count, "bodies");
+            Report(collisionsName + "sweep over the sorted group, iteration x" + FormatSpeedup(sweepViews / sweepGroup), sweepGroup, count, "bodies");
+
+            bool same = true;
+            size_t colliding = 0;
+            viewRegistry.view<ecs::RigidBody>().each([&](entt::entity e, const ecs::RigidBody &body)
+                                                    {
+                const ecs::RigidBody &other = groupRegistry.get<ecs::RigidBody>(e);
+                same &= body.velocity.x == other.velocity.x && body.velocity.y == other.velocity.y;
+                if (const ecs::Collidable *collidable = viewRegistry.try_get<ecs::Collidable>(e))
+                {
+                    same &= collidable->isColliding == groupRegistry.get<ecs::Collidable>(e).isColliding;
+                    colliding += collidable->isColliding;
+                } });
+            std::cout << "  " << colliding << " collidables touched" << std::endl;
+            ok &= Check(same, "the group systems disagree with the views at " + std::to_string(count) + " bodies");
+        }
+        return ok;
+    }
+
+    /// @brief boxes resting on platforms: tagging Grounded every frame against only when a contact begins or ends
+    static bool Contacts()
+    {
+        constexpr float DT = 1.0f / 60.0f;
+        constexpr int FRAMES = 60;
+
+        // one box per platform, overlapping it by a pixel, in a single row (a sweep along x can't prune columns)
+        auto populate = [](entt::registry &registry, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                const float x = static_cast<float>(i) * 40.0f, y = 0.0f;
+                const entt::entity platform = registry.create();
+                registry.emplace<ecs::RigidBody>(platform);
+                registry.emplace<::Rectangle>(platform, ::Rectangle{x, y + 20.0f, 32.0f, 8.0f});
+                registry.emplace<ecs::Collidable>(platform);
+                const entt::entity box = registry.create();
+                registry.emplace<ecs::RigidBody>(box);
+                registry.emplace<::Rectangle>(box, ::Rectangle{x + 10.0f, y + 9.0f, 12.0f, 12.0f});
+                registry.emplace<ecs::Collidable>(box);
+                registry.emplace<ecs::Droppable>(box);
+            }
+        };
+
+        // every structural change or replace of Grounded, and what it costs to raise
+        struct Changes
+        {
+            size_t count = 0;
+            void Changed(entt::registry &, entt::entity) { ++count; }
+        };
+        auto watch = [](entt::registry &registry, Changes &changes)
+        {
+            registry.on_construct<ecs::Grounded>().connect<&Changes::Changed>(changes);
+            registry.on_update<ecs::Grounded>().connect<&Changes::Changed>(changes);
+            registry.on_destroy<ecs::Grounded>().connect<&Changes::Changed>(changes);
+        };
+
+        // the tagging as it was: every droppable, every frame, from whether it touches anything right now
+        auto tagEveryFrame = [](entt::registry &registry)
+        {
+            registry.view<ecs::Droppable, ecs::Collidable>().each([&](entt::entity e, ecs::Droppable &, ecs::Collidable &collidable)
+                                                                  {
+                if (collidable.isColliding)
+                    registry.emplace_or_replace<ecs::Grounded>(e);
+                else
+                    registry.remove<ecs::Grounded>(e); });
+        };
+
+        bool ok = true;
+        for (int count : {1000, 10000, 100000})
+        {
+            entt::registry churnRegistry, cachedRegistry;
+            populate(churnRegistry, count);
+            populate(cachedRegistry, count);
+            CollisionSystem churnCollisions, cachedCollisions;
+            churnCollisions.OnAttach(churnRegistry);
+            cachedCollisions.OnAttach(cachedRegistry);
+            churnCollisions.OnUpdate(churnRegistry, DT); // contacts begin
+            cachedCollisions.OnUpdate(cachedRegistry, DT);
+            ok &= Check(cachedCollisions.Contacts().Began().size() == static_cast<size_t>(count) &&
+                            cachedRegistry.storage<ecs::Grounded>().size() == static_cast<size_t>(count),
+                        "every box should start a contact and be grounded at " + std::to_string(count));
+
+            Changes churn, cached;
+            watch(churnRegistry, churn);
+            watch(cachedRegistry, cached);
+            const double frames = static_cast<double>(count) * FRAMES;
+            double everyFrame = Time(1, [&]
+                                     {
+                for (int frame = 0; frame < FRAMES; ++frame)
+                {
+                    churnCollisions.OnUpdate(churnRegistry, DT);
+                    tagEveryFrame(churnRegistry);
+                } });
+            double transitions = Time(1, [&]
+                                      {
+                for (int frame = 0; frame < FRAMES; ++frame)
+                    cachedCollisions.OnUpdate(cachedRegistry, DT); });
+            Report("resting, " + std::to_string(count) + " boxes, tagged every frame", everyFrame, frames, "boxes");
+            Report("resting, " + std::to_string(count) + " boxes, tagged on transitions x" + FormatSpeedup(everyFrame / transitions), transitions, frames, "boxes");
+            std::cout << "  Grounded changes per frame: " << churn.count / FRAMES << " every frame, " << cached.count / FRAMES << " on transitions" << std::endl;
+            ok &= Check(cached.count == 0 && cachedCollisions.Contacts().Stayed().size() == static_cast<size_t>(count),
+                        "resting boxes should keep their contacts without touching Grounded at " + std::to_string(count));
+
+            // pull every other platform away: those boxes lose their contact, flags and tag, the rest keep theirs
+            size_t pulled = 0;
+            cachedRegistry.view<::Rectangle, ecs::Collidable>(entt::exclude<ecs::Droppable>).each([&](::Rectangle &rect, ecs::Collidable &)
+                                                                                                  {
+                if (pulled++ % 2 == 0)
+                    rect.y += 1000000.0f; });
+            cachedCollisions.OnUpdate(cachedRegistry, DT);
+            const size_t ended = cachedCollisions.Contacts().Ended().size();
+            bool consistent = true;
+            cachedRegistry.view<ecs::Collidable>().each([&](entt::entity e, const ecs::Collidable &collidable)
+                                                        {
+                consistent &= collidable.isColliding == (collidable.contacts > 0) && collidable.contacts <= 1;
+                if (cachedRegistry.all_of<ecs::Droppable>(e))
+                    consistent &= collidable.isColliding == cachedRegistry.all_of<ecs::Grounded>(e); });
+            ok &= Check(consistent && ended == (pulled + 1) / 2 && cached.count == ended &&
+                            cachedRegistry.storage<ecs::Grounded>().size() == static_cast<size_t>(count) - ended,
+                        "pulled platforms should end exactly their contacts at " + std::to_string(count));
+        }
+        return ok;
+    }
+
+    /// @brief rotated boxes: the batched SAT test against one pair at a time, a box tumbling flat and piles in a bin
+    static bool Boxes()
+    {
+        constexpr float DT = 1.0f / 60.0f;
+        bool ok = true;
+
+        // boxes close enough to overlap about half the time, every rotation
+        {
+            constexpr size_t PAIRS = size_t{1} << 20;
+            BoxPairBatch batched, single;
+            uint64_t rng = 29;
+            auto random = [&rng]
+            {
+                rng = TileGenerator::Mix(rng);
+                return static_cast<float>(rng % 65536) / 65536.0f;
+            };
+            auto box = [&]
+            {
+                const float angle = random() * 2.0f * PI;
+                const float x = random() * 3.0f, y = random() * 3.0f, halfWidth = 0.1f + random(), halfHeight = 0.1f + random();
+                return OrientedBox{x, y, halfWidth, halfHeight, std::cos(angle), std::sin(angle)};
+            };
+            for (size_t i = 0; i < PAIRS; ++i)
+            {
+                const OrientedBox a = box();
+                const OrientedBox b = box();
+                batched.Add(a, b);
+                single.Add(a, b);
+            }
+            double lanes = Time(5, [&]
+                                { batched.Test(); });
+            double pairs = Time(5, [&]
+                                { single.TestScalar(0, single.Size()); });
+            Report("sat, a pair at a time", pairs, PAIRS, "pairs");
+            Report(std::string("sat, ") + (BOXES_SSE ? "4 pairs per instruction" : "scalar build") + " x" + FormatSpeedup(pairs / lanes), lanes, PAIRS, "pairs");
+
+            bool same = true;
+            size_t touching = 0;
+            for (size_t i = 0; i < PAIRS; ++i)
+            {
+                same &= batched.Depth(i) == single.Depth(i) && batched.FaceOfB(i) == single.FaceOfB(i) &&
+                        batched.Normal(i).x == single.Normal(i).x && batched.Normal(i).y == single.Normal(i).y;
+                touching += batched.Depth(i) >= 0.0f;
+            }
+            std::cout << "  " << touching << " of " << PAIRS << " pairs overlap" << std::endl;
+            ok &= Check(same, "the batched SAT test disagrees with the pair at a time one");
+
+            // side by side, a diamond standing on a corner, and two diamonds whose bounds overlap but they don't
+            const float diagonal = std::sqrt(2.0f), half = diagonal * 0.5f;
+            BoxPairBatch known;
+            known.Add({0.0f, 0.0f, 1.0f, 1.0f}, {1.9f, 0.0f, 1.0f, 1.0f});
+            known.Add({0.0f, 0.0f, 1.0f, 1.0f}, {0.0f, 1.0f + diagonal - 0.05f, 1.0f, 1.0f, half, half});
+            known.Add({0.0f, 0.0f, 1.0f, 1.0f, half, half}, {1.5f, 1.5f, 1.0f, 1.0f, half, half});
+            known.Test();
+            auto near = [](float a, float b)
+            { return std::abs(a - b) < 1e-4f; };
+            ok &= Check(near(known.Depth(0), 0.1f) && near(known.Normal(0).x, 1.0f) && near(known.Normal(0).y, 0.0f) &&
+                            near(known.Depth(1), 0.05f) && near(known.Normal(1).y, 1.0f) && !known.FaceOfB(1) &&
+                            near(known.Depth(2), 2.0f - 1.5f * diagonal),
+                        "the SAT test gets a hand-worked case wrong");
+            const BoxManifold corner = ClipBoxes({0.0f, 0.0f, 1.0f, 1.0f}, {0.0f, 1.0f + diagonal - 0.05f, 1.0f, 1.0f, half, half}, known.Normal(1), known.FaceOfB(1));
+            const BoxManifold flat = ClipBoxes({0.0f, 0.0f, 1.0f, 1.0f}, {0.5f, 1.95f, 1.0f, 1.0f}, {0.0f, 1.0f}, false);
+            ok &= Check(corner.count == 1 && near(corner.points[0].x, 0.0f) && near(corner.depths[0], 0.05f) &&
+                            flat.count == 2 && near(flat.depths[0], 0.05f) && near(flat.depths[1], 0.05f) &&
+                            near(std::min(flat.points[0].x, flat.points[1].x), -0.5f) && near(std::max(flat.points[0].x, flat.points[1].x), 1.0f),
+                        "a corner should touch at one point and a face at the two ends of the overlap");
+        }
+
+        // fixed obstacles in pixels, a floor at FLOOR and walls either side of [0, width]
+        constexpr float FLOOR = 800.0f;
+        auto obstacle = [](entt::registry &registry, ::Rectangle rect)
+        {
+            const entt::entity e = registry.create();
+            registry.emplace<ecs::RigidBody>(e);
+            registry.emplace<::Rectangle>(e, rect);
+            registry.emplace<ecs::Collidable>(e);
+        };
+        auto crate = [](entt::registry &registry, float x, float y, float width, float height, float rotation, float spin)
+        {
+            const float pixelsPerMeter = BoxSystem::Settings{}.pixelsPerMeter;
+            const entt::entity e = registry.create();
+            ecs::RigidBody &body = registry.emplace<ecs::RigidBody>(e);
+            body.setMass(width * height / (pixelsPerMeter * pixelsPerMeter));
+            body.setMomentOfInertia(BoxSystem::BoxInertia(body.mass, width / pixelsPerMeter, height / pixelsPerMeter));
+            body.angularVelocity = spin;
+            registry.emplace<::Rectangle>(e, ::Rectangle{x - width * 0.5f, y - height * 0.5f, width, height});
+            registry.emplace<ecs::Transform2D>(e, ecs::Transform2D{{x, y}, {1.0f, 1.0f}, rotation});
+            registry.emplace<ecs::Collidable>(e);
+            return e;
+        };
+
+        // a box dropped on its corner has to tip over and come to rest on a face; as the game's droppable box it is
+        // Grounded once it lands, loses that when thrown up and gets it back when it comes down again
+        {
+            entt::registry registry;
+            registry.ctx().emplace<ecs::Gravity>();
+            obstacle(registry, {0.0f, FLOOR, 2000.0f, 40.0f});
+            const entt::entity box = crate(registry, 1000.0f, FLOOR - 100.0f, 40.0f, 40.0f, 30.0f, 0.0f);
+            registry.emplace<ecs::Droppable>(box, true);
+            PhysicsSystem physics;
+            CollisionSystem collisions;
+            BoxSystem boxes;
+            physics.OnAttach(registry);
+            collisions.OnAttach(registry);
+            boxes.OnAttach(registry);
+            auto step = [&]
+            {
+                physics.OnUpdate(registry, DT);
+                collisions.OnUpdate(registry, DT);
+                boxes.OnUpdate(registry, DT);
+            };
+            float spin = 0.0f;
+            for (int frame = 0; frame < 300; ++frame)
+            {
+                step();
+                spin = std::max(spin, std::abs(registry.get<ecs::RigidBody>(box).angularVelocity));
+            }
+            const bool landed = registry.all_of<ecs::Grounded>(box);
+            registry.get<ecs::RigidBody>(box).velocity.y = -5.0f;
+            bool lifted = false;
+            for (int frame = 0; frame < 300; ++frame)
+            {
+                step();
+                lifted |= !registry.all_of<ecs::Grounded>(box);
+            }
+            ok &= Check(landed && lifted && registry.all_of<ecs::Grounded>(box), "the dropped box should be Grounded while it rests, and only then");
+            const ecs::Transform2D &transform = registry.get<ecs::Transform2D>(box);
+            const ecs::RigidBody &body = registry.get<ecs::RigidBody>(box);
+            std::cout << "  tumbling box: spun up to " << spin << " rad/s, rests at " << transform.rotation << " degrees, "
+                      << FLOOR - transform.position.y - 20.0f << " px off the floor" << std::endl;
+            ok &= Check(spin > 1.0f && std::abs(std::remainder(transform.rotation, 90.0f)) < 1.0f &&
+                            std::abs(body.angularVelocity) < 0.05f && std::abs(FLOOR - transform.position.y - 20.0f) < 1.0f,
+                        "a box landing on its corner should tip onto a face and rest on the floor");
+        }
+
+        // crates of mixed sizes and rotations dropped into a bin in columns twenty high
+        for (int count : {100, 1000, 4000})
+        {
+            constexpr int FRAMES = 300;
+            constexpr int LAYERS = 20;
+            const int columns = count / LAYERS;
+            const float width = static_cast<float>(columns) * 40.0f;
+
+            entt::registry registry;
+            registry.ctx().emplace<ecs::Gravity>();
+            obstacle(registry, {-40.0f, FLOOR, width + 80.0f, 40.0f});
+            obstacle(registry, {-40.0f, 0.0f, 40.0f, FLOOR});
+            obstacle(registry, {width, 0.0f, 40.0f, FLOOR});
+            uint64_t rng = 31;
+            for (int i = 0; i < count; ++i)
+            {
+                rng = TileGenerator::Mix(rng);
+                const float size = 12.0f + static_cast<float>(rng % 18), aspect = 0.6f + static_cast<float>((rng >> 8) % 64) / 80.0f;
+                crate(registry, 20.0f + static_cast<float>(i % columns) * 40.0f, FLOOR - 20.0f - static_cast<float>(i / columns) * 38.0f,
+                      size * aspect, size, static_cast<float>((rng >> 16) % 360), static_cast<float>((rng >> 32) % 64) / 16.0f - 2.0f);
+            }
+
+            PhysicsSystem physics;
+            BoxSystem boxes;
+            physics.OnAttach(registry);
+            boxes.OnAttach(registry);
+            size_t candidates = 0, touching = 0;
+            double time = Time(1, [&]
+                               {
+                for (int frame = 0; frame < FRAMES; ++frame)
+                {
+                    physics.OnUpdate(registry, DT);
+                    boxes.OnUpdate(registry, DT);
+                    candidates += boxes.Candidates();
+                    touching += boxes.Contacts().Size();
+                } });
+            Report("pile, " + std::to_string(count) + " crates", time / FRAMES, count, "crates");
+            std::cout << "  per update: " << candidates / FRAMES << " candidate pairs, " << touching / FRAMES << " touching" << std::endl;
+
+            bool inside = true;
+            float speed = 0.0f;
+            registry.view<const ecs::Transform2D, const ecs::RigidBody>().each([&](const ecs::Transform2D &transform, const ecs::RigidBody &body)
+                                                                              {
+                inside &= std::isfinite(transform.position.x) && std::isfinite(transform.position.y) && std::isfinite(transform.rotation);
+                inside &= transform.position.x > 0.0f && transform.position.x < width && transform.position.y < FLOOR;
+                speed += std::sqrt(body.velocity.x * body.velocity.x + body.velocity.y * body.velocity.y); });
+            std::cout << "  mean speed after " << FRAMES << " updates: " << speed / static_cast<float>(count) << " m/s" << std::endl;
+            ok &= Check(inside, "crates should stay finite and inside the bin at " + std::to_string(count));
+            ok &= Check(speed / static_cast<float>(count) < 0.1f, "the pile should have settled at " + std::to_string(count));
+        }
+        return ok;
+    }
+};
+
+/// @brief run the benchmarks whose name contains filter (all if it is empty); checkOnly runs their checks without timings
+/// @return false if any self-check failed
+inline bool RunBenchmarks(const std::string &filter, bool updateGolden = false, bool checkOnly = false)
+{
+    Benchmark::updateGolden = updateGolden;
+    Benchmark::checkOnly = checkOnly;
+    struct Entry
+    {
+        const char *name;
+        bool (*run)();
+    };
+    static const Entry benchmarks[] = {
+        {"generation", &Benchmark::TileGeneration},
+        {"pathfinding", &Benchmark::Pathfinding},
+        {"agents", &Benchmark::Crowd},
+        {"particles", &Benchmark::Particles},
+        {"jobs", &Benchmark::Jobs},
+        {"arena", &Benchmark::FrameScratch},
+        {"render", &Benchmark::Render},
+        {"sand", &Benchmark::Sand},
+        {"groups", &Benchmark::Groups},
+        {"contacts", &Benchmark::Contacts},
+        {"boxes", &Benchmark::Boxes},
+    };
+
+    bool ok = true;
+    for (const Entry &entry : benchmarks)
+    {
+        if (!filter.empty() && std::string(entry.name).find(filter) == std::string::npos)
+            continue;
+        std::cout << entry.name << std::endl;
+        const AllocTracker::Stats before = AllocTracker::Pending();
+        ok &= entry.run();
+        if constexpr (AllocTracker::ENABLED)
+        {
+            const AllocTracker::Stats after = AllocTracker::Pending();
+            std::cout << "  allocations: " << after.count - before.count << ", " << after.bytes - before.bytes << " bytes" << std::endl;
+        }
+    }
+    return ok;
+}
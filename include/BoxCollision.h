@@ -0,0 +1,243 @@
+/**
+ * @file BoxCollision.h
+ * @brief Rotated-box overlap tests over batches of pairs with SIMD, and the contact points of an overlapping pair.
+ * @date 2025-08-10
+ * @details Two boxes overlap unless one of their four face axes separates them (the separating axis theorem).
+ * BoxPairBatch holds candidate pairs as one array per attribute, padded to a multiple of 4, and Test() runs the
+ * four axis tests on 4 pairs per instruction with SSE where the compiler targets it, in scalar code with the
+ * same arithmetic elsewhere. The result per pair is the axis of least overlap: the depth, the normal pointing
+ * from the first box to the second and which box's face it is.
+ *
+ * Only overlapping pairs need contact points. ClipBoxes() takes the face the test picked as the reference face
+ * and clips the most opposed face of the other box against its sides, which gives two points for a box lying
+ * flat on another and one for a box landing on its corner.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <raylib.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BOXES_SSE 1
+#else
+#define BOXES_SSE 0
+#endif
+
+/// @brief a box by its centre, half extents and the cosine and sine of its rotation
+struct OrientedBox
+{
+    float x, y;
+    float halfWidth, halfHeight;
+    float cos = 1.0f, sin = 0.0f;
+};
+
+/// @brief up to two points where a pair of boxes touch, with the normal from the first box to the second
+struct BoxManifold
+{
+    Vector2 normal;
+    Vector2 points[2];
+    float depths[2];
+    int count = 0;
+};
+
+class BoxPairBatch
+{
+public:
+    static constexpr size_t LANES = 4; // pairs per SIMD step, the arrays are padded to a multiple of it
+
+    void Clear() { m_size = 0; }
+
+    /// @return the pair's index, to read its result with after Test()
+    size_t Add(const OrientedBox &a, const OrientedBox &b)
+    {
+        if (m_size == m_ax.size())
+            Grow();
+        const size_t i = m_size++;
+        m_ax[i] = a.x, m_ay[i] = a.y, m_ahw[i] = a.halfWidth, m_ahh[i] = a.halfHeight, m_ac[i] = a.cos, m_as[i] = a.sin;
+        m_bx[i] = b.x, m_by[i] = b.y, m_bhw[i] = b.halfWidth, m_bhh[i] = b.halfHeight, m_bc[i] = b.cos, m_bs[i] = b.sin;
+        return i;
+    }
+
+    size_t Size() const { return m_size; }
+
+    /// @brief pairs rounded up to whole SIMD steps; Test() ranges start and end on multiples of LANES
+    size_t Padded() const { return (m_size + LANES - 1) / LANES * LANES; }
+
+    /// @brief test pairs [begin, end), both multiples of LANES (end may be Padded())
+    void Test(size_t begin, size_t end)
+    {
+#if BOXES_SSE
+        for (size_t i = begin; i < end; i += LANES)
+            TestLanes(i);
+#else
+        TestScalar(begin, end);
+#endif
+    }
+    void Test() { Test(0, Padded()); }
+
+    /// @brief the same tests one pair at a time
+    void TestScalar(size_t begin, size_t end)
+    {
+        for (size_t i = begin; i < end; ++i)
+            TestPair(i);
+    }
+
+    /// @brief how far the pair overlaps along the normal, negative if they're apart
+    float Depth(size_t i) const { return m_depth[i]; }
+    Vector2 Normal(size_t i) const { return {m_nx[i], m_ny[i]}; }
+    /// @brief true if the normal is a face of the second box rather than of the first
+    bool FaceOfB(size_t i) const { return m_faceOfB[i] != 0.0f; }
+
+private:
+    void Grow()
+    {
+        const size_t capacity = std::max<size_t>(LANES * 64, m_ax.size() * 2); // stays a multiple of LANES
+        for (std::vector<float> *array : {&m_ax, &m_ay, &m_ahw, &m_ahh, &m_ac, &m_as, &m_bx, &m_by, &m_bhw, &m_bhh, &m_bc, &m_bs,
+                                          &m_depth, &m_nx, &m_ny, &m_faceOfB})
+            array->resize(capacity, 0.0f); // lanes past Size() hold zeros or an earlier batch's pairs, their results are ignored
+    }
+
+    // faces of a preferred only if b's overlap is less by a margin, so resting contacts don't flip between the two
+    static constexpr float FACE_BIAS = 0.95f;
+
+    void TestPair(size_t i)
+    {
+        const float dx = m_bx[i] - m_ax[i], dy = m_by[i] - m_ay[i];
+        const float c = std::abs(m_ac[i] * m_bc[i] + m_as[i] * m_bs[i]); // |cos| and |sin| of the relative rotation
+        const float s = std::abs(m_ac[i] * m_bs[i] - m_as[i] * m_bc[i]);
+
+        const float da0 = dx * m_ac[i] + dy * m_as[i], da1 = dy * m_ac[i] - dx * m_as[i]; // offset along a's axes
+        const float db0 = dx * m_bc[i] + dy * m_bs[i], db1 = dy * m_bc[i] - dx * m_bs[i]; // and along b's
+        const float oa0 = m_ahw[i] + (m_bhw[i] * c + m_bhh[i] * s) - std::abs(da0);
+        const float oa1 = m_ahh[i] + (m_bhw[i] * s + m_bhh[i] * c) - std::abs(da1);
+        const float ob0 = m_bhw[i] + (m_ahw[i] * c + m_ahh[i] * s) - std::abs(db0);
+        const float ob1 = m_bhh[i] + (m_ahw[i] * s + m_ahh[i] * c) - std::abs(db1);
+
+        // least overlap of each box's two axes, the axis flipped to point from a to b
+        const bool a1 = oa1 < oa0, b1 = ob1 < ob0;
+        const float oa = a1 ? oa1 : oa0, ob = b1 ? ob1 : ob0;
+        const float da = a1 ? da1 : da0, db = b1 ? db1 : db0;
+        float nax = a1 ? -m_as[i] : m_ac[i], nay = a1 ? m_ac[i] : m_as[i];
+        float nbx = b1 ? -m_bs[i] : m_bc[i], nby = b1 ? m_bc[i] : m_bs[i];
+        if (std::signbit(da))
+            nax = -nax, nay = -nay;
+        if (std::signbit(db))
+            nbx = -nbx, nby = -nby;
+
+        const bool useB = ob < oa * FACE_BIAS;
+        m_depth[i] = useB ? ob : oa;
+        m_nx[i] = useB ? nbx : nax;
+        m_ny[i] = useB ? nby : nay;
+        m_faceOfB[i] = useB ? 1.0f : 0.0f;
+    }
+
+#if BOXES_SSE
+    static __m128 Select(__m128 mask, __m128 ifSet, __m128 otherwise)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, ifSet), _mm_andnot_ps(mask, otherwise));
+    }
+
+    void TestLanes(size_t i)
+    {
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 ac = _mm_loadu_ps(&m_ac[i]), as = _mm_loadu_ps(&m_as[i]);
+        const __m128 bc = _mm_loadu_ps(&m_bc[i]), bs = _mm_loadu_ps(&m_bs[i]);
+        const __m128 ahw = _mm_loadu_ps(&m_ahw[i]), ahh = _mm_loadu_ps(&m_ahh[i]);
+        const __m128 bhw = _mm_loadu_ps(&m_bhw[i]), bhh = _mm_loadu_ps(&m_bhh[i]);
+        const __m128 dx = _mm_sub_ps(_mm_loadu_ps(&m_bx[i]), _mm_loadu_ps(&m_ax[i]));
+        const __m128 dy = _mm_sub_ps(_mm_loadu_ps(&m_by[i]), _mm_loadu_ps(&m_ay[i]));
+        const __m128 c = _mm_andnot_ps(sign, _mm_add_ps(_mm_mul_ps(ac, bc), _mm_mul_ps(as, bs)));
+        const __m128 s = _mm_andnot_ps(sign, _mm_sub_ps(_mm_mul_ps(ac, bs), _mm_mul_ps(as, bc)));
+
+        const __m128 da0 = _mm_add_ps(_mm_mul_ps(dx, ac), _mm_mul_ps(dy, as)), da1 = _mm_sub_ps(_mm_mul_ps(dy, ac), _mm_mul_ps(dx, as));
+        const __m128 db0 = _mm_add_ps(_mm_mul_ps(dx, bc), _mm_mul_ps(dy, bs)), db1 = _mm_sub_ps(_mm_mul_ps(dy, bc), _mm_mul_ps(dx, bs));
+        const __m128 oa0 = _mm_sub_ps(_mm_add_ps(ahw, _mm_add_ps(_mm_mul_ps(bhw, c), _mm_mul_ps(bhh, s))), _mm_andnot_ps(sign, da0));
+        const __m128 oa1 = _mm_sub_ps(_mm_add_ps(ahh, _mm_add_ps(_mm_mul_ps(bhw, s), _mm_mul_ps(bhh, c))), _mm_andnot_ps(sign, da1));
+        const __m128 ob0 = _mm_sub_ps(_mm_add_ps(bhw, _mm_add_ps(_mm_mul_ps(ahw, c), _mm_mul_ps(ahh, s))), _mm_andnot_ps(sign, db0));
+        const __m128 ob1 = _mm_sub_ps(_mm_add_ps(bhh, _mm_add_ps(_mm_mul_ps(ahw, s), _mm_mul_ps(ahh, c))), _mm_andnot_ps(sign, db1));
+
+        const __m128 a1 = _mm_cmplt_ps(oa1, oa0), b1 = _mm_cmplt_ps(ob1, ob0);
+        const __m128 oa = Select(a1, oa1, oa0), ob = Select(b1, ob1, ob0);
+        const __m128 flipA = _mm_and_ps(Select(a1, da1, da0), sign), flipB = _mm_and_ps(Select(b1, db1, db0), sign);
+        const __m128 nax = _mm_xor_ps(Select(a1, _mm_xor_ps(as, sign), ac), flipA), nay = _mm_xor_ps(Select(a1, ac, as), flipA);
+        const __m128 nbx = _mm_xor_ps(Select(b1, _mm_xor_ps(bs, sign), bc), flipB), nby = _mm_xor_ps(Select(b1, bc, bs), flipB);
+
+        const __m128 useB = _mm_cmplt_ps(ob, _mm_mul_ps(oa, _mm_set1_ps(FACE_BIAS)));
+        _mm_storeu_ps(&m_depth[i], Select(useB, ob, oa));
+        _mm_storeu_ps(&m_nx[i], Select(useB, nbx, nax));
+        _mm_storeu_ps(&m_ny[i], Select(useB, nby, nay));
+        _mm_storeu_ps(&m_faceOfB[i], _mm_and_ps(useB, _mm_set1_ps(1.0f)));
+    }
+#endif
+
+    size_t m_size = 0;
+    std::vector<float> m_ax, m_ay, m_ahw, m_ahh, m_ac, m_as; // first box of each pair
+    std::vector<float> m_bx, m_by, m_bhw, m_bhh, m_bc, m_bs; // second box
+    std::vector<float> m_depth, m_nx, m_ny, m_faceOfB;       // results
+};
+
+/// @brief contact points of two overlapping boxes from the normal and face a BoxPairBatch test picked
+inline BoxManifold ClipBoxes(const OrientedBox &a, const OrientedBox &b, Vector2 normal, bool faceOfB)
+{
+    auto dot = [](Vector2 u, Vector2 v)
+    { return u.x * v.x + u.y * v.y; };
+
+    // reference face: the picked face, with its outward normal n pointing at the other (incident) box
+    const OrientedBox &reference = faceOfB ? b : a;
+    const OrientedBox &incident = faceOfB ? a : b;
+    const Vector2 n = faceOfB ? Vector2{-normal.x, -normal.y} : normal;
+    const Vector2 ru = {reference.cos, reference.sin}, rv = {-reference.sin, reference.cos};
+    const bool alongU = std::abs(dot(n, ru)) > std::abs(dot(n, rv));
+    const float front = alongU ? reference.halfWidth : reference.halfHeight; // centre to the face
+    const float side = alongU ? reference.halfHeight : reference.halfWidth;  // centre of the face to its ends
+    const Vector2 tangent = alongU ? rv : ru;
+    const float faceOffset = dot(n, {reference.x, reference.y}) + front;
+    const float tangentCentre = dot(tangent, {reference.x, reference.y});
+
+    // incident face: the one of the other box facing most against n
+    const Vector2 iu = {incident.cos, incident.sin}, iv = {-incident.sin, incident.cos};
+    const float du = dot(n, iu), dv = dot(n, iv);
+    const bool incidentU = std::abs(du) > std::abs(dv);
+    const Vector2 axis = incidentU ? iu : iv;
+    const float toward = (incidentU ? du : dv) > 0.0f ? -1.0f : 1.0f; // face normal -n-ish
+    const float depth = incidentU ? incident.halfWidth : incident.halfHeight;
+    const Vector2 edge = incidentU ? iv : iu;
+    const float half = incidentU ? incident.halfHeight : incident.halfWidth;
+    const Vector2 centre = {incident.x + axis.x * depth * toward, incident.y + axis.y * depth * toward};
+    Vector2 points[2] = {{centre.x + edge.x * half, centre.y + edge.y * half}, {centre.x - edge.x * half, centre.y - edge.y * half}};
+
+    // clip the incident face to the reference face's sides: keep dot(direction, p) <= offset
+    auto clip = [&](Vector2 direction, float offset)
+    {
+        const float d0 = dot(direction, points[0]) - offset, d1 = dot(direction, points[1]) - offset;
+        if (d0 > 0.0f && d1 > 0.0f)
+            return false;
+        const Vector2 p0 = points[0], p1 = points[1];
+        if (d0 > 0.0f)
+            points[0] = {p0.x + (p1.x - p0.x) * d0 / (d0 - d1), p0.y + (p1.y - p0.y) * d0 / (d0 - d1)};
+        else if (d1 > 0.0f)
+            points[1] = {p1.x + (p0.x - p1.x) * d1 / (d1 - d0), p1.y + (p0.y - p1.y) * d1 / (d1 - d0)};
+        return true;
+    };
+    BoxManifold manifold;
+    manifold.normal = normal;
+    if (!clip(tangent, tangentCentre + side) || !clip({-tangent.x, -tangent.y}, side - tangentCentre))
+        return manifold;
+
+    // points behind the reference face touch; the depth is how far behind
+    for (const Vector2 &point : points)
+    {
+        const float separation = dot(n, point) - faceOffset;
+        if (separation > 0.0f)
+            continue;
+        manifold.points[manifold.count] = point;
+        manifold.depths[manifold.count++] = -separation;
+    }
+    return manifold;
+}
@@ -12,6 +12,9 @@ extern "C"
     #include <raylib.h> // Include raylib for graphics
 }
 
+#include "Log.h"
+#include "AssetArchive.h"
+
 namespace ecs
 {
     struct Vec2D
@@ -53,6 +56,12 @@ namespace ecs
             mass = m;
             inverseMass = (mass == 0.0f) ? 0.0f : 1.0f / mass; // prevent division by zero
         }
+
+        void setMomentOfInertia(float moment)
+        {
+            momentOfInertia = moment;
+            inverseMomentOfInertia = (moment == 0.0f) ? 0.0f : 1.0f / moment; // 0 never spins
+        }
     };
 
     struct Draggable{
@@ -78,7 +87,8 @@ namespace ecs
 
     struct Collidable
     {
-        bool isColliding = false;
+        bool isColliding = false; // touching at least one other body
+        int contacts = 0;         // how many, both kept by the collision system's contact manager
     };
 
     struct Gravity
@@ -105,11 +115,11 @@ namespace ecs
 
         TextureComponent(const char *texturePath,
                          Rectangle srcRect = {0, 0, 0, 0})
-            : texture(LoadTexture(texturePath)), sourceRect(srcRect)
+            : texture(LoadAssetTexture(texturePath)), sourceRect(srcRect)
         {
             if (texture.id == 0) // Check if texture loaded successfully
             {
-                fprintf(stderr, "Failed to load texture: %s\n", texturePath);
+                Log::Error("Failed to load texture: {}", texturePath);
             }
         }
         ~TextureComponent()
@@ -131,7 +141,7 @@ namespace ecs
         {
             if (frameCount <= 0)
             {
-                fprintf(stderr, "Invalid frame count: %d\n", frameCount);
+                Log::Error("Invalid frame count: {}", frameCount);
                 exit(EXIT_FAILURE);
             }
         }
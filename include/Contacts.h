@@ -0,0 +1,87 @@
+/**
+ * @file Contacts.h
+ * @brief Persistent cache of touching body pairs, turned into begin, stay and end contact events each update.
+ * @date 2025-08-09
+ * @details A narrow phase reports every pair it finds touching between Begin() and End(). End() sorts the pairs
+ * and merges them with the previous update's: pairs only in the new list began, pairs in both stayed, pairs only
+ * in the old list ended. Whatever hangs off a contact (flags, tag components, effects) is updated from Began()
+ * and Ended() alone, so bodies resting on each other cost no registry changes frame after frame.
+ *
+ * Pairs are keyed by their entity ids including the version, so a destroyed body's pairs end on the next update
+ * and a recycled id never inherits them. The lists keep their capacity, steady-state updates don't allocate.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <raylib.h>
+#include <entt/entt.hpp>
+
+/// @brief two bodies touching, in the roles the narrow phase reported them in
+struct Contact
+{
+    entt::entity a;
+    entt::entity b;
+    Vector2 point; // where they touched, as reported when the contact began or was last seen
+};
+
+class ContactManager
+{
+public:
+    /// @brief start collecting this update's pairs
+    void Begin() { m_current.clear(); }
+
+    /// @brief report a touching pair; a pair reported twice in one update counts once
+    void Add(entt::entity a, entt::entity b, Vector2 point) { m_current.push_back({a, b, point}); }
+
+    /// @brief diff this update's pairs against the last one's into Began(), Stayed() and Ended()
+    void End()
+    {
+        std::sort(m_current.begin(), m_current.end(), KeyLess);
+        m_current.erase(std::unique(m_current.begin(), m_current.end(), [](const Contact &x, const Contact &y)
+                                    { return Key(x) == Key(y); }),
+                        m_current.end());
+
+        m_began.clear();
+        m_stayed.clear();
+        m_ended.clear();
+        size_t previous = 0, current = 0;
+        while (previous < m_previous.size() || current < m_current.size())
+        {
+            if (current == m_current.size() || (previous < m_previous.size() && KeyLess(m_previous[previous], m_current[current])))
+                m_ended.push_back(m_previous[previous++]);
+            else if (previous == m_previous.size() || KeyLess(m_current[current], m_previous[previous]))
+                m_began.push_back(m_current[current++]);
+            else
+            {
+                m_stayed.push_back(m_current[current++]);
+                ++previous;
+            }
+        }
+        std::swap(m_previous, m_current);
+    }
+
+    const std::vector<Contact> &Began() const { return m_began; }
+    const std::vector<Contact> &Stayed() const { return m_stayed; }
+    const std::vector<Contact> &Ended() const { return m_ended; }
+
+    /// @brief pairs touching as of the last End()
+    size_t Size() const { return m_previous.size(); }
+
+private:
+    static uint64_t Key(const Contact &contact)
+    {
+        return static_cast<uint64_t>(entt::to_integral(contact.a)) << 32 | entt::to_integral(contact.b);
+    }
+    static bool KeyLess(const Contact &x, const Contact &y) { return Key(x) < Key(y); }
+
+    std::vector<Contact> m_previous; // touching as of the last End(), sorted by key
+    std::vector<Contact> m_current;  // reported since Begin()
+    std::vector<Contact> m_began;
+    std::vector<Contact> m_stayed;
+    std::vector<Contact> m_ended;
+};
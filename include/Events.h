@@ -0,0 +1,137 @@
+/**
+ * @file Events.h
+ * @brief Typed, allocation-free event queues dispatched at explicit sync points.
+ * @date 2025-07-21
+ * @details Producers (GUI components, systems) Enqueue() events while a frame runs. Nothing is called until the
+ * owner calls Dispatch(), which delivers every queued event, one type at a time, to the listeners connected
+ * with Subscribe(). Queues and listener lists are fixed-size arrays and listeners are entt::delegates, so
+ * neither enqueueing nor dispatching touches the heap.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+
+#include <entt/entt.hpp>
+
+#include "Log.h"
+
+/// @brief fixed capacity FIFO of events of a single type
+template <typename Event, size_t Capacity = 64>
+class EventQueue
+{
+public:
+    /// @return false if the queue is full and the event was dropped
+    bool Push(const Event &event)
+    {
+        if (m_count == Capacity)
+            return false;
+        m_events[m_count++] = event;
+        return true;
+    }
+
+    size_t Size() const { return m_count; }
+    bool Empty() const { return m_count == 0; }
+    void Clear() { m_count = 0; }
+
+    const Event &operator[](size_t index) const { return m_events[index]; }
+    const Event *begin() const { return m_events.data(); }
+    const Event *end() const { return m_events.data() + m_count; }
+
+private:
+    std::array<Event, Capacity> m_events{};
+    size_t m_count = 0;
+};
+
+/// @brief queue plus listeners for one event type
+template <typename Event, size_t Capacity = 64, size_t MaxListeners = 8>
+class EventChannel
+{
+public:
+    using Listener = entt::delegate<void(const Event &)>;
+
+    void Enqueue(const Event &event)
+    {
+        if (!m_queue.Push(event) && !m_overflowReported)
+        {
+            m_overflowReported = true;
+            Log::Warn("Event queue full, dropping events of type {}", entt::type_id<Event>().name());
+        }
+    }
+
+    template <auto Candidate, typename Instance>
+    void Subscribe(Instance &instance)
+    {
+        if (m_listenerCount == MaxListeners)
+        {
+            Log::Error("Too many listeners for event type {}", entt::type_id<Event>().name());
+            return;
+        }
+        m_listeners[m_listenerCount++].template connect<Candidate>(instance);
+    }
+
+    void UnsubscribeAll() { m_listenerCount = 0; }
+
+    /// @brief deliver queued events in order. Events enqueued by listeners are delivered in the same pass.
+    void Dispatch()
+    {
+        for (size_t i = 0; i < m_queue.Size(); ++i)
+        {
+            for (size_t l = 0; l < m_listenerCount; ++l)
+                m_listeners[l](m_queue[i]);
+        }
+        m_queue.Clear();
+    }
+
+    const EventQueue<Event, Capacity> &Pending() const { return m_queue; }
+    void Discard() { m_queue.Clear(); }
+
+private:
+    EventQueue<Event, Capacity> m_queue;
+    std::array<Listener, MaxListeners> m_listeners{};
+    size_t m_listenerCount = 0;
+    bool m_overflowReported = false;
+};
+
+/// @brief one channel per event type, all flushed by a single Dispatch() call
+template <typename... Events>
+class EventBus
+{
+public:
+    template <typename Event>
+    void Enqueue(const Event &event)
+    {
+        Channel<Event>().Enqueue(event);
+    }
+
+    /// @brief connect a free function or member function taking `const Event &`
+    template <typename Event, auto Candidate, typename Instance>
+    void Subscribe(Instance &instance)
+    {
+        Channel<Event>().template Subscribe<Candidate>(instance);
+    }
+
+    /// @brief sync point: deliver everything queued since the last call, event types in declaration order
+    void Dispatch()
+    {
+        std::apply([](auto &...channels)
+                   { (channels.Dispatch(), ...); }, m_channels);
+    }
+
+    void UnsubscribeAll()
+    {
+        std::apply([](auto &...channels)
+                   { (channels.UnsubscribeAll(), ...); }, m_channels);
+    }
+
+    template <typename Event>
+    EventChannel<Event> &Channel()
+    {
+        return std::get<EventChannel<Event>>(m_channels);
+    }
+
+private:
+    std::tuple<EventChannel<Events>...> m_channels;
+};
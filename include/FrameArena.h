@@ -0,0 +1,164 @@
+/**
+ * @file FrameArena.h
+ * @brief Linear allocator for temporaries that live until the end of the frame, and containers that use it.
+ * @date 2025-07-30
+ * @details Allocating from the arena bumps a pointer through one preallocated block; freeing is a no-op and
+ * everything is released at once by Reset(), which ISimulation::Run calls at the end of every frame. The arena
+ * is a std::pmr::memory_resource, so any pmr container can use it; FrameVector and FrameString are the usual
+ * ones. Memory taken from the arena must not be kept past the frame.
+ *
+ * A frame that needs more than the block gets the rest from the heap, and the overflow is counted. The next
+ * Reset() frees it and grows the block to fit, so after a warm-up frame steady-state frames don't touch the
+ * heap at all; UpstreamAllocations() lets callers check that.
+ *
+ * Frame() is the calling thread's own arena, so it needs no locking. It is only reset on threads that run
+ * frames (the loops of ISimulation::Run and RunThreaded); worker threads should own FrameArena instances.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+class FrameArena final : public std::pmr::memory_resource
+{
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    explicit FrameArena(size_t capacity = DEFAULT_CAPACITY) { Allocate(capacity); }
+
+    ~FrameArena() override
+    {
+        ReleaseOverflow();
+        std::pmr::new_delete_resource()->deallocate(m_block, m_capacity, alignof(std::max_align_t));
+    }
+
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    /// @brief this thread's arena, reset by the ISimulation loops at the end of every frame
+    static FrameArena &Frame()
+    {
+        thread_local FrameArena arena;
+        return arena;
+    }
+
+    /// @brief release everything allocated since the last reset; grows the block if this frame overflowed it
+    void Reset()
+    {
+        const size_t needed = m_used + m_overflowBytes;
+        m_highWater = std::max(m_highWater, needed);
+        const bool overflowed = m_overflow != nullptr;
+        ReleaseOverflow();
+        if (overflowed)
+        {
+            std::pmr::new_delete_resource()->deallocate(m_block, m_capacity, alignof(std::max_align_t));
+            Allocate(std::max(m_capacity * 2, needed + needed / 2));
+        }
+        m_used = 0;
+    }
+
+    size_t Used() const { return m_used; }
+    size_t Capacity() const { return m_capacity; }
+    size_t HighWater() const { return std::max(m_highWater, m_used + m_overflowBytes); } // most any frame needed
+    uint64_t UpstreamAllocations() const { return m_upstreamAllocations; } // heap allocations so far, blocks and overflow
+
+    /// @brief std::format into the arena, valid until the next Reset()
+    /// @return null-terminated text, so it can go straight to raylib
+    template <typename... Args>
+    const char *Format(std::format_string<Args...> format, Args &&...args)
+    {
+        const size_t size = std::formatted_size(format, args...);
+        char *text = static_cast<char *>(allocate(size + 1, 1));
+        std::format_to_n(text, size, format, std::forward<Args>(args)...);
+        text[size] = '\0';
+        return text;
+    }
+
+private:
+    // header in front of a heap block taken when the arena is full
+    struct Overflow
+    {
+        Overflow *next;
+        void *block;
+        size_t bytes;
+        size_t alignment;
+    };
+
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(m_block);
+        const uintptr_t start = (base + m_used + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+        if (start + bytes <= base + m_capacity)
+        {
+            m_used = start + bytes - base;
+            return reinterpret_cast<void *>(start);
+        }
+
+        // doesn't fit: a heap block with a header in front, freed by the next Reset()
+        const size_t headerAlignment = std::max(alignment, alignof(Overflow));
+        const size_t header = (sizeof(Overflow) + headerAlignment - 1) / headerAlignment * headerAlignment;
+        auto *raw = static_cast<std::byte *>(std::pmr::new_delete_resource()->allocate(header + bytes, headerAlignment));
+        auto *overflow = reinterpret_cast<Overflow *>(raw + header - sizeof(Overflow));
+        *overflow = {m_overflow, raw, header + bytes, headerAlignment};
+        m_overflow = overflow;
+        m_overflowBytes += bytes;
+        ++m_upstreamAllocations;
+        return raw + header;
+    }
+
+    void do_deallocate(void *, size_t, size_t) override {} // released by Reset()
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    void Allocate(size_t capacity)
+    {
+        m_capacity = capacity;
+        m_block = static_cast<std::byte *>(std::pmr::new_delete_resource()->allocate(capacity, alignof(std::max_align_t)));
+        ++m_upstreamAllocations;
+    }
+
+    void ReleaseOverflow()
+    {
+        while (m_overflow)
+        {
+            const Overflow overflow = *m_overflow;
+            m_overflow = overflow.next;
+            std::pmr::new_delete_resource()->deallocate(overflow.block, overflow.bytes, overflow.alignment);
+        }
+        m_overflowBytes = 0;
+    }
+
+    std::byte *m_block = nullptr;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_highWater = 0;
+    Overflow *m_overflow = nullptr; // heap blocks of this frame, newest first
+    size_t m_overflowBytes = 0;
+    uint64_t m_upstreamAllocations = 0;
+};
+
+/// @brief vector of frame temporaries, made by MakeFrameVector()
+template <typename T>
+using FrameVector = std::pmr::vector<T>;
+
+/// @brief string of frame temporaries, made by MakeFrameString()
+using FrameString = std::pmr::string;
+
+/// @brief empty FrameVector on the frame arena
+template <typename T>
+FrameVector<T> MakeFrameVector(FrameArena &arena = FrameArena::Frame())
+{
+    return FrameVector<T>(&arena);
+}
+
+/// @brief empty FrameString on the frame arena
+inline FrameString MakeFrameString(FrameArena &arena = FrameArena::Frame())
+{
+    return FrameString(&arena);
+}
@@ -8,10 +8,14 @@
 #pragma once
 
 #include "GUI.h"
+#include "Input.h"
+#include "FrameArena.h"
+#include "Log.h"
+#include "AssetArchive.h"
 #include <string>
-#include <iostream>
 #include <algorithm>
 #include <raylib.h>
+#include <entt/entt.hpp>
 
 // GUI Layout Constants
 namespace GUIConstants
@@ -103,25 +107,27 @@ public:
         if (!m_enabled)
             return;
 
-        Vector2 mousePos = GetMousePosition();
+        Vector2 mousePos = Input::GetMousePosition();
         m_isHovered = CheckCollisionPointRec(mousePos, m_bounds);
-        m_isClicked = m_isHovered && IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+        m_isClicked = m_isHovered && Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT);
 
-        if (m_isHovered && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        if (m_isHovered && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
             if (m_onClick)
                 m_onClick();
         }
     }
 
-    void SetOnClick(std::function<void()> onClick) { m_onClick = onClick; }
+    /// @brief connect a free function or `instance.*Candidate` to be called on click
+    template <auto Candidate, typename Instance>
+    void SetOnClick(Instance &instance) { m_onClick.template connect<Candidate>(instance); }
 
 private:
     std::string m_text;
     Color m_color, m_textColor, m_hoverColor, m_clickedColor;
     bool m_isHovered = false;
     bool m_isClicked = false;
-    std::function<void()> m_onClick;
+    entt::delegate<void()> m_onClick;
 };
 
 class GUILabel : public IGUIComponent
@@ -196,10 +202,10 @@ public:
         if (!m_enabled)
             return;
 
-        Vector2 mousePos = GetMousePosition();
+        Vector2 mousePos = Input::GetMousePosition();
         Rectangle checkboxRect = {m_bounds.x, m_bounds.y, GUIConstants::CHECKBOX_SIZE, GUIConstants::CHECKBOX_SIZE};
 
-        if (CheckCollisionPointRec(mousePos, checkboxRect) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        if (CheckCollisionPointRec(mousePos, checkboxRect) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
             m_checked = !m_checked;
             if (m_onChanged)
@@ -207,7 +213,8 @@ public:
         }
     }
 
-    void SetOnChanged(std::function<void(bool)> onChanged) { m_onChanged = onChanged; }
+    template <auto Candidate, typename Instance>
+    void SetOnChanged(Instance &instance) { m_onChanged.template connect<Candidate>(instance); }
     bool IsChecked() const { return m_checked; }
     void SetChecked(bool checked) { m_checked = checked; }
 
@@ -215,7 +222,7 @@ private:
     std::string m_label;
     bool m_checked;
     Color m_checkColor;
-    std::function<void(bool)> m_onChanged;
+    entt::delegate<void(bool)> m_onChanged;
 };
 
 class GUIImageBrowser : public IGUIComponent
@@ -298,7 +305,7 @@ public:
         if (!m_enabled || m_imagePaths.empty())
             return;
 
-        Vector2 mousePos = GetMousePosition();
+        Vector2 mousePos = Input::GetMousePosition();
 
         if (m_imagePaths.size() > 1)
         {
@@ -311,11 +318,11 @@ public:
                                     GUIConstants::NAV_BUTTON_WIDTH,
                                     GUIConstants::NAV_BUTTON_HEIGHT};
 
-            if (CheckCollisionPointRec(mousePos, prevButton) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+            if (CheckCollisionPointRec(mousePos, prevButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
             {
                 PreviousImage();
             }
-            else if (CheckCollisionPointRec(mousePos, nextButton) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+            else if (CheckCollisionPointRec(mousePos, nextButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
             {
                 NextImage();
             }
@@ -349,10 +356,10 @@ private:
 
         if (!m_imagePaths.empty() && m_currentIndex < m_imagePaths.size())
         {
-            m_currentTexture = LoadTexture(m_imagePaths[m_currentIndex].c_str());
+            m_currentTexture = LoadAssetTexture(m_imagePaths[m_currentIndex]);
             if (m_currentTexture.id == 0)
             {
-                std::cout << "Failed to load image: " << m_imagePaths[m_currentIndex] << std::endl;
+                Log::Error("Failed to load image: {}", m_imagePaths[m_currentIndex]);
             }
         }
     }
@@ -425,10 +432,10 @@ public:
         }
 
         // Draw value text
-        std::string valueText = std::to_string(static_cast<int>(m_currentValue));
+        const char *valueText = FrameArena::Frame().Format("{}", static_cast<int>(m_currentValue));
         int valueFontSize = GUIConstants::SLIDER_VALUE_FONT_SIZE;
-        int valueTextWidth = MeasureText(valueText.c_str(), valueFontSize);
-        DrawText(valueText.c_str(), m_bounds.x + m_bounds.width - valueTextWidth, m_bounds.y - GUIConstants::SLIDER_LABEL_OFFSET, valueFontSize, BLACK);
+        int valueTextWidth = MeasureText(valueText, valueFontSize);
+        DrawText(valueText, m_bounds.x + m_bounds.width - valueTextWidth, m_bounds.y - GUIConstants::SLIDER_LABEL_OFFSET, valueFontSize, BLACK);
     }
 
     void HandleInput(Vector2 offset) override
@@ -436,16 +443,16 @@ public:
         if (!m_enabled)
             return;
 
-        Vector2 mousePos = GetMousePosition();
+        Vector2 mousePos = Input::GetMousePosition();
         float trackY = m_bounds.y + m_bounds.height / 2;
         Rectangle handleArea = {m_bounds.x, trackY - GUIConstants::SLIDER_HANDLE_RADIUS, m_bounds.width, GUIConstants::SLIDER_HANDLE_AREA_HEIGHT};
 
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mousePos, handleArea))
+        if (Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mousePos, handleArea))
         {
             m_isDragging = true;
         }
 
-        if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+        if (Input::IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
         {
             m_isDragging = false;
         }
@@ -465,7 +472,8 @@ public:
         }
     }
 
-    void SetOnValueChanged(std::function<void(float)> callback) { m_onValueChanged = callback; }
+    template <auto Candidate, typename Instance>
+    void SetOnValueChanged(Instance &instance) { m_onValueChanged.template connect<Candidate>(instance); }
     float GetValue() const { return m_currentValue; }
     void SetValue(float value) { m_currentValue = std::clamp(value, m_minValue, m_maxValue); }
 
@@ -475,5 +483,5 @@ private:
     float m_currentValue;
     std::string m_label;
     bool m_isDragging;
-    std::function<void(float)> m_onValueChanged;
+    entt::delegate<void(float)> m_onValueChanged;
 };
@@ -3,6 +3,15 @@
 #include "Simulation.h"
 #include "Components.h"
 #include "Systems.h"
+#include "SystemPipeline.h"
+#include "TripleBuffer.h"
+#include "Particles.h"
+#include "Contacts.h"
+#include "BoxCollision.h"
+#include "RenderBackend.h"
+#include "FrameArena.h"
+#include "AllocTracker.h"
+#include "Log.h"
 
 
 struct SimulationConfig
@@ -25,60 +34,527 @@ namespace ecs
     };
 }
 
+/// @brief every entity with a RigidBody and a Rectangle. The group owns both pools: its bodies sit at the front of
+/// each in the same order, so iterating it walks two arrays instead of looking every entity up in the other pool.
+/// Only one group may own a component, use this one (or plain views) for anything else that needs bodies.
+inline auto PhysicsBodies(entt::registry &registry)
+{
+    return registry.group<ecs::RigidBody, ::Rectangle>();
+}
+
+/// @brief lands droppables on the collidables below them. Contacts persist between updates: isColliding,
+/// Collidable::contacts and a droppable's Grounded tag change only when a contact begins or ends.
+/// Bodies with a Transform2D tumble: they touch by the bounds of their rotated box, and BoxSystem moves them.
 class CollisionSystem : public ISystem
 {
 public:
-    bool OnUpdate(entt::registry &registry, float) override
+    using Reads = ComponentList<ecs::Droppable, ecs::Transform2D>;
+    using Writes = ComponentList<ecs::RigidBody, ::Rectangle, ecs::Collidable, ecs::Grounded>; // sorts the bodies
+
+    const char *Name() const override { return "collisions"; }
+
+    /// @brief droppable (a) and collidable (b) pairs; Began() points are the bottom centre of the droppable
+    const ContactManager &Contacts() const { return m_contacts; }
+
+    void OnAttach(entt::registry &registry) override
     {
-        // lazy collision detection system
-        // just checking droppable entities against collidable rectangles
-        auto droppables = registry.view<ecs::Droppable, ::Rectangle, ecs::RigidBody, ecs::Collidable>();
-        auto collidables = registry.view<ecs::Collidable, ::Rectangle, ecs::RigidBody>(entt::exclude<ecs::Droppable>);
+        PhysicsBodies(registry).sort<::Rectangle>(LeftOf); // arbitrary order yet, the per-frame sort expects a sorted one
+    }
 
-        droppables.each([&](entt::entity droppableEntity, ecs::Droppable &droppable, Rectangle &droppableRect, ecs::RigidBody &droppableBody, ecs::Collidable &droppableCollidable)
-                        {
+    bool OnUpdate(entt::registry &registry, float) override
+    {
+        auto bodies = PhysicsBodies(registry);
+        const auto &droppables = registry.storage<ecs::Droppable>();
+        const auto &transforms = registry.storage<ecs::Transform2D>();
+        auto &collidables = registry.storage<ecs::Collidable>();
+
+        // a tumbling box's bounds reach past its Rectangle, which the bodies are sorted by; keep candidates that much longer
+        float reach = 0.0f;
+        for (auto [entity, transform] : transforms.each())
+        {
+            if (bodies.contains(entity))
+                reach = std::max(reach, bodies.get<::Rectangle>(entity).x - Bounds(bodies.get<::Rectangle>(entity), transform).x);
+        }
 
-            collidables.each([&](ecs::Collidable &collidable, Rectangle &collidableRect, ecs::RigidBody &collidableBody)
-            {
-                if (CheckCollisionRecs(droppableRect, collidableRect))
-                {
-                    collidable.isColliding = true;
-                    droppableBody.velocity.y = 0.0f; // Reset vertical velocity on collision
-                    droppableBody.velocity.x = collidableBody.velocity.x; // Match horizontal velocity of the collidable
-                }
-            });
-
-            if(droppableCollidable.isColliding)
+        // sweep and prune along x: bodies sorted by left edge, so only those whose right edge is past the current
+        // one's left edge can overlap it. Bodies barely move between frames, insertion sort is close to linear.
+        bodies.sort<::Rectangle>(LeftOf, entt::insertion_sort{});
+        m_contacts.Begin();
+        m_active.clear();
+        for (auto [entity, body, rect] : bodies.each())
+        {
+            if (!collidables.contains(entity))
+                continue;
+            std::erase_if(m_active, [&](const Candidate &candidate)
+                          { return candidate.bounds.x + candidate.bounds.width + reach <= rect.x; });
+
+            const bool tumbling = transforms.contains(entity);
+            const Candidate current = {entity, tumbling ? Bounds(rect, transforms.get(entity)) : rect, &body, droppables.contains(entity), tumbling};
+            for (const Candidate &other : m_active)
             {
-                registry.emplace_or_replace<ecs::Grounded>(droppableEntity, ecs::Grounded{}); // Mark as grounded
+                // droppables land on collidables that aren't droppable themselves
+                if (current.droppable == other.droppable || !CheckCollisionRecs(current.bounds, other.bounds))
+                    continue;
+                if (current.droppable)
+                    Land(current, other);
+                else
+                    Land(other, current);
             }
-            else
-            {
-                registry.remove<ecs::Grounded>(droppableEntity); // Remove grounded status if not colliding
-            } });
+            m_active.push_back(current);
+        }
+        m_contacts.End();
+
+        for (const Contact &contact : m_contacts.Began())
+        {
+            Count(registry, contact.a, 1, true);
+            Count(registry, contact.b, 1, false);
+        }
+        for (const Contact &contact : m_contacts.Ended())
+        {
+            Count(registry, contact.a, -1, true);
+            Count(registry, contact.b, -1, false);
+        }
 
         return true;
     }
+
+private:
+    static bool LeftOf(const ::Rectangle &a, const ::Rectangle &b) { return a.x < b.x; }
+
+    struct Candidate
+    {
+        entt::entity entity;
+        ::Rectangle bounds; // the Rectangle, or the bounds of a tumbling box
+        ecs::RigidBody *body;
+        bool droppable;
+        bool tumbling;
+    };
+
+    /// @brief bounds of the box of size rect rotated about the transform's position
+    static ::Rectangle Bounds(const ::Rectangle &rect, const ecs::Transform2D &transform)
+    {
+        const float angle = transform.rotation * DEG2RAD;
+        const float c = std::abs(std::cos(angle)), s = std::abs(std::sin(angle));
+        const float extentX = (c * rect.width + s * rect.height) * 0.5f, extentY = (s * rect.width + c * rect.height) * 0.5f;
+        return {transform.position.x - extentX, transform.position.y - extentY, 2.0f * extentX, 2.0f * extentY};
+    }
+
+    void Land(const Candidate &droppable, const Candidate &collidable)
+    {
+        const ::Rectangle &droppableRect = droppable.bounds;
+        m_contacts.Add(droppable.entity, collidable.entity, {droppableRect.x + droppableRect.width * 0.5f, droppableRect.y + droppableRect.height});
+        if (droppable.tumbling)
+            return; // BoxSystem's contacts stop it, and let it tip over
+        droppable.body->velocity.y = 0.0f;                       // Reset vertical velocity on collision
+        droppable.body->velocity.x = collidable.body->velocity.x; // Match horizontal velocity of the collidable
+    }
+
+    /// @brief a contact of entity began (change 1) or ended (-1); flags and tags follow the first and last one
+    static void Count(entt::registry &registry, entt::entity entity, int change, bool droppable)
+    {
+        auto &collidables = registry.storage<ecs::Collidable>();
+        if (!collidables.contains(entity))
+            return; // destroyed since, or no longer collidable
+        ecs::Collidable &collidable = collidables.get(entity);
+        collidable.contacts += change;
+        const bool touching = collidable.contacts > 0;
+        if (touching == collidable.isColliding)
+            return;
+        collidable.isColliding = touching;
+        if (!droppable)
+            return;
+        if (touching && !registry.all_of<ecs::Grounded>(entity))
+            registry.emplace<ecs::Grounded>(entity); // Mark as grounded
+        else if (!touching)
+            registry.remove<ecs::Grounded>(entity); // Remove grounded status once nothing holds it up
+    }
+
+    ContactManager m_contacts;
+    std::vector<Candidate> m_active; // collidable bodies the sweep is inside of
 };
 
 class PhysicsSystem : public ISystem
 {
 public:
+    using Reads = ComponentList<ecs::Gravity, ::Rectangle, ecs::Grounded, ecs::Transform2D, ecs::Collidable>;
+    using Writes = ComponentList<ecs::RigidBody>;
+
+    const char *Name() const override { return "physics"; }
+
+    void OnAttach(entt::registry &registry) override { PhysicsBodies(registry); }
+
     bool OnUpdate(entt::registry &registry, float deltaTime) override
     {
         const auto &gravity = registry.ctx().get<ecs::Gravity>(); // Get the gravity value from the registry
         float gravityValue = gravity.value;                       // Access the gravity value
 
-        auto view = registry.view<ecs::RigidBody, Rectangle>(entt::exclude<ecs::Grounded>);
-        view.each([&](ecs::RigidBody &body, Rectangle &rec)
-                  {
-                      body.velocity.y += gravityValue * deltaTime; // Apply gravity to the vertical velocity
-                  });                                              // Apply gravity to all rigid bodies
+        // grounded bodies stay in the group, it would otherwise be rebuilt every time one lands or takes off
+        const auto &grounded = registry.storage<ecs::Grounded>();
+        const auto &transforms = registry.storage<ecs::Transform2D>();
+        const auto &collidables = registry.storage<ecs::Collidable>();
+        auto bodies = PhysicsBodies(registry);
+        auto integrate = [&](entt::entity e, ecs::RigidBody &body, Rectangle &rec)
+        {
+            // a grounded tumbling box keeps its weight while it touches something, BoxSystem's contacts hold it up
+            // and it may still tip over; one touching nothing is held where it is, like any grounded body
+            const bool held = grounded.contains(e) && !(transforms.contains(e) && collidables.contains(e) && collidables.get(e).contacts > 0);
+            if (!held)
+                body.velocity.y += gravityValue * deltaTime; // Apply gravity to the vertical velocity
+        };
+        if (m_jobs)
+            m_jobs->ParallelEach(bodies, integrate); // bodies are independent, small groups run inline
+        else
+            bodies.each(integrate); // Apply gravity to all rigid bodies
 
         return true; // Indicate that the system has updated
     }
 };
 
+/// @brief collidable bodies with a Transform2D are boxes that tumble. Their Transform2D (centre in pixels, rotation
+/// in degrees) moves with the RigidBody's velocity and angular velocity, and they collide as rotated boxes with each
+/// other and with every other collidable body, which stays put as a fixed obstacle. Rectangle keeps the box's size
+/// and follows its unrotated position. Velocities are in metres per second, like the gravity PhysicsSystem applies.
+class BoxSystem : public ISystem
+{
+public:
+    using Reads = ComponentList<ecs::Collidable>;
+    using Writes = ComponentList<ecs::RigidBody, ::Rectangle, ecs::Transform2D>;
+
+    struct Settings
+    {
+        float pixelsPerMeter = 40.0f; // as GravityGame draws
+        float restitution = 0.1f;     // bounce of a hit faster than BOUNCE_SPEED, 0 for none
+        float friction = 0.5f;
+        int iterations = 8;           // impulse passes over the contact points per update
+        float slop = 0.005f;          // overlap in metres left alone, so resting boxes keep touching
+        float correction = 0.2f;      // fraction of the rest pushed apart per update
+    };
+
+    const char *Name() const override { return "boxes"; }
+
+    Settings &Configure() { return m_settings; }
+
+    /// @brief touching pairs, the lower entity id first; points are in pixels
+    const ContactManager &Contacts() const { return m_contacts; }
+
+    /// @brief pairs whose bounds overlapped during the last update, each went through the SAT test
+    size_t Candidates() const { return m_batch.Size(); }
+
+    /// @brief moment of inertia of a solid box, for RigidBody::setMomentOfInertia; sizes in metres
+    static float BoxInertia(float mass, float width, float height) { return mass * (width * width + height * height) / 12.0f; }
+
+    bool OnUpdate(entt::registry &registry, float deltaTime) override
+    {
+        if (registry.storage<ecs::Transform2D>().empty())
+            return false; // nothing tumbles, boxes without rotation are CollisionSystem's
+
+        Gather(registry);
+        FindPairs();
+        const size_t steps = m_batch.Padded() / BoxPairBatch::LANES;
+        if (m_jobs)
+            m_jobs->ParallelForRange(steps, BATCH_STEPS, [&](size_t begin, size_t end)
+                                     { m_batch.Test(begin * BoxPairBatch::LANES, end * BoxPairBatch::LANES); });
+        else
+            m_batch.Test();
+        MakeContacts();
+        for (const Point &point : m_points) // warm start: last update's impulses are most of this one's
+            Apply(point, point.normalImpulse * point.nx - point.tangentImpulse * point.ny, point.normalImpulse * point.ny + point.tangentImpulse * point.nx);
+        for (int iteration = 0; iteration < m_settings.iterations; ++iteration)
+            for (Point &point : m_points)
+                Solve(point);
+        KeepImpulses();
+        Integrate(deltaTime);
+        return true;
+    }
+
+private:
+    static constexpr float BOUNCE_SPEED = 1.0f; // metres per second; slower hits don't bounce, so stacks come to rest
+    static constexpr size_t BATCH_STEPS = 1024; // SIMD steps of pairs per job
+
+    struct Body
+    {
+        entt::entity entity;
+        ecs::RigidBody *body;
+        ::Rectangle *rect;
+        ecs::Transform2D *transform; // null for fixed obstacles
+        OrientedBox box;             // in metres
+        float vx, vy, angularVelocity;
+        float inverseMass, inverseInertia; // 0 for fixed obstacles
+        float minX, maxX, minY, maxY;      // bounds of the rotated box
+    };
+
+    struct Pair
+    {
+        uint32_t a, b; // into m_bodies, the lower entity id first so a pair keeps its roles as the sweep order changes
+    };
+
+    /// @brief one contact point, with what the impulses need precomputed
+    struct Point
+    {
+        uint32_t a, b;
+        float nx, ny;             // from a to b
+        float rax, ray, rbx, rby; // from the centres of a and b to the point
+        float depth;
+        float share;              // 1 / points of the pair, so pairs with two points aren't pushed apart twice as hard
+        float normalMass, tangentMass;
+        float bounce;             // normal velocity the impulses aim for
+        float normalImpulse = 0.0f, tangentImpulse = 0.0f; // accumulated, clamped in total rather than per pass
+    };
+
+    /// @brief the impulses a touching pair's points ended an update with, to start the next one from
+    struct Impulses
+    {
+        uint64_t key;   // entity ids of the pair
+        uint32_t first; // of its points in m_points, while they're being made
+        int count;
+        float normal[2], tangent[2];
+    };
+
+    static uint64_t Key(const Body &a, const Body &b)
+    {
+        return static_cast<uint64_t>(entt::to_integral(a.entity)) << 32 | entt::to_integral(b.entity);
+    }
+
+    void Gather(entt::registry &registry)
+    {
+        auto &transforms = registry.storage<ecs::Transform2D>();
+        const auto &collidables = registry.storage<ecs::Collidable>();
+        const float metres = 1.0f / m_settings.pixelsPerMeter;
+
+        m_bodies.clear();
+        for (auto [entity, rigidBody, rect] : PhysicsBodies(registry).each())
+        {
+            if (!collidables.contains(entity))
+                continue;
+            Body &body = m_bodies.emplace_back();
+            body.entity = entity;
+            body.body = &rigidBody;
+            body.rect = &rect;
+            body.transform = transforms.contains(entity) ? &transforms.get(entity) : nullptr;
+            body.box.halfWidth = rect.width * 0.5f * metres;
+            body.box.halfHeight = rect.height * 0.5f * metres;
+            if (body.transform)
+            {
+                const float angle = body.transform->rotation * DEG2RAD;
+                body.box.x = body.transform->position.x * metres;
+                body.box.y = body.transform->position.y * metres;
+                body.box.cos = std::cos(angle);
+                body.box.sin = std::sin(angle);
+                body.vx = rigidBody.velocity.x;
+                body.vy = rigidBody.velocity.y;
+                body.angularVelocity = rigidBody.angularVelocity;
+                body.inverseMass = rigidBody.inverseMass;
+                body.inverseInertia = rigidBody.inverseMomentOfInertia;
+            }
+            else
+            {
+                body.box.x = (rect.x + rect.width * 0.5f) * metres;
+                body.box.y = (rect.y + rect.height * 0.5f) * metres;
+                body.vx = body.vy = body.angularVelocity = 0.0f;
+                body.inverseMass = body.inverseInertia = 0.0f;
+            }
+            const float c = std::abs(body.box.cos), s = std::abs(body.box.sin);
+            const float extentX = c * body.box.halfWidth + s * body.box.halfHeight;
+            const float extentY = s * body.box.halfWidth + c * body.box.halfHeight;
+            body.minX = body.box.x - extentX, body.maxX = body.box.x + extentX;
+            body.minY = body.box.y - extentY, body.maxY = body.box.y + extentY;
+        }
+    }
+
+    // sweep and prune over the rotated bounds, like CollisionSystem; pairs of two fixed obstacles are skipped
+    void FindPairs()
+    {
+        m_order.resize(m_bodies.size());
+        for (uint32_t i = 0; i < m_order.size(); ++i)
+            m_order[i] = i;
+        std::sort(m_order.begin(), m_order.end(), [&](uint32_t a, uint32_t b)
+                  { return m_bodies[a].minX < m_bodies[b].minX; });
+
+        m_batch.Clear();
+        m_pairs.clear();
+        m_active.clear();
+        for (uint32_t i : m_order)
+        {
+            const Body &body = m_bodies[i];
+            std::erase_if(m_active, [&](uint32_t j)
+                          { return m_bodies[j].maxX < body.minX; });
+            for (uint32_t j : m_active)
+            {
+                const Body &other = m_bodies[j];
+                if ((!body.transform && !other.transform) || other.maxY < body.minY || body.maxY < other.minY)
+                    continue;
+                const bool ordered = entt::to_integral(other.entity) < entt::to_integral(body.entity);
+                const Pair pair = ordered ? Pair{j, i} : Pair{i, j};
+                m_batch.Add(m_bodies[pair.a].box, m_bodies[pair.b].box);
+                m_pairs.push_back(pair);
+            }
+            m_active.push_back(i);
+        }
+    }
+
+    void MakeContacts()
+    {
+        m_points.clear();
+        m_touching.clear();
+        m_contacts.Begin();
+        for (size_t k = 0; k < m_pairs.size(); ++k)
+        {
+            if (m_batch.Depth(k) < 0.0f)
+                continue; // a separating axis, most candidates end here
+            const Body &a = m_bodies[m_pairs[k].a], &b = m_bodies[m_pairs[k].b];
+            const BoxManifold manifold = ClipBoxes(a.box, b.box, m_batch.Normal(k), m_batch.FaceOfB(k));
+            if (manifold.count == 0)
+                continue;
+            m_contacts.Add(a.entity, b.entity, {manifold.points[0].x * m_settings.pixelsPerMeter, manifold.points[0].y * m_settings.pixelsPerMeter});
+
+            // a pair touching at as many points as last update is assumed to touch at the same ones
+            const uint64_t key = Key(a, b);
+            auto kept = std::lower_bound(m_kept.begin(), m_kept.end(), key, [](const Impulses &impulses, uint64_t key)
+                                         { return impulses.key < key; });
+            const bool warm = kept != m_kept.end() && kept->key == key && kept->count == manifold.count;
+            m_touching.push_back({key, static_cast<uint32_t>(m_points.size()), manifold.count, {}, {}});
+
+            const float nx = manifold.normal.x, ny = manifold.normal.y;
+            for (int p = 0; p < manifold.count; ++p)
+            {
+                Point &point = m_points.emplace_back();
+                point.a = m_pairs[k].a, point.b = m_pairs[k].b;
+                point.nx = nx, point.ny = ny;
+                point.rax = manifold.points[p].x - a.box.x, point.ray = manifold.points[p].y - a.box.y;
+                point.rbx = manifold.points[p].x - b.box.x, point.rby = manifold.points[p].y - b.box.y;
+                point.depth = manifold.depths[p];
+                point.share = 1.0f / static_cast<float>(manifold.count);
+
+                const float rna = point.rax * ny - point.ray * nx, rnb = point.rbx * ny - point.rby * nx;
+                const float rta = point.rax * nx + point.ray * ny, rtb = point.rbx * nx + point.rby * ny; // tangent (-ny, nx)
+                const float masses = a.inverseMass + b.inverseMass;
+                point.normalMass = 1.0f / (masses + a.inverseInertia * rna * rna + b.inverseInertia * rnb * rnb);
+                point.tangentMass = 1.0f / (masses + a.inverseInertia * rta * rta + b.inverseInertia * rtb * rtb);
+
+                float vx, vy;
+                RelativeVelocity(point, vx, vy);
+                const float approach = vx * nx + vy * ny;
+                point.bounce = approach < -BOUNCE_SPEED ? -m_settings.restitution * approach : 0.0f;
+                if (warm)
+                    point.normalImpulse = kept->normal[p], point.tangentImpulse = kept->tangent[p];
+            }
+        }
+        m_contacts.End();
+    }
+
+    /// @brief velocity of b's point relative to a's
+    void RelativeVelocity(const Point &point, float &vx, float &vy) const
+    {
+        const Body &a = m_bodies[point.a], &b = m_bodies[point.b];
+        vx = (b.vx - b.angularVelocity * point.rby) - (a.vx - a.angularVelocity * point.ray);
+        vy = (b.vy + b.angularVelocity * point.rbx) - (a.vy + a.angularVelocity * point.rax);
+    }
+
+    void Apply(const Point &point, float px, float py)
+    {
+        Body &a = m_bodies[point.a], &b = m_bodies[point.b];
+        a.vx -= px * a.inverseMass, a.vy -= py * a.inverseMass;
+        a.angularVelocity -= (point.rax * py - point.ray * px) * a.inverseInertia;
+        b.vx += px * b.inverseMass, b.vy += py * b.inverseMass;
+        b.angularVelocity += (point.rbx * py - point.rby * px) * b.inverseInertia;
+    }
+
+    // one pass of sequential impulses: stop the point closing (or bounce), then friction up to its limit
+    void Solve(Point &point)
+    {
+        float vx, vy;
+        RelativeVelocity(point, vx, vy);
+        float impulse = point.normalMass * (point.bounce - (vx * point.nx + vy * point.ny));
+        const float normal = std::max(point.normalImpulse + impulse, 0.0f); // contacts push, never pull
+        impulse = normal - point.normalImpulse;
+        point.normalImpulse = normal;
+        Apply(point, impulse * point.nx, impulse * point.ny);
+
+        RelativeVelocity(point, vx, vy);
+        const float tx = -point.ny, ty = point.nx;
+        const float limit = m_settings.friction * point.normalImpulse;
+        const float tangent = std::clamp(point.tangentImpulse - point.tangentMass * (vx * tx + vy * ty), -limit, limit);
+        impulse = tangent - point.tangentImpulse;
+        point.tangentImpulse = tangent;
+        Apply(point, impulse * tx, impulse * ty);
+    }
+
+    void KeepImpulses()
+    {
+        for (Impulses &impulses : m_touching)
+            for (int p = 0; p < impulses.count; ++p)
+            {
+                impulses.normal[p] = m_points[impulses.first + p].normalImpulse;
+                impulses.tangent[p] = m_points[impulses.first + p].tangentImpulse;
+            }
+        std::sort(m_touching.begin(), m_touching.end(), [](const Impulses &x, const Impulses &y)
+                  { return x.key < y.key; });
+        std::swap(m_kept, m_touching);
+    }
+
+    // push overlapping boxes part of the way apart, then move and turn them and write everything back
+    void Integrate(float deltaTime)
+    {
+        for (const Point &point : m_points)
+        {
+            Body &a = m_bodies[point.a], &b = m_bodies[point.b];
+            const float masses = a.inverseMass + b.inverseMass;
+            const float push = std::max(point.depth - m_settings.slop, 0.0f) * m_settings.correction * point.share / masses;
+            a.box.x -= point.nx * push * a.inverseMass, a.box.y -= point.ny * push * a.inverseMass;
+            b.box.x += point.nx * push * b.inverseMass, b.box.y += point.ny * push * b.inverseMass;
+        }
+
+        for (Body &body : m_bodies)
+        {
+            if (!body.transform)
+                continue;
+            body.body->velocity = {body.vx, body.vy};
+            body.body->angularVelocity = body.angularVelocity;
+            ecs::Transform2D &transform = *body.transform;
+            transform.position.x = (body.box.x + body.vx * deltaTime) * m_settings.pixelsPerMeter;
+            transform.position.y = (body.box.y + body.vy * deltaTime) * m_settings.pixelsPerMeter;
+            transform.rotation = std::remainder(transform.rotation + body.angularVelocity * deltaTime * RAD2DEG, 360.0f);
+            body.rect->x = transform.position.x - body.rect->width * 0.5f;
+            body.rect->y = transform.position.y - body.rect->height * 0.5f;
+        }
+    }
+
+    Settings m_settings;
+    ContactManager m_contacts;
+    BoxPairBatch m_batch;          // candidate pairs, in m_pairs order
+    std::vector<Body> m_bodies;    // every collidable body, in group order
+    std::vector<uint32_t> m_order; // m_bodies by left edge
+    std::vector<uint32_t> m_active;
+    std::vector<Pair> m_pairs;
+    std::vector<Point> m_points;
+    std::vector<Impulses> m_touching; // this update's pairs with points
+    std::vector<Impulses> m_kept;     // last update's, sorted by key
+};
+
+/// @brief what GravityGame draws, copied out of the registry after every update
+struct GravitySnapshot
+{
+    struct Box
+    {
+        ::Rectangle rect;
+        Color tint;
+        bool selected;
+    };
+    struct Label
+    {
+        std::string text;
+        Vector2 position;
+        int fontSize;
+        Color color;
+    };
+
+    std::vector<Box> boxes;
+    std::vector<Label> labels;
+    ParticleSnapshot particles;
+    bool drawGrid = false;
+    int gridSize = 20;
+};
+
 /// @brief Registers components to an entity in the registry.
 /// @param e The entity to register components to.
 /// @param registry The entity registry to register components in.
@@ -110,12 +586,16 @@ public:
         // setup the simulation context
         m_registry.ctx().emplace<Gravity>(Gravity{9.81f}); // Initialize gravity context
 
-        // create a box entity to drop
+        // create a box entity to drop, it tumbles as a rotated box (BoxSystem) once dropped
         entt::entity box = m_registry.create();
-        RegisterComponents<Rectangle, Droppable, RigidBody, Collidable, Grounded, MouseInteractible>(
+        RigidBody boxBody;
+        boxBody.setMomentOfInertia(BoxSystem::BoxInertia(boxBody.mass, m_boxWidth / m_pixelsPerMeter, m_boxHeight / m_pixelsPerMeter));
+        Transform2D boxTransform;
+        boxTransform.position = {m_horizontalOffset + m_boxWidth * 0.5f, m_initialAltitude + m_boxHeight * 0.5f};
+        RegisterComponents<Rectangle, Droppable, RigidBody, Transform2D, Collidable, Grounded, MouseInteractible>(
             box, m_registry,
             Rectangle{(float)m_horizontalOffset, (float)m_initialAltitude, (float)m_boxWidth, (float)m_boxHeight},
-            Droppable{}, RigidBody{}, Collidable{}, Grounded{}, MouseInteractible{});
+            Droppable{}, std::move(boxBody), std::move(boxTransform), Collidable{}, Grounded{}, MouseInteractible{});
 
         // create platform for box to land on
         entt::entity platform = m_registry.create();
@@ -128,20 +608,23 @@ public:
         m_registry.emplace<ecs::Text>(text, ecs::Text{"Press SPACE to drop the box", Vector2{10, 10}, 20, BLACK});
 
         // create text drawing system
-        CreateSystem<PhysicsSystem>();
-        CreateSystem<CollisionSystem>();
-        CreateSystem<TextInterface>();
+        m_pipeline.Attach(m_registry, &m_jobs);
+        m_collisions = &m_pipeline.Get<CollisionSystem>();
+
+        // dust where the box lands
+        m_particles.LoadTextures();
+        m_dust = m_particles.AddEmitter(EmitterSettings::Dust(), 4096);
     }
 
     /// @brief handles user input
     /// @details Pressing SPACE drops the box, and pressing G toggles the grid visibility.
     void HandleInput() override
     {
-        if (IsKeyPressed(KEY_SPACE))
+        if (Input::IsKeyPressed(KEY_SPACE))
         {
             auto boxView = m_registry.view<ecs::Droppable, ecs::RigidBody, ecs::Grounded>();
             bool wasDropped = false;
-            std::vector<entt::entity> removeEntities; // To store entities to be removed
+            FrameVector<entt::entity> removeEntities = MakeFrameVector<entt::entity>(); // To store entities to be removed
 
             // check if a the a droppable box with grounded component exists
             boxView.each([&](entt::entity e, ecs::Droppable &droppable, ecs::RigidBody &body)
@@ -173,12 +656,12 @@ public:
             }
         }
 
-        if (IsKeyPressed(KEY_G))
+        if (Input::IsKeyPressed(KEY_G))
         {
             m_drawGrid = !m_drawGrid; // Toggle grid visibility
         }
 
-        if (IsKeyPressed(KEY_RIGHT))
+        if (Input::IsKeyPressed(KEY_RIGHT))
         {
             m_gridSize += 5;
             if (m_gridSize >= m_screenWidth * 0.25f)
@@ -186,7 +669,7 @@ public:
                 m_gridSize = m_screenHeight * 0.25f; // cap grid size to 1/4 of screen width
             }
         }
-        else if (IsKeyPressed(KEY_LEFT))
+        else if (Input::IsKeyPressed(KEY_LEFT))
         {
             m_gridSize -= 5;
             if (m_gridSize <= 5)
@@ -233,85 +716,152 @@ public:
         //                 rec.x += body.velocity.x * m_pixelsPerMeter * deltaTime; // Update horizontal position based on velocity
         //             });
 
-        for (auto &system : m_systems)
+        m_pipeline.Update(m_registry, deltaTime);
+        for (auto &system : m_systems) // added at runtime, after the fixed pipeline
         {
+            AllocTracker::Scope scope(system->Name());
             system->OnUpdate(m_registry, deltaTime); // Update each system in the scene
         }
+
+        AllocTracker::Scope scope("particles");
+        if (m_collisions)
+        {
+            for (const Contact &contact : m_collisions->Contacts().Began())
+                m_particles.Emitter(m_dust).Burst(contact.point.x, contact.point.y, 48);
+        }
+        m_particles.Update(deltaTime);
     }
 
-    void Run() override
+    uint64_t StateHash() const override
     {
-        Init(); // Initialize the simulation
-        while (!WindowShouldClose())
+        // FNV-1a over the positions and velocities of every body
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](const void *data, size_t size)
         {
-            HandleInput();          // Handle user input
-            Update(GetFrameTime()); // Update the simulation state
-            Render();               // Render the simulation
-        }
-        Cleanup(); // Cleanup resources
+            const auto *bytes = static_cast<const unsigned char *>(data);
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+        };
+        auto bodies = m_registry.view<const ::Rectangle, const ecs::RigidBody>();
+        bodies.each([&](const ::Rectangle &rec, const ecs::RigidBody &body)
+                    {
+                        mix(&rec, sizeof(rec));
+                        mix(&body.velocity, sizeof(body.velocity)); });
+        return hash;
     }
 
+    /// @brief single-threaded runs draw through the same snapshot as threaded ones
     void Render() override
     {
-        BeginDrawing();
-        ClearBackground(SKYBLUE);
+        PublishSnapshot();
+        RenderSnapshot();
+    }
 
-        Update(GetFrameTime()); // Update the simulation state
+    bool SupportsThreadedRun() const override { return true; }
 
-        if (m_drawGrid)
-        {
-            DrawGrid(m_screenWidth, m_screenHeight, m_gridSize); // Draw grid if enabled
-        }
-
-        // Draw all drawable rectangle entities
+    void PublishSnapshot() override
+    {
+        GravitySnapshot &snapshot = m_snapshots.Back(); // an older snapshot, rewritten completely; buffers are reused
+        snapshot.drawGrid = m_drawGrid;
+        snapshot.gridSize = m_gridSize;
 
+        snapshot.boxes.clear();
         auto rectangles = m_registry.view<::Rectangle, ecs::Drawable, ecs::MouseInteractible>();
-        rectangles.each([](const ::Rectangle &rec, const ecs::Drawable &drawable, const ecs::MouseInteractible &selected)
-                        { 
-                        DrawRectangle((int)rec.x, (int)rec.y, (int)rec.width, (int)rec.height, drawable.tint); 
-
-                        // if selected, draw a border
-                        if (selected.selected)
-                        {
-                            ::DrawRectangleLines((int)rec.x, (int)rec.y, (int)rec.width, (int)rec.height, BLACK);
-                        } });
+        rectangles.each([&](const ::Rectangle &rec, const ecs::Drawable &drawable, const ecs::MouseInteractible &interactible)
+                        { snapshot.boxes.push_back({rec, drawable.tint, interactible.selected}); });
 
+        size_t labels = 0;
         auto text = m_registry.view<ecs::Text, ecs::Drawable>();
-        text.each([](const ecs::Text &text, const ecs::Drawable &drawable)
-                  { DrawText(text.content.c_str(), (int)text.position.x, (int)text.position.y, text.fontSize, drawable.tint); });
+        text.each([&](const ecs::Text &text, const ecs::Drawable &drawable)
+                  {
+                      if (labels == snapshot.labels.size())
+                          snapshot.labels.emplace_back();
+                      GravitySnapshot::Label &label = snapshot.labels[labels++];
+                      label.text.assign(text.content); // keeps the string's buffer
+                      label.position = text.position;
+                      label.fontSize = text.fontSize;
+                      label.color = drawable.tint; });
+        snapshot.labels.resize(labels);
+
+        m_particles.Capture(snapshot.particles);
+        m_snapshots.Publish();
+    }
+
+    void RenderSnapshot() override
+    {
+        m_snapshots.Acquire();
+        const GravitySnapshot &snapshot = m_snapshots.Front();
 
+        BeginDrawing();
+        RaylibRenderer renderer;
+        DrawSnapshot(snapshot, m_screenWidth, m_screenHeight, renderer);
+        snapshot.particles.Draw();
+        AllocTracker::DrawOverlay(10, m_screenHeight - 120);
         EndDrawing();
     }
 
+    /// @brief everything of a snapshot but its particles, which only draw on the GPU
+    static void DrawSnapshot(const GravitySnapshot &snapshot, int screenWidth, int screenHeight, IRenderBackend &backend)
+    {
+        backend.Clear(SKYBLUE);
+
+        if (snapshot.drawGrid)
+        {
+            DrawGrid(screenWidth, screenHeight, snapshot.gridSize, backend); // Draw grid if enabled
+        }
+
+        // Draw all drawable rectangle entities, on whole pixels like DrawRectangle(int...)
+        for (const GravitySnapshot::Box &box : snapshot.boxes)
+        {
+            const ::Rectangle rec = {(float)(int)box.rect.x, (float)(int)box.rect.y, (float)(int)box.rect.width, (float)(int)box.rect.height};
+            backend.FillRect(rec, box.tint);
+
+            // if selected, draw a border
+            if (box.selected)
+            {
+                backend.RectLines(rec, BLACK);
+            }
+        }
+
+        for (const GravitySnapshot::Label &label : snapshot.labels)
+            backend.Text(label.text.c_str(), {(float)(int)label.position.x, (float)(int)label.position.y}, label.fontSize, label.color);
+    }
+
     void Cleanup() override
     {
         // Cleanup resources if needed
         m_registry.clear(); // Clear the registry to remove all entities and components
+        m_particles.UnloadTextures();
     }
 
-    void DrawGrid(int screenWidth, int screenHeight, int cellCount)
+    static void DrawGrid(int screenWidth, int screenHeight, int cellSize, IRenderBackend &backend)
     {
-        for (int x = 0; x < screenWidth / cellCount; x += m_gridSize)
+        for (int x = 0; x < screenWidth; x += cellSize)
         {
-            DrawLine(x, 0, x, screenHeight, LIGHTGRAY);
+            backend.Line({(float)x, 0}, {(float)x, (float)screenHeight}, LIGHTGRAY);
         }
-        for (int y = 0; y < screenHeight / cellCount; y += m_gridSize)
+        for (int y = 0; y < screenHeight; y += cellSize)
         {
-            DrawLine(0, y, screenWidth, y, BLACK);
+            backend.Line({0, (float)y}, {(float)screenWidth, (float)y}, BLACK);
         }
     }
 
+    /// @return the created system, owned by the simulation; nullptr if it couldn't be created
     template <typename T, typename... Args>
-    inline void CreateSystem(Args... args)
+    inline T *CreateSystem(Args... args)
     {
         std::unique_ptr<T> system = std::make_unique<T>(args...);
         if (!system)
         {
-            std::cerr << "Failed to create system of type: " << typeid(T).name() << std::endl;
-            return;
+            Log::Error("Failed to create system of type: {}", typeid(T).name());
+            return nullptr;
         }
+        T *created = system.get();
+        system->UseJobs(&m_jobs);
+        system->OnAttach(m_registry);
         m_systems.emplace_back(std::move(system)); // Store the system in the simulation
-        std::cout << "Created system: " << typeid(T).name() << std::endl;
+        Log::Info("Created system: {}", created->Name());
+        return created;
     }
 
 private:
@@ -319,7 +869,7 @@ private:
     bool m_isPaused;
     bool m_boxDropped;
     bool m_drawGrid = true; // Flag to control grid visibility
-    int m_gridSize = 20;    // how many cells per row/column
+    int m_gridSize = 20;    // grid cell size in pixels
     // TODO: load from config
     int m_initialAltitude = 0;                       // Initial altitude for the box
     int m_horizontalOffset = 600;                    // Horizontal offset for the box
@@ -327,5 +877,10 @@ private:
     int m_boxHeight = 20;                            // Height of the box
     int m_platformWidth = 100;                       // Width of the
     float m_pixelsPerMeter = 40.0f;                  // Pixels per meter for scaling
-    std::vector<std::unique_ptr<ISystem>> m_systems; // List of systems in the scene, looped over in the Update function
+    SystemPipeline<PhysicsSystem, CollisionSystem, BoxSystem, TextInterface> m_pipeline; // the game's systems, in update order
+    std::vector<std::unique_ptr<ISystem>> m_systems; // systems added at runtime (CreateSystem), updated after the pipeline
+    CollisionSystem *m_collisions = nullptr;         // in m_pipeline, reports where boxes land
+    ParticleSystem m_particles;                      // effects, not part of the registry
+    TripleBuffer<GravitySnapshot> m_snapshots;       // simulation -> renderer, see RenderSnapshot()
+    size_t m_dust = 0;                               // emitter index of the landing dust
 };
\ No newline at end of file
@@ -0,0 +1,365 @@
+/**
+ * @file Input.h
+ * @brief Per-frame input abstraction with recording and playback.
+ * @date 2025-07-20
+ * @details All simulations read keyboard, mouse and frame time through Input instead of raylib directly.
+ * Input::BeginFrame() samples raylib once per loop iteration into an InputFrame. That frame can be appended
+ * to a recording file, or replaced by the next frame of a playback file, which makes a session fully
+ * reproducible (including delta time) and usable as a headless regression benchmark.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <array>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+#include <raylib.h>
+
+#include "Log.h"
+
+/// @brief everything a simulation may read from the user during one frame
+struct InputFrame
+{
+    static constexpr int MAX_HELD_KEYS = 8; // more simultaneous keys than this are dropped
+
+    float deltaTime = 0.0f;
+    int16_t mouseX = 0;       // mouse position is quantized to whole pixels so live and replayed runs match
+    int16_t mouseY = 0;
+    uint8_t mouseButtons = 0; // bit n set while MouseButton n is held
+    uint8_t keyCount = 0;
+    std::array<uint16_t, MAX_HELD_KEYS> keys{}; // currently held raylib key codes
+    float mouseWheel = 0.0f;
+
+    bool HasKey(int key) const
+    {
+        for (uint8_t i = 0; i < keyCount; ++i)
+        {
+            if (keys[i] == key)
+                return true;
+        }
+        return false;
+    }
+
+    bool HasButton(int button) const { return (mouseButtons >> button) & 1u; }
+
+    /// @brief fold a later sample into this one, for a consumer that missed it. Held keys and buttons are
+    /// united so short presses aren't lost, the mouse is where it is now, wheel and time add up.
+    void Merge(const InputFrame &later)
+    {
+        for (uint8_t i = 0; i < later.keyCount; ++i)
+        {
+            if (keyCount < MAX_HELD_KEYS && !HasKey(later.keys[i]))
+                keys[keyCount++] = later.keys[i];
+        }
+        mouseButtons |= later.mouseButtons;
+        mouseX = later.mouseX;
+        mouseY = later.mouseY;
+        mouseWheel += later.mouseWheel;
+        deltaTime += later.deltaTime;
+    }
+};
+
+class Input
+{
+public:
+    enum class Mode
+    {
+        Live,     // sample raylib
+        Record,   // sample raylib and append every frame to a file
+        Playback, // feed frames from a file, raylib input is ignored
+    };
+
+    /// @brief start writing every sampled frame to a recording file
+    static bool StartRecording(const std::string &path)
+    {
+        State &s = Get();
+        s.file.open(path, std::ios::binary | std::ios::trunc);
+        if (!s.file)
+        {
+            Log::Error("Failed to open input recording: {}", path);
+            return false;
+        }
+        s.file.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        WriteValue(s.file, FILE_VERSION);
+        s.mode = Mode::Record;
+        s.current = s.previous = InputFrame{};
+        s.frameIndex = 0;
+        return true;
+    }
+
+    /// @brief load a recording; BeginFrame() then returns recorded frames until the file is exhausted
+    static bool StartPlayback(const std::string &path)
+    {
+        State &s = Get();
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+        {
+            Log::Error("Failed to open input recording: {}", path);
+            return false;
+        }
+        s.data.resize(static_cast<size_t>(in.tellg()));
+        in.seekg(0);
+        in.read(reinterpret_cast<char *>(s.data.data()), static_cast<std::streamsize>(s.data.size()));
+
+        char magic[sizeof(FILE_MAGIC)] = {};
+        uint16_t version = 0;
+        s.cursor = 0;
+        if (!ReadBytes(s, magic, sizeof(magic)) || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 ||
+            !ReadBytes(s, &version, sizeof(version)) || version != FILE_VERSION)
+        {
+            Log::Error("Not a valid input recording: {}", path);
+            s.data.clear();
+            return false;
+        }
+        s.mode = Mode::Playback;
+        s.current = s.previous = InputFrame{};
+        s.frameIndex = 0;
+        s.finished = false;
+        return true;
+    }
+
+    /// @brief sample (or replay) the input for the coming frame. Call once per loop iteration.
+    static void BeginFrame()
+    {
+        State &s = Get();
+        s.previous = s.current;
+        if (s.mode == Mode::Playback)
+        {
+            if (!DecodeFrame(s, s.current))
+            {
+                s.finished = true;
+                return;
+            }
+        }
+        else
+        {
+            SampleRaylib(s.current);
+            if (s.mode == Mode::Record)
+                EncodeFrame(s, s.current);
+        }
+        ++s.frameIndex;
+    }
+
+    /// @brief start a frame from input sampled on another thread (ISimulation::RunThreaded); not for playback
+    static void BeginFrame(const InputFrame &frame)
+    {
+        State &s = Get();
+        s.previous = s.current;
+        s.current = frame;
+        if (s.mode == Mode::Record)
+            EncodeFrame(s, s.current);
+        ++s.frameIndex;
+    }
+
+    /// @brief read raylib's input into frame, which must hold the previous sample (held keys carry over).
+    /// Window thread only.
+    static void Sample(InputFrame &frame) { SampleRaylib(frame); }
+
+    /// @brief close the active recording or playback.
+    /// @param stateHash hash of the simulation state after the last frame. Recordings store it, playback compares against it.
+    /// @return false if a playback ended in a different state than the one recorded
+    static bool Finish(uint64_t stateHash)
+    {
+        State &s = Get();
+        bool matched = true;
+        if (s.mode == Mode::Record)
+        {
+            s.file.put(static_cast<char>(END_MARKER));
+            WriteValue(s.file, stateHash);
+            s.file.close();
+            std::cout << "Recorded " << s.frameIndex << " frames, final state hash " << stateHash << std::endl;
+        }
+        else if (s.mode == Mode::Playback)
+        {
+            matched = s.expectedHash == stateHash;
+            std::cout << "Replayed " << s.frameIndex << " frames, final state hash " << stateHash
+                      << (matched ? " (matches recording)" : " (MISMATCH, recorded " + std::to_string(s.expectedHash) + ")") << std::endl;
+            s.data.clear();
+        }
+        s.mode = Mode::Live;
+        return matched;
+    }
+
+    static Mode GetMode() { return Get().mode; }
+    static bool IsPlaybackFinished() { return Get().finished; }
+    static uint32_t GetFrameIndex() { return Get().frameIndex; }
+    static const InputFrame &GetFrame() { return Get().current; }
+
+    // -- raylib-style queries, answered from the current frame --
+    static bool IsKeyDown(int key) { return Get().current.HasKey(key); }
+    static bool IsKeyPressed(int key) { return Get().current.HasKey(key) && !Get().previous.HasKey(key); }
+    static bool IsKeyReleased(int key) { return !Get().current.HasKey(key) && Get().previous.HasKey(key); }
+    static bool IsMouseButtonDown(int button) { return Get().current.HasButton(button); }
+    static bool IsMouseButtonPressed(int button) { return Get().current.HasButton(button) && !Get().previous.HasButton(button); }
+    static bool IsMouseButtonReleased(int button) { return !Get().current.HasButton(button) && Get().previous.HasButton(button); }
+    static Vector2 GetMousePosition() { return {static_cast<float>(Get().current.mouseX), static_cast<float>(Get().current.mouseY)}; }
+    static Vector2 GetMouseDelta()
+    {
+        return {static_cast<float>(Get().current.mouseX - Get().previous.mouseX), static_cast<float>(Get().current.mouseY - Get().previous.mouseY)};
+    }
+    static float GetMouseWheelMove() { return Get().current.mouseWheel; }
+    static float GetFrameTime() { return Get().current.deltaTime; }
+
+    /// @brief false if nothing was held, pressed, released, moved or scrolled this frame
+    static bool HasActivity()
+    {
+        const InputFrame &current = Get().current, &previous = Get().previous;
+        return current.keyCount > 0 || previous.keyCount > 0 || current.mouseButtons != 0 || previous.mouseButtons != 0 ||
+               current.mouseX != previous.mouseX || current.mouseY != previous.mouseY || current.mouseWheel != 0.0f;
+    }
+
+private:
+    static constexpr char FILE_MAGIC[4] = {'I', 'N', 'P', 'R'};
+    static constexpr uint16_t FILE_VERSION = 1;
+
+    // each frame starts with a byte of flags telling which fields follow; unchanged fields are omitted
+    static constexpr uint8_t FRAME_DELTA = 1 << 0;
+    static constexpr uint8_t FRAME_MOUSE = 1 << 1;
+    static constexpr uint8_t FRAME_BUTTONS = 1 << 2;
+    static constexpr uint8_t FRAME_KEYS = 1 << 3;
+    static constexpr uint8_t FRAME_WHEEL = 1 << 4;
+    static constexpr uint8_t END_MARKER = 0xFF; // followed by the final state hash
+    static constexpr float MAX_FRAME_TIME = 0.25f; // longer frames (idle waits, window drags) are clamped so nothing jumps
+
+    struct State
+    {
+        Mode mode = Mode::Live;
+        InputFrame current;
+        InputFrame previous;
+        uint32_t frameIndex = 0;
+
+        std::ofstream file;        // recording target
+        std::vector<uint8_t> data; // whole playback file, decoded frame by frame
+        size_t cursor = 0;
+        bool finished = false;
+        uint64_t expectedHash = 0;
+    };
+
+    static State &Get()
+    {
+        static State state;
+        return state;
+    }
+
+    static void SampleRaylib(InputFrame &frame)
+    {
+        // held keys: drop released ones, then append whatever raylib queued as newly pressed
+        InputFrame last = frame;
+        frame.keyCount = 0;
+        for (uint8_t i = 0; i < last.keyCount; ++i)
+        {
+            if (::IsKeyDown(last.keys[i]))
+                frame.keys[frame.keyCount++] = last.keys[i];
+        }
+        for (int key = GetKeyPressed(); key != 0; key = GetKeyPressed())
+        {
+            if (frame.keyCount < InputFrame::MAX_HELD_KEYS && !frame.HasKey(key))
+                frame.keys[frame.keyCount++] = static_cast<uint16_t>(key);
+        }
+
+        Vector2 mouse = ::GetMousePosition();
+        frame.mouseX = static_cast<int16_t>(mouse.x);
+        frame.mouseY = static_cast<int16_t>(mouse.y);
+        frame.mouseButtons = 0;
+        for (int button = MOUSE_BUTTON_LEFT; button <= MOUSE_BUTTON_MIDDLE; ++button)
+        {
+            if (::IsMouseButtonDown(button))
+                frame.mouseButtons |= static_cast<uint8_t>(1u << button);
+        }
+        frame.mouseWheel = ::GetMouseWheelMove();
+        frame.deltaTime = std::min(::GetFrameTime(), MAX_FRAME_TIME);
+    }
+
+    template <typename T>
+    static void WriteValue(std::ofstream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    static bool ReadBytes(State &s, void *dst, size_t size)
+    {
+        if (s.cursor + size > s.data.size())
+            return false;
+        std::memcpy(dst, s.data.data() + s.cursor, size);
+        s.cursor += size;
+        return true;
+    }
+
+    static void EncodeFrame(State &s, const InputFrame &frame)
+    {
+        const InputFrame &prev = s.previous;
+        uint8_t flags = 0;
+        if (frame.deltaTime != prev.deltaTime || s.frameIndex == 0)
+            flags |= FRAME_DELTA;
+        if (frame.mouseX != prev.mouseX || frame.mouseY != prev.mouseY)
+            flags |= FRAME_MOUSE;
+        if (frame.mouseButtons != prev.mouseButtons)
+            flags |= FRAME_BUTTONS;
+        if (frame.keyCount != prev.keyCount ||
+            std::memcmp(frame.keys.data(), prev.keys.data(), frame.keyCount * sizeof(uint16_t)) != 0)
+            flags |= FRAME_KEYS;
+        if (frame.mouseWheel != 0.0f)
+            flags |= FRAME_WHEEL;
+
+        s.file.put(static_cast<char>(flags));
+        if (flags & FRAME_DELTA)
+            WriteValue(s.file, frame.deltaTime);
+        if (flags & FRAME_MOUSE)
+        {
+            WriteValue(s.file, frame.mouseX);
+            WriteValue(s.file, frame.mouseY);
+        }
+        if (flags & FRAME_BUTTONS)
+            WriteValue(s.file, frame.mouseButtons);
+        if (flags & FRAME_KEYS)
+        {
+            WriteValue(s.file, frame.keyCount);
+            s.file.write(reinterpret_cast<const char *>(frame.keys.data()), frame.keyCount * sizeof(uint16_t));
+        }
+        if (flags & FRAME_WHEEL)
+            WriteValue(s.file, frame.mouseWheel);
+    }
+
+    static bool DecodeFrame(State &s, InputFrame &frame)
+    {
+        uint8_t flags = 0;
+        if (!ReadBytes(s, &flags, 1))
+            return false;
+        if (flags == END_MARKER)
+        {
+            ReadBytes(s, &s.expectedHash, sizeof(s.expectedHash));
+            return false;
+        }
+
+        bool ok = true;
+        if (flags & FRAME_DELTA)
+            ok &= ReadBytes(s, &frame.deltaTime, sizeof(frame.deltaTime));
+        if (flags & FRAME_MOUSE)
+        {
+            ok &= ReadBytes(s, &frame.mouseX, sizeof(frame.mouseX));
+            ok &= ReadBytes(s, &frame.mouseY, sizeof(frame.mouseY));
+        }
+        if (flags & FRAME_BUTTONS)
+            ok &= ReadBytes(s, &frame.mouseButtons, sizeof(frame.mouseButtons));
+        if (flags & FRAME_KEYS)
+        {
+            ok &= ReadBytes(s, &frame.keyCount, sizeof(frame.keyCount));
+            ok &= frame.keyCount <= InputFrame::MAX_HELD_KEYS &&
+                  ReadBytes(s, frame.keys.data(), frame.keyCount * sizeof(uint16_t));
+        }
+        frame.mouseWheel = 0.0f;
+        if (flags & FRAME_WHEEL)
+            ok &= ReadBytes(s, &frame.mouseWheel, sizeof(frame.mouseWheel));
+
+        if (!ok)
+            Log::Error("Input recording is truncated at frame {}", s.frameIndex);
+        return ok;
+    }
+};
@@ -0,0 +1,363 @@
+/**
+ * @file JobSystem.h
+ * @brief Work-stealing job system: small jobs with parent/child dependencies, spread over a fixed set of threads.
+ * @date 2025-08-04
+ * @details A Job is a function object stored inline in a fixed-size slot, so creating one never allocates. Every
+ * thread takes jobs from the back of its own deque and, when that is empty, steals from the front of another
+ * thread's, so recently pushed (small, cache-warm) work stays local and thieves take the oldest, largest pieces.
+ * Threads that are not workers of the system (the main thread, the simulation thread) share one extra deque.
+ *
+ * A job created with a parent only counts as finished once the parent and every child have run; Wait() on a job
+ * runs other jobs until that happens, so waiting inside a job never blocks a worker. ParallelFor splits an index
+ * range in halves into child jobs down to a grain size, ParallelEach does the same over an entt view or group.
+ *
+ * Job slots come from a per-thread ring of JOB_POOL jobs that is reused in order; a slot is only handed out again
+ * once its previous job finished, so a thread must not create more than JOB_POOL jobs while one it still holds
+ * (e.g. a parent it adds children to) is pending. Job functions have to fit Job::STORAGE bytes and be trivially
+ * destructible, in practice lambdas capturing references and pointers.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <entt/entt.hpp>
+
+namespace jobs
+{
+    // whether fn can be called with the elements of a tuple, to tell view.each style signatures apart
+    template <typename Fn, typename Tuple>
+    struct InvocableWith : std::false_type
+    {
+    };
+    template <typename Fn, typename... Args>
+    struct InvocableWith<Fn, std::tuple<Args...>> : std::is_invocable<Fn, Args...>
+    {
+    };
+}
+
+class JobSystem
+{
+public:
+    static constexpr size_t QUEUE_CAPACITY = 4096; // jobs per deque, a power of two; a full deque runs the job inline
+    static constexpr size_t JOB_POOL = 4096;       // job slots per thread, a power of two
+
+    /// @brief one unit of work; finished once its function and all of its children have run
+    struct alignas(64) Job
+    {
+        static constexpr size_t STORAGE = 104;
+
+        void (*run)(Job &) = nullptr;
+        Job *parent = nullptr;
+        std::atomic<int32_t> unfinished{0};    // the function itself plus unfinished children
+        alignas(8) unsigned char data[STORAGE]; // the function object
+
+        bool Done() const { return unfinished.load(std::memory_order_acquire) == 0; }
+    };
+
+    /// @param threads threads working on jobs, including the one waiting; 0 picks the hardware thread count
+    explicit JobSystem(size_t threads = 0)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        m_queues = std::make_unique<Queue[]>(threads); // [0] is shared by outside threads, [i] belongs to worker i
+        m_queueCount = threads;
+        m_workers.reserve(threads - 1);
+        for (size_t i = 1; i < threads; ++i)
+            m_workers.emplace_back(&JobSystem::WorkerMain, this, i);
+    }
+
+    ~JobSystem()
+    {
+        m_stop.store(true, std::memory_order_release);
+        m_queued.fetch_add(1, std::memory_order_release);
+        m_queued.notify_all();
+        for (std::thread &worker : m_workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    /// @brief threads working on jobs, including the caller of Wait()
+    size_t Size() const { return m_workers.size() + 1; }
+
+    /// @brief a job running fn() or fn(job), not started yet; with a parent, the parent isn't done before it
+    template <typename Fn>
+    Job *Create(Fn &&fn, Job *parent = nullptr)
+    {
+        using Function = std::decay_t<Fn>;
+        static_assert(sizeof(Function) <= Job::STORAGE, "job function too large, capture by reference");
+        static_assert(alignof(Function) <= 8, "job function over-aligned");
+        static_assert(std::is_trivially_destructible_v<Function>, "job functions are never destroyed, capture by reference");
+
+        Job *job = Allocate();
+        ::new (static_cast<void *>(job->data)) Function(std::forward<Fn>(fn));
+        job->run = [](Job &self)
+        {
+            Function &function = *std::launder(reinterpret_cast<Function *>(self.data));
+            if constexpr (std::is_invocable_v<Function &, Job &>)
+                function(self);
+            else
+                function();
+        };
+        job->parent = parent;
+        job->unfinished.store(1, std::memory_order_relaxed);
+        if (parent)
+            parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    /// @brief queue a created job on the calling thread's deque
+    void Run(Job *job)
+    {
+        if (!QueueOf().Push(job))
+        {
+            Execute(job); // deque full, nobody would get to it sooner
+            return;
+        }
+        m_queued.fetch_add(1, std::memory_order_release);
+        m_queued.notify_one();
+    }
+
+    /// @brief Create() and Run() in one
+    template <typename Fn>
+    Job *Schedule(Fn &&fn, Job *parent = nullptr)
+    {
+        Job *job = Create(std::forward<Fn>(fn), parent);
+        Run(job);
+        return job;
+    }
+
+    /// @brief run queued jobs until job and all of its children are done
+    void Wait(const Job *job)
+    {
+        while (!job->Done())
+        {
+            if (Job *next = Find())
+                Execute(next);
+            else
+                std::this_thread::yield(); // the rest is running on other threads
+        }
+    }
+
+    /// @brief fn(begin, end) over pieces of [0, count) no larger than grain, blocking until all returned
+    template <typename Fn>
+    void ParallelForRange(size_t count, size_t grain, Fn &&fn)
+    {
+        grain = std::max<size_t>(grain, 1);
+        if (m_workers.empty() || count <= grain)
+        {
+            if (count > 0)
+                fn(size_t{0}, count);
+            return;
+        }
+        Job *root = Schedule([this, &fn, count, grain](Job &self)
+                             { Split(self, fn, 0, count, grain); });
+        Wait(root);
+    }
+
+    /// @brief fn(i) for every i in [0, count), blocking until all calls returned
+    template <typename Fn>
+    void ParallelFor(size_t count, Fn &&fn)
+    {
+        const size_t grain = std::max<size_t>(1, count / (Size() * 8)); // enough pieces to steal, few enough to be cheap
+        ParallelForRange(count, grain, [&fn](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+                fn(i); });
+    }
+
+    /// @brief fn(entity, components...) or fn(components...) for every entity of an entt view, like view.each(fn),
+    /// in pieces of up to grain entities of the view's leading storage; fn must not add or remove its components
+    template <typename View, typename Fn>
+    void ParallelEach(const View &view, Fn &&fn, size_t grain = 1024)
+    {
+        const auto *leading = view.handle();
+        if (!leading)
+            return;
+        const auto *entities = leading->data();
+        ParallelForRange(leading->size(), grain, [&](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const auto entity = entities[i];
+                if (!view.contains(entity))
+                    continue; // missing another component, excluded, or a tombstone
+                if constexpr (jobs::InvocableWith<Fn &, decltype(std::tuple_cat(std::make_tuple(entity), view.get(entity)))>::value)
+                    std::apply(fn, std::tuple_cat(std::make_tuple(entity), view.get(entity)));
+                else
+                    std::apply(fn, view.get(entity));
+            } });
+    }
+
+    /// @brief ParallelEach over an entt group; its entities are the first size() of its leading storage, so unlike
+    /// a view nothing is probed to find them
+    template <typename... Owned, typename... Get, typename... Exclude, typename Fn>
+    void ParallelEach(const entt::basic_group<entt::owned_t<Owned...>, entt::get_t<Get...>, entt::exclude_t<Exclude...>> &group, Fn &&fn, size_t grain = 1024)
+    {
+        if (!group)
+            return;
+        const auto *entities = group.handle().data();
+        ParallelForRange(group.size(), grain, [&](size_t begin, size_t end)
+                         {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const auto entity = entities[i];
+                if constexpr (jobs::InvocableWith<Fn &, decltype(std::tuple_cat(std::make_tuple(entity), group.get(entity)))>::value)
+                    std::apply(fn, std::tuple_cat(std::make_tuple(entity), group.get(entity)));
+                else
+                    std::apply(fn, group.get(entity));
+            } });
+    }
+
+private:
+    // a deque behind a short spin lock; the owner and thieves work on opposite ends and rarely meet
+    struct alignas(64) Queue
+    {
+        std::atomic_flag lock;
+        size_t head = 0; // thieves take here
+        size_t tail = 0; // the owner pushes and pops here
+        Job *jobs[QUEUE_CAPACITY];
+
+        bool Push(Job *job)
+        {
+            Lock();
+            const bool room = tail - head < QUEUE_CAPACITY;
+            if (room)
+                jobs[tail++ & (QUEUE_CAPACITY - 1)] = job;
+            lock.clear(std::memory_order_release);
+            return room;
+        }
+
+        Job *Pop()
+        {
+            Lock();
+            Job *job = tail != head ? jobs[--tail & (QUEUE_CAPACITY - 1)] : nullptr;
+            lock.clear(std::memory_order_release);
+            return job;
+        }
+
+        Job *Steal()
+        {
+            Lock();
+            Job *job = tail != head ? jobs[head++ & (QUEUE_CAPACITY - 1)] : nullptr;
+            lock.clear(std::memory_order_release);
+            return job;
+        }
+
+        void Lock()
+        {
+            while (lock.test_and_set(std::memory_order_acquire))
+                std::this_thread::yield();
+        }
+    };
+
+    // the calling thread's job slots, shared by every JobSystem it uses
+    struct JobRing
+    {
+        std::unique_ptr<Job[]> jobs = std::make_unique<Job[]>(JOB_POOL);
+        size_t next = 0;
+    };
+
+    template <typename Fn>
+    void Split(Job &parent, Fn &fn, size_t begin, size_t end, size_t grain)
+    {
+        // hand off the upper half until the rest is small enough; thieves take the big halves pushed first
+        while (end - begin > grain)
+        {
+            const size_t middle = begin + (end - begin) / 2;
+            Schedule([this, &fn, middle, end, grain](Job &self)
+                     { Split(self, fn, middle, end, grain); }, &parent);
+            end = middle;
+        }
+        fn(begin, end);
+    }
+
+    Job *Allocate()
+    {
+        static thread_local JobRing ring;
+        Job *job = &ring.jobs[ring.next++ & (JOB_POOL - 1)];
+        Wait(job); // the slot's last job is still pending; only happens with thousands in flight
+        return job;
+    }
+
+    void Execute(Job *job)
+    {
+        job->run(*job);
+        // a finished job finishes its parent if it was the last thing the parent waited for
+        while (job)
+        {
+            Job *parent = job->parent; // read first, the slot can be reused once unfinished hits 0
+            if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                break;
+            job = parent;
+        }
+    }
+
+    /// @brief a job from this thread's deque, or stolen from another
+    Job *Find()
+    {
+        const size_t own = QueueIndex();
+        Job *job = m_queues[own].Pop();
+        if (!job)
+        {
+            // start the search at a random deque so thieves spread out
+            thread_local uint32_t rng = static_cast<uint32_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())) | 1u;
+            rng ^= rng << 13;
+            rng ^= rng >> 17;
+            rng ^= rng << 5;
+            for (size_t i = 0, start = rng % m_queueCount; i < m_queueCount && !job; ++i)
+            {
+                const size_t victim = (start + i) % m_queueCount;
+                if (victim != own)
+                    job = m_queues[victim].Steal();
+            }
+        }
+        if (job)
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    size_t QueueIndex() const { return t_system == this ? t_index : 0; }
+    Queue &QueueOf() { return m_queues[QueueIndex()]; }
+
+    void WorkerMain(size_t index)
+    {
+        t_system = this;
+        t_index = index;
+        while (!m_stop.load(std::memory_order_acquire))
+        {
+            if (Job *job = Find())
+            {
+                Execute(job);
+                continue;
+            }
+            const int32_t queued = m_queued.load(std::memory_order_acquire);
+            if (queued <= 0)
+                m_queued.wait(queued, std::memory_order_acquire); // sleeps until a job is queued or the system stops
+            else
+                std::this_thread::yield(); // queued but just taken, or about to be pushed
+        }
+    }
+
+    static inline thread_local const JobSystem *t_system = nullptr; // the system this thread is a worker of
+    static inline thread_local size_t t_index = 0;                  // its deque there
+
+    std::unique_ptr<Queue[]> m_queues;
+    size_t m_queueCount = 0;
+    std::vector<std::thread> m_workers;
+    alignas(64) std::atomic<int32_t> m_queued{0}; // jobs in the deques, can dip below 0 for a moment; workers sleep on it
+    std::atomic<bool> m_stop{false};
+};
@@ -0,0 +1,251 @@
+/**
+ * @file Log.h
+ * @brief Leveled logging that formats into a lock-free ring buffer drained by a background thread.
+ * @date 2025-08-02
+ * @details Log::Info("Brush size changed to: {}", size) formats straight into a fixed-size slot of a bounded
+ * multi-producer ring (the sequence-numbered queue of Vyukov), so the calling thread never takes a lock, never
+ * allocates and never waits for the console. A writer thread drains the ring in batches, writing Debug and
+ * Info to stdout and Warn and Error to stderr, with one flush per batch. When the ring is full the message is
+ * dropped and counted, the writer reports how many were lost. Messages longer than a slot are cut short.
+ *
+ * Levels below LOG_LEVEL (0 trace .. 4 error, default 2 = info; debug builds use 1) are removed at compile
+ * time: the call compiles to nothing but the evaluation of its arguments.
+ *
+ * Flush() blocks until everything logged before it has been written; use it before printing results
+ * directly to stdout so they come after the log. The writer is started on first use and drains the ring
+ * when the program exits.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <format>
+#include <string>
+#include <thread>
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 2
+#endif
+
+class Log
+{
+public:
+    enum class Level : uint8_t
+    {
+        Trace,
+        Debug,
+        Info,
+        Warn,
+        Error,
+    };
+
+    static constexpr Level MIN_LEVEL = static_cast<Level>(LOG_LEVEL);
+    static constexpr size_t SLOTS = 1024;    // messages in flight, a power of two
+    static constexpr size_t MAX_TEXT = 240; // characters kept per message
+
+    template <typename... Args>
+    static void Trace(std::format_string<Args...> format, Args &&...args) { Write<Level::Trace>(format, std::forward<Args>(args)...); }
+    template <typename... Args>
+    static void Debug(std::format_string<Args...> format, Args &&...args) { Write<Level::Debug>(format, std::forward<Args>(args)...); }
+    template <typename... Args>
+    static void Info(std::format_string<Args...> format, Args &&...args) { Write<Level::Info>(format, std::forward<Args>(args)...); }
+    template <typename... Args>
+    static void Warn(std::format_string<Args...> format, Args &&...args) { Write<Level::Warn>(format, std::forward<Args>(args)...); }
+    template <typename... Args>
+    static void Error(std::format_string<Args...> format, Args &&...args) { Write<Level::Error>(format, std::forward<Args>(args)...); }
+
+    /// @brief wait until every message logged before the call has been written
+    static void Flush() { Get().WaitWritten(); }
+
+    /// @brief messages lost to a full ring so far
+    static uint64_t Dropped() { return Get().m_dropped.load(std::memory_order_relaxed); }
+
+    Log(const Log &) = delete;
+    Log &operator=(const Log &) = delete;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{0}; // == position when free, position + 1 once the message is in
+        Level level = Level::Info;
+        uint16_t size = 0;
+        char text[MAX_TEXT];
+    };
+
+    Log()
+    {
+        for (size_t i = 0; i < SLOTS; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        m_writer = std::thread(&Log::WriterMain, this);
+    }
+
+    ~Log()
+    {
+        m_stop.store(true, std::memory_order_release);
+        Signal();
+        m_writer.join();
+    }
+
+    static Log &Get()
+    {
+        static Log log;
+        return log;
+    }
+
+    template <Level LEVEL, typename... Args>
+    static void Write(std::format_string<Args...> format, Args &&...args)
+    {
+        if constexpr (LEVEL >= MIN_LEVEL)
+            Get().Push(LEVEL, format, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void Push(Level level, std::format_string<Args...> format, Args &&...args)
+    {
+        // claim a position: the slot is free when its sequence caught up with it
+        uint64_t position = m_head.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;)
+        {
+            slot = &m_slots[position & (SLOTS - 1)];
+            const uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+            const int64_t lag = static_cast<int64_t>(sequence - position);
+            if (lag == 0)
+            {
+                if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (lag < 0)
+            {
+                m_dropped.fetch_add(1, std::memory_order_relaxed); // full, the writer is a whole ring behind
+                return;
+            }
+            else
+                position = m_head.load(std::memory_order_relaxed); // another producer took it
+        }
+
+        const auto result = std::format_to_n(slot->text, MAX_TEXT, format, std::forward<Args>(args)...);
+        slot->level = level;
+        slot->size = static_cast<uint16_t>(std::min<std::ptrdiff_t>(result.size, MAX_TEXT));
+        slot->sequence.store(position + 1, std::memory_order_release);
+        Signal();
+    }
+
+    void Signal()
+    {
+        m_signal.fetch_add(1, std::memory_order_release);
+        m_signal.notify_one();
+    }
+
+    void WaitWritten()
+    {
+        const uint64_t target = m_head.load(std::memory_order_acquire);
+        uint64_t written = m_written.load(std::memory_order_acquire);
+        while (written < target)
+        {
+            Signal();
+            m_written.wait(written, std::memory_order_acquire);
+            written = m_written.load(std::memory_order_acquire);
+        }
+    }
+
+    void WriterMain()
+    {
+        uint64_t tail = 0;
+        uint64_t reportedDrops = 0;
+        for (;;)
+        {
+            const uint64_t signal = m_signal.load(std::memory_order_acquire);
+            const bool stopping = m_stop.load(std::memory_order_acquire);
+
+            // take every published message in order; a claimed but unfinished slot ends the batch
+            for (;;)
+            {
+                Slot &slot = m_slots[tail & (SLOTS - 1)];
+                if (slot.sequence.load(std::memory_order_acquire) != tail + 1)
+                    break;
+                Emit(slot.level, slot.text, slot.size);
+                slot.sequence.store(tail + SLOTS, std::memory_order_release); // free for the next lap
+                ++tail;
+            }
+            const uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+            if (dropped != reportedDrops)
+            {
+                char text[64];
+                const auto result = std::format_to_n(text, sizeof(text), "{} log messages dropped, the log ring was full", dropped - reportedDrops);
+                Emit(Level::Warn, text, static_cast<size_t>(std::min<std::ptrdiff_t>(result.size, sizeof(text))));
+                reportedDrops = dropped;
+            }
+            FlushBatch();
+            m_written.store(tail, std::memory_order_release);
+            m_written.notify_all();
+
+            if (tail != m_head.load(std::memory_order_acquire))
+            {
+                std::this_thread::yield(); // a producer is still formatting into its slot
+                continue;
+            }
+            if (stopping)
+                return;
+            m_signal.wait(signal, std::memory_order_acquire);
+        }
+    }
+
+    // batches are gathered per stream and written with one call each
+    void Emit(Level level, const char *text, size_t size)
+    {
+        static constexpr const char *PREFIX[] = {"[trace] ", "[debug] ", "", "[warn] ", "[error] "};
+        Batch &batch = level >= Level::Warn ? m_errors : m_output;
+        const char *prefix = PREFIX[static_cast<size_t>(level)];
+        const size_t prefixSize = std::char_traits<char>::length(prefix);
+        if (batch.size + prefixSize + size + 1 > batch.buffer.size())
+            batch.Write();
+        batch.Append(prefix, prefixSize);
+        batch.Append(text, size);
+        batch.Append("\n", 1);
+    }
+
+    void FlushBatch()
+    {
+        m_output.Write();
+        m_errors.Write();
+    }
+
+    struct Batch
+    {
+        FILE *stream;
+        std::array<char, 16 * 1024> buffer;
+        size_t size = 0;
+
+        void Append(const char *text, size_t count)
+        {
+            count = std::min(count, buffer.size() - size);
+            std::copy_n(text, count, buffer.data() + size);
+            size += count;
+        }
+
+        void Write()
+        {
+            if (size == 0)
+                return;
+            std::fwrite(buffer.data(), 1, size, stream);
+            std::fflush(stream);
+            size = 0;
+        }
+    };
+
+    std::array<Slot, SLOTS> m_slots;
+    alignas(64) std::atomic<uint64_t> m_head{0};    // next position to claim, producers
+    alignas(64) std::atomic<uint64_t> m_signal{0};  // bumped on every publish, the writer sleeps on it
+    alignas(64) std::atomic<uint64_t> m_written{0}; // positions written out, for Flush()
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<bool> m_stop{false};
+    Batch m_output{stdout};
+    Batch m_errors{stderr};
+    std::thread m_writer;
+};
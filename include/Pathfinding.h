@@ -0,0 +1,389 @@
+/**
+ * @file Pathfinding.h
+ * @brief Grid pathfinding over a tile layer: cached A* paths and flow fields.
+ * @date 2025-07-27
+ * @details The tilemap is unbounded, so a Pathfinder works on a fixed window of one layer (the bounds) and
+ * keeps a dense copy of which tiles in it are walkable (value 0). Movement is 8-way without cutting corners,
+ * orthogonal steps cost 10 and diagonal steps 14.
+ *
+ * A* uses a binary heap and node arrays allocated once for the whole window. Each search bumps a generation
+ * counter instead of clearing them, so a short search only touches the nodes it visits. Flow fields are a
+ * Dijkstra expansion from the goal over the whole window; any number of agents then find their next step with
+ * one lookup.
+ *
+ * Found paths and fields are cached. OnTilesChanged() refreshes the walkable copy for the edited rect. An edit
+ * that only adds obstacles drops the cached paths whose bounding box it touches; one that opens a tile drops
+ * those whose search expanded a tile next to it, since a shorter path can only lead through there. Fields are
+ * dropped if the edit touches the tiles they reached, so sand moving elsewhere in the window keeps them.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Tilemap.h"
+
+struct GridPoint
+{
+    int x = 0, y = 0;
+
+    bool operator==(const GridPoint &other) const { return x == other.x && y == other.y; }
+};
+
+/// @brief distance and next step toward one goal for every reachable tile of a window
+struct FlowField
+{
+    static constexpr uint32_t UNREACHABLE = 0xFFFFFFFFu;
+    static constexpr uint8_t NONE = 0xFF;
+
+    GridPoint goal;
+    TileRect bounds;
+    TileRect reached; // tiles with a distance, edits one tile or more away from them can't change the field
+    std::vector<uint32_t> distance; // path cost to the goal, UNREACHABLE if there is no path
+    std::vector<uint8_t> direction; // index into the step tables of the next tile, NONE at the goal and unreachable tiles
+
+    /// @brief the tile to move to from (x, y)
+    /// @return false at the goal, outside the window, or where the goal can't be reached
+    bool Next(int x, int y, GridPoint &next) const;
+};
+
+class Pathfinder
+{
+public:
+    static constexpr int STRAIGHT_COST = 10;
+    static constexpr int DIAGONAL_COST = 14;
+    static constexpr size_t MAX_CACHED_PATHS = 4096;
+    static constexpr size_t MAX_CACHED_FIELDS = 4;
+
+    // the 8 steps, orthogonal first
+    static constexpr int DX[8] = {0, 1, 0, -1, 1, 1, -1, -1};
+    static constexpr int DY[8] = {-1, 0, 1, 0, -1, 1, 1, -1};
+
+    /// @brief search the window bounds of layer. Allocates the node arrays and copies the walkable tiles.
+    void Reset(const TileLayer &layer, const TileRect &bounds)
+    {
+        m_bounds = bounds;
+        m_width = bounds.x1 - bounds.x0;
+        const size_t cells = static_cast<size_t>(m_width) * static_cast<size_t>(bounds.y1 - bounds.y0);
+        m_walkable.assign(cells, 0);
+        m_nodes.assign(cells, Node{});
+        m_generation = 0;
+        InvalidateAll();
+        CopyWalkable(layer, bounds);
+    }
+
+    const TileRect &Bounds() const { return m_bounds; }
+
+    bool IsWalkable(int x, int y) const { return m_bounds.Contains(x, y) && m_walkable[Index(x, y)]; }
+
+    /// @brief tiles in rect changed: refresh them and drop the cached results that could have used them
+    void OnTilesChanged(const TileLayer &layer, const TileRect &rect)
+    {
+        const TileRect hit = Intersect(rect, m_bounds);
+        if (hit.Empty())
+            return;
+        // a new obstacle matters if it touches a path's bounding box; an opened tile if it borders the tiles the search
+        // expanded, any shortcut through it would have been found from one of them
+        const bool opened = CopyWalkable(layer, hit);
+        std::erase_if(m_paths, [&](const auto &entry)
+                      { return Touches(hit, opened ? entry.second.searched : entry.second.box); });
+        std::erase_if(m_fields, [&](const std::unique_ptr<FlowField> &field)
+                      { return Touches(hit, field->reached); });
+    }
+
+    void InvalidateAll()
+    {
+        m_paths.clear();
+        m_pathOrder.clear();
+        m_fields.clear();
+    }
+
+    /// @brief cached shortest path from start to goal, both inclusive
+    /// @return nullptr if either end is blocked or outside the window, or there is no path
+    const std::vector<GridPoint> *FindPath(GridPoint start, GridPoint goal)
+    {
+        if (!IsWalkable(start.x, start.y) || !IsWalkable(goal.x, goal.y))
+            return nullptr;
+        const uint64_t key = (static_cast<uint64_t>(Index(start.x, start.y)) << 32) | Index(goal.x, goal.y);
+        auto it = m_paths.find(key);
+        if (it == m_paths.end())
+        {
+            if (m_paths.size() >= MAX_CACHED_PATHS)
+                EvictOldestPath();
+            CachedPath entry;
+            entry.box = Search(start, goal, entry.points) ? BoundingBox(entry.points) : m_bounds; // a failed search may have looked anywhere
+            entry.searched = m_searched;
+            it = m_paths.emplace(key, std::move(entry)).first;
+            m_pathOrder.push_back(key);
+            if (m_pathOrder.size() > 2 * MAX_CACHED_PATHS)
+                std::erase_if(m_pathOrder, [this](uint64_t old)
+                              { return m_paths.count(old) == 0; }); // keys of paths dropped by edits
+        }
+        return it->second.points.empty() ? nullptr : &it->second.points;
+    }
+
+    /// @brief uncached A*; Searched() is then the bounding box of the tiles it expanded
+    /// @return false if there is no path
+    bool Search(GridPoint start, GridPoint goal, std::vector<GridPoint> &path)
+    {
+        path.clear();
+        if (!IsWalkable(start.x, start.y) || !IsWalkable(goal.x, goal.y))
+            return false;
+        const uint32_t generation = NextGeneration();
+        const int32_t startIndex = Index(start.x, start.y), goalIndex = Index(goal.x, goal.y);
+
+        m_heap.clear();
+        m_searched = {};
+        m_nodes[startIndex] = {0, -1, generation, 0};
+        PushHeap({Heuristic(start.x, start.y, goal), 0, startIndex});
+
+        while (!m_heap.empty())
+        {
+            const HeapNode top = PopHeap();
+            Node &node = m_nodes[top.index];
+            if (node.closed == generation)
+                continue; // an older entry of a node that was reached more cheaply later
+            node.closed = generation;
+            const int x = m_bounds.x0 + top.index % m_width, y = m_bounds.y0 + top.index / m_width;
+            m_searched.Merge({x, y, x + 1, y + 1});
+            if (top.index == goalIndex)
+                break;
+
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                if (!CanStep(x, y, dir))
+                    continue;
+                const int nx = x + DX[dir], ny = y + DY[dir];
+                const int32_t next = Index(nx, ny);
+                const uint32_t cost = node.cost + (dir < 4 ? STRAIGHT_COST : DIAGONAL_COST);
+                Node &neighbour = m_nodes[next];
+                if (neighbour.closed == generation || (neighbour.seen == generation && neighbour.cost <= cost))
+                    continue;
+                neighbour = {cost, top.index, generation, neighbour.closed};
+                PushHeap({cost + Heuristic(nx, ny, goal), cost, next});
+            }
+        }
+
+        if (m_nodes[goalIndex].closed != generation)
+            return false;
+        for (int32_t index = goalIndex; index != -1; index = m_nodes[index].parent)
+            path.push_back({m_bounds.x0 + index % m_width, m_bounds.y0 + index / m_width});
+        std::reverse(path.begin(), path.end());
+        return true;
+    }
+
+    /// @brief cached flow field toward goal, nullptr if the goal is blocked or outside the window
+    const FlowField *GetFlowField(GridPoint goal)
+    {
+        if (!IsWalkable(goal.x, goal.y))
+            return nullptr;
+        for (const auto &field : m_fields)
+        {
+            if (field->goal == goal)
+                return field.get();
+        }
+        if (m_fields.size() >= MAX_CACHED_FIELDS)
+            m_fields.pop_front();
+        auto field = std::make_unique<FlowField>();
+        BuildFlowField(goal, *field);
+        m_fields.push_back(std::move(field));
+        return m_fields.back().get();
+    }
+
+    /// @brief Dijkstra from the goal over the whole window
+    void BuildFlowField(GridPoint goal, FlowField &field)
+    {
+        field.goal = goal;
+        field.bounds = m_bounds;
+        field.reached = {};
+        field.distance.assign(m_walkable.size(), FlowField::UNREACHABLE);
+        field.direction.assign(m_walkable.size(), FlowField::NONE);
+        if (!IsWalkable(goal.x, goal.y))
+            return;
+
+        m_heap.clear();
+        const int32_t goalIndex = Index(goal.x, goal.y);
+        field.distance[goalIndex] = 0;
+        PushHeap({0, 0, goalIndex});
+        while (!m_heap.empty())
+        {
+            const HeapNode node = PopHeap();
+            if (node.cost != field.distance[node.index])
+                continue; // stale entry
+            const int x = m_bounds.x0 + node.index % m_width, y = m_bounds.y0 + node.index / m_width;
+            field.reached.Merge({x, y, x + 1, y + 1});
+            for (int dir = 0; dir < 8; ++dir)
+            {
+                // steps are symmetric, so walking from the neighbour back to here is allowed iff this step is
+                if (!CanStep(x, y, dir))
+                    continue;
+                const int32_t next = Index(x + DX[dir], y + DY[dir]);
+                const uint32_t cost = node.cost + (dir < 4 ? STRAIGHT_COST : DIAGONAL_COST);
+                if (cost >= field.distance[next])
+                    continue;
+                field.distance[next] = cost;
+                field.direction[next] = static_cast<uint8_t>(Opposite(dir));
+                PushHeap({cost, cost, next});
+            }
+        }
+    }
+
+    size_t CachedPaths() const { return m_paths.size(); }
+    size_t CachedFields() const { return m_fields.size(); }
+
+    const TileRect &Searched() const { return m_searched; }
+
+    /// @brief true if the step from (x, y) in direction dir stays on walkable tiles and cuts no corner
+    bool CanStep(int x, int y, int dir) const
+    {
+        const int nx = x + DX[dir], ny = y + DY[dir];
+        if (!IsWalkable(nx, ny))
+            return false;
+        return dir < 4 || (m_walkable[Index(nx, y)] && m_walkable[Index(x, ny)]);
+    }
+
+    static int Opposite(int dir) { return dir < 4 ? (dir + 2) % 4 : 4 + (dir - 4 + 2) % 4; }
+
+private:
+    struct HeapNode
+    {
+        uint32_t priority; // cost + heuristic
+        uint32_t cost;
+        int32_t index;
+    };
+
+    // A* state of one tile, valid where the stamps equal the current generation
+    struct Node
+    {
+        uint32_t cost = 0;
+        int32_t parent = -1;
+        uint32_t seen = 0;   // generation that last reached it
+        uint32_t closed = 0; // generation that expanded it
+    };
+
+    struct CachedPath
+    {
+        std::vector<GridPoint> points; // empty if there is no path
+        TileRect box;                  // tiles the result depends on
+        TileRect searched;             // tiles the search expanded
+    };
+
+    int32_t Index(int x, int y) const { return (y - m_bounds.y0) * m_width + (x - m_bounds.x0); }
+
+    /// @brief octile distance, exact on an open grid so A* stays optimal
+    static uint32_t Heuristic(int x, int y, GridPoint goal)
+    {
+        const int dx = std::abs(x - goal.x), dy = std::abs(y - goal.y);
+        return static_cast<uint32_t>(STRAIGHT_COST * std::max(dx, dy) + (DIAGONAL_COST - STRAIGHT_COST) * std::min(dx, dy));
+    }
+
+    // min-heap on priority, ties go to the deeper node so searches run straight at the goal
+    static bool HeapLess(const HeapNode &a, const HeapNode &b)
+    {
+        return a.priority != b.priority ? a.priority > b.priority : a.cost < b.cost;
+    }
+
+    void PushHeap(const HeapNode &node)
+    {
+        m_heap.push_back(node);
+        std::push_heap(m_heap.begin(), m_heap.end(), HeapLess);
+    }
+
+    HeapNode PopHeap()
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), HeapLess);
+        HeapNode node = m_heap.back();
+        m_heap.pop_back();
+        return node;
+    }
+
+    uint32_t NextGeneration()
+    {
+        if (++m_generation == 0)
+        {
+            // wrapped after 4 billion searches, stamps from the previous cycle would look current
+            std::fill(m_nodes.begin(), m_nodes.end(), Node{});
+            m_generation = 1;
+        }
+        return m_generation;
+    }
+
+    /// @return true if a tile that was blocked became walkable
+    bool CopyWalkable(const TileLayer &layer, const TileRect &rect)
+    {
+        Tilemap::Reader reader{layer};
+        bool opened = false;
+        for (int y = rect.y0; y < rect.y1; ++y)
+        {
+            for (int x = rect.x0; x < rect.x1; ++x)
+            {
+                const uint8_t walkable = reader.Get(x, y) == 0;
+                uint8_t &cell = m_walkable[Index(x, y)];
+                opened |= walkable && !cell;
+                cell = walkable;
+            }
+        }
+        return opened;
+    }
+
+    void EvictOldestPath()
+    {
+        // keys of paths already dropped by an edit are skipped
+        while (!m_pathOrder.empty())
+        {
+            const uint64_t key = m_pathOrder.front();
+            m_pathOrder.pop_front();
+            if (m_paths.erase(key))
+                return;
+        }
+    }
+
+    static TileRect Intersect(const TileRect &a, const TileRect &b)
+    {
+        return {std::max(a.x0, b.x0), std::max(a.y0, b.y0), std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+    }
+
+    /// @brief true if rect touches box or the tiles around it, the margin covers the corner rule
+    static bool Touches(const TileRect &rect, const TileRect &box)
+    {
+        return !box.Empty() && !Intersect(rect, {box.x0 - 1, box.y0 - 1, box.x1 + 1, box.y1 + 1}).Empty();
+    }
+
+    static TileRect BoundingBox(const std::vector<GridPoint> &points)
+    {
+        TileRect box;
+        for (const GridPoint &p : points)
+            box.Merge({p.x, p.y, p.x + 1, p.y + 1});
+        return box;
+    }
+
+    TileRect m_bounds;
+    int m_width = 0;
+    std::vector<uint8_t> m_walkable; // 1 where the layer is empty
+
+    std::vector<Node> m_nodes; // one per tile of the window, allocated by Reset()
+    uint32_t m_generation = 0;
+    std::vector<HeapNode> m_heap;
+    TileRect m_searched; // expanded by the last Search()
+
+    std::unordered_map<uint64_t, CachedPath> m_paths; // by (start index, goal index)
+    std::deque<uint64_t> m_pathOrder;                  // insertion order, for eviction
+    std::deque<std::unique_ptr<FlowField>> m_fields;
+};
+
+inline bool FlowField::Next(int x, int y, GridPoint &next) const
+{
+    if (!bounds.Contains(x, y))
+        return false;
+    const uint8_t dir = direction[(y - bounds.y0) * (bounds.x1 - bounds.x0) + (x - bounds.x0)];
+    if (dir == NONE)
+        return false;
+    next = {x + Pathfinder::DX[dir], y + Pathfinder::DY[dir]};
+    return true;
+}
@@ -0,0 +1,385 @@
+/**
+ * @file RenderBackend.h
+ * @brief Drawing interface for the map and entities, with a raylib (GPU) and a software (CPU) implementation.
+ * @date 2025-08-06
+ * @details Tilemap::Draw(..., backend) and GravityGame::DrawSnapshot issue their drawing through an IRenderBackend:
+ *   RaylibRenderer   - the usual GPU path, between BeginDrawing and EndDrawing
+ *   SoftwareRenderer - rasterizes into its own RGBA frame with span fills, 4 pixels per SSE store, so frames can
+ *                      be produced and compared without a window (MatchGolden)
+ *   DrawList         - records the calls to replay them later, which lets a benchmark time building a frame's
+ *                      draw calls apart from executing them
+ * Text needs a font atlas on the GPU, the software renderer skips it. Shapes cover the pixels whose centres
+ * they contain, and translucent colours blend like raylib's default alpha mode.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <raylib.h>
+
+#include "Tilemap.h"
+#include "Log.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RENDER_SSE 1
+#else
+#define RENDER_SSE 0
+#endif
+
+class IRenderBackend
+{
+public:
+    virtual ~IRenderBackend() = default;
+
+    virtual void Clear(Color color) = 0;
+    virtual void FillRect(Rectangle rect, Color color) = 0;
+    /// @brief one pixel wide outline along the inside of rect
+    virtual void RectLines(Rectangle rect, Color color) = 0;
+    virtual void Line(Vector2 from, Vector2 to, Color color) = 0;
+    virtual void Text(const char *text, Vector2 position, int fontSize, Color color) = 0;
+    /// @brief a chunk's autotiled tiles stretched over dest, as issued by Tilemap::Draw
+    virtual void Chunk(TileLayer &layer, uint64_t key, TileChunk &chunk, Rectangle dest) = 0;
+};
+
+class RaylibRenderer final : public IRenderBackend
+{
+public:
+    void Clear(Color color) override { ClearBackground(color); }
+    void FillRect(Rectangle rect, Color color) override { DrawRectangleRec(rect, color); }
+    void RectLines(Rectangle rect, Color color) override { DrawRectangleLines((int)rect.x, (int)rect.y, (int)rect.width, (int)rect.height, color); }
+    void Line(Vector2 from, Vector2 to, Color color) override { DrawLineV(from, to, color); }
+    void Text(const char *text, Vector2 position, int fontSize, Color color) override { DrawText(text, (int)position.x, (int)position.y, fontSize, color); }
+    void Chunk(TileLayer &layer, uint64_t key, TileChunk &chunk, Rectangle dest) override { Tilemap::DrawBaked(layer, key, chunk, dest); }
+};
+
+class SoftwareRenderer final : public IRenderBackend
+{
+public:
+    SoftwareRenderer(int width, int height)
+        : m_width(width), m_height(height), m_pixels(static_cast<size_t>(width) * height, BLANK), m_texels(Tilemap::BAKED_SIZE * Tilemap::BAKED_SIZE)
+    {
+    }
+
+    int Width() const { return m_width; }
+    int Height() const { return m_height; }
+    Color Pixel(int x, int y) const { return m_pixels[static_cast<size_t>(y) * m_width + x]; }
+
+    /// @brief the frame as an RGBA image viewing the renderer's pixels, e.g. for ExportImage; don't unload it
+    Image Frame() const { return {const_cast<Color *>(m_pixels.data()), m_width, m_height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8}; }
+
+    void Clear(Color color) override
+    {
+        FillSpan(m_pixels.data(), static_cast<int>(m_pixels.size()), color);
+    }
+
+    void FillRect(Rectangle rect, Color color) override
+    {
+        const int x0 = Edge(rect.x), x1 = Edge(rect.x + rect.width);
+        const int y0 = std::max(0, Edge(rect.y)), y1 = std::min(m_height, Edge(rect.y + rect.height));
+        for (int y = y0; y < y1; ++y)
+            Span(y, x0, x1, color);
+    }
+
+    void RectLines(Rectangle rect, Color color) override
+    {
+        const int x0 = Edge(rect.x), x1 = Edge(rect.x + rect.width);
+        const int y0 = Edge(rect.y), y1 = Edge(rect.y + rect.height);
+        if (x1 <= x0 || y1 <= y0)
+            return;
+        Span(y0, x0, x1, color);
+        if (y1 - 1 > y0)
+            Span(y1 - 1, x0, x1, color);
+        for (int y = std::max(0, y0 + 1); y < std::min(m_height, y1 - 1); ++y)
+        {
+            Span(y, x0, x0 + 1, color);
+            if (x1 - 1 > x0)
+                Span(y, x1 - 1, x1, color);
+        }
+    }
+
+    void Line(Vector2 from, Vector2 to, Color color) override
+    {
+        const int fromX = static_cast<int>(std::floor(from.x)), fromY = static_cast<int>(std::floor(from.y));
+        const int toX = static_cast<int>(std::floor(to.x)), toY = static_cast<int>(std::floor(to.y));
+        if (fromY == toY) // grid lines are spans
+        {
+            Span(fromY, std::min(fromX, toX), std::max(fromX, toX) + 1, color);
+            return;
+        }
+        const int steps = std::max(std::abs(toX - fromX), std::abs(toY - fromY));
+        for (int i = 0; i <= steps; ++i)
+        {
+            const int x = fromX + static_cast<int>(std::lround(static_cast<double>(toX - fromX) * i / steps));
+            const int y = fromY + static_cast<int>(std::lround(static_cast<double>(toY - fromY) * i / steps));
+            Span(y, x, x + 1, color);
+        }
+    }
+
+    void Text(const char *, Vector2, int, Color) override {} // no font atlas on the CPU
+
+    void Chunk(TileLayer &, uint64_t, TileChunk &chunk, Rectangle dest) override
+    {
+        constexpr int TEXELS = Tilemap::BAKED_SIZE;
+        Tilemap::ShadeChunk(chunk, m_texels.data());
+
+        // pixel edges of every texel column and row, nearest-neighbour like the GPU path
+        int columns[TEXELS + 1], rows[TEXELS + 1];
+        for (int i = 0; i <= TEXELS; ++i)
+        {
+            columns[i] = Edge(dest.x + dest.width * i / TEXELS);
+            rows[i] = Edge(dest.y + dest.height * i / TEXELS);
+        }
+        for (int ty = 0; ty < TEXELS; ++ty)
+        {
+            const int y0 = std::max(0, rows[ty]), y1 = std::min(m_height, rows[ty + 1]);
+            if (y0 >= y1)
+                continue;
+            const Color *texel = m_texels.data() + ty * TEXELS;
+            for (int tx = 0; tx < TEXELS;)
+            {
+                // one span per run of equal texels
+                int end = tx + 1;
+                while (end < TEXELS && SameColor(texel[end], texel[tx]))
+                    ++end;
+                if (texel[tx].a != 0)
+                {
+                    for (int y = y0; y < y1; ++y)
+                        Span(y, columns[tx], columns[end], texel[tx]);
+                }
+                tx = end;
+            }
+        }
+    }
+
+    /// @brief count = pixels from row, opaque colours overwrite and translucent ones blend
+    static void BlendSpan(Color *row, int count, Color color)
+    {
+        if (color.a == 255)
+        {
+            FillSpan(row, count, color);
+            return;
+        }
+        if (color.a == 0)
+            return;
+
+        int i = 0;
+#if RENDER_SSE
+        // out = (source * a + destination * (255 - a)) / 255 per channel, in 16-bit lanes, 4 pixels at a time;
+        // the alpha channel blends a source alpha of 255, as raylib's blend mode does
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i source = _mm_set_epi16(255, color.b, color.g, color.r, 255, color.b, color.g, color.r);
+        const __m128i weighted = _mm_mullo_epi16(source, _mm_set1_epi16(color.a));
+        const __m128i inverse = _mm_set1_epi16(static_cast<short>(255 - color.a));
+        const __m128i half = _mm_set1_epi16(128);
+        auto blend = [&](__m128i destination)
+        {
+            __m128i sum = _mm_add_epi16(_mm_add_epi16(weighted, _mm_mullo_epi16(destination, inverse)), half);
+            return _mm_srli_epi16(_mm_add_epi16(sum, _mm_srli_epi16(sum, 8)), 8); // exact division by 255
+        };
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i));
+            const __m128i low = blend(_mm_unpacklo_epi8(pixels, zero)), high = blend(_mm_unpackhi_epi8(pixels, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; i < count; ++i)
+        {
+            Color &pixel = row[i];
+            pixel = {Blend(color.r, pixel.r, color.a), Blend(color.g, pixel.g, color.a), Blend(color.b, pixel.b, color.a), Blend(255, pixel.a, color.a)};
+        }
+    }
+
+    static void FillSpan(Color *row, int count, Color color)
+    {
+        int i = 0;
+#if RENDER_SSE
+        uint32_t value;
+        std::memcpy(&value, &color, sizeof(value));
+        const __m128i fill = _mm_set1_epi32(static_cast<int>(value));
+        for (; i + 4 <= count; i += 4)
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(row + i), fill);
+#endif
+        for (; i < count; ++i)
+            row[i] = color;
+    }
+
+private:
+    /// @brief first pixel whose centre is at or past coordinate
+    static int Edge(float coordinate) { return static_cast<int>(std::ceil(coordinate - 0.5f)); }
+
+    static unsigned char Blend(int source, int destination, int alpha)
+    {
+        const int sum = source * alpha + destination * (255 - alpha) + 128;
+        return static_cast<unsigned char>((sum + (sum >> 8)) >> 8); // same rounding as the SSE path
+    }
+
+    static bool SameColor(Color a, Color b) { return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a; }
+
+    void Span(int y, int x0, int x1, Color color)
+    {
+        if (y < 0 || y >= m_height)
+            return;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, m_width);
+        if (x0 < x1)
+            BlendSpan(m_pixels.data() + static_cast<size_t>(y) * m_width + x0, x1 - x0, color);
+    }
+
+    int m_width;
+    int m_height;
+    std::vector<Color> m_pixels;
+    std::vector<Color> m_texels; // the chunk being drawn, shaded
+};
+
+/// @brief backend that records calls for Replay(); chunk commands point at the map, replay before it changes
+class DrawList final : public IRenderBackend
+{
+public:
+    void Clear(Color color) override { m_commands.push_back({Command::Clear, color}); }
+    void FillRect(Rectangle rect, Color color) override { m_commands.push_back({Command::FillRect, color, rect}); }
+    void RectLines(Rectangle rect, Color color) override { m_commands.push_back({Command::RectLines, color, rect}); }
+    void Line(Vector2 from, Vector2 to, Color color) override { m_commands.push_back({Command::Line, color, {from.x, from.y, to.x, to.y}}); }
+
+    void Text(const char *text, Vector2 position, int fontSize, Color color) override
+    {
+        Command command = {Command::Text, color, {position.x, position.y, 0, 0}};
+        command.fontSize = fontSize;
+        command.textOffset = m_text.size();
+        m_text.append(text).push_back('\0'); // copied, the caller's string may not outlive the list
+        m_commands.push_back(command);
+    }
+
+    void Chunk(TileLayer &layer, uint64_t key, TileChunk &chunk, Rectangle dest) override
+    {
+        Command command = {Command::Chunk, BLANK, dest};
+        command.layer = &layer;
+        command.key = key;
+        command.chunk = &chunk;
+        m_commands.push_back(command);
+    }
+
+    /// @brief forget the recorded calls, keeping the memory for the next frame
+    void Reset()
+    {
+        m_commands.clear();
+        m_text.clear();
+    }
+
+    size_t Size() const { return m_commands.size(); }
+
+    void Replay(IRenderBackend &backend) const
+    {
+        for (const Command &command : m_commands)
+        {
+            const Rectangle &r = command.rect;
+            switch (command.type)
+            {
+            case Command::Clear:
+                backend.Clear(command.color);
+                break;
+            case Command::FillRect:
+                backend.FillRect(r, command.color);
+                break;
+            case Command::RectLines:
+                backend.RectLines(r, command.color);
+                break;
+            case Command::Line:
+                backend.Line({r.x, r.y}, {r.width, r.height}, command.color);
+                break;
+            case Command::Text:
+                backend.Text(m_text.c_str() + command.textOffset, {r.x, r.y}, command.fontSize, command.color);
+                break;
+            case Command::Chunk:
+                backend.Chunk(*command.layer, command.key, *command.chunk, r);
+                break;
+            }
+        }
+    }
+
+private:
+    struct Command
+    {
+        enum Type : uint8_t
+        {
+            Clear,
+            FillRect,
+            RectLines,
+            Line,
+            Text,
+            Chunk
+        };
+        Type type;
+        Color color;
+        Rectangle rect{};          // Line: from in x, y and to in width, height
+        int fontSize = 0;
+        size_t textOffset = 0;
+        TileLayer *layer = nullptr;
+        uint64_t key = 0;
+        TileChunk *chunk = nullptr;
+    };
+
+    std::vector<Command> m_commands;
+    std::string m_text; // Text strings, each ending in '\0'
+};
+
+/// @brief pixels differing by more than tolerance in any channel; -1 if the sizes differ
+inline int CompareImages(const Image &a, const Image &b, int tolerance = 0)
+{
+    if (a.width != b.width || a.height != b.height || a.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 || b.format != PIXELFORMAT_UNCOMPRESSED_R8G8B8A8)
+        return -1;
+    const unsigned char *pa = static_cast<const unsigned char *>(a.data), *pb = static_cast<const unsigned char *>(b.data);
+    int differing = 0;
+    for (size_t i = 0, count = static_cast<size_t>(a.width) * a.height; i < count; ++i, pa += 4, pb += 4)
+    {
+        for (int channel = 0; channel < 4; ++channel)
+        {
+            if (std::abs(pa[channel] - pb[channel]) > tolerance)
+            {
+                ++differing;
+                break;
+            }
+        }
+    }
+    return differing;
+}
+
+/// @brief compare a frame with the golden image at path, or with update set, (re)record it from the frame
+/// @return false if the golden image is missing or differs, or couldn't be written
+inline bool MatchGolden(const Image &frame, const std::string &path, int tolerance = 0, bool update = false)
+{
+    if (!update && !std::filesystem::exists(path))
+    {
+        Log::Error("Missing golden image: {}", path);
+        return false;
+    }
+    if (update)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        if (!ExportImage(frame, path.c_str()))
+        {
+            Log::Error("Failed to write golden image: {}", path);
+            return false;
+        }
+        Log::Info("Recorded golden image: {}", path);
+        return true;
+    }
+
+    Image golden = LoadImage(path.c_str());
+    ImageFormat(&golden, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    const int differing = CompareImages(frame, golden, tolerance);
+    UnloadImage(golden);
+    if (differing != 0)
+        Log::Error("Frame differs from {}: {}", path, differing < 0 ? std::string("size") : std::to_string(differing) + " pixels");
+    return differing == 0;
+}
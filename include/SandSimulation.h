@@ -0,0 +1,368 @@
+/**
+ * @file SandSimulation.h
+ * @brief Falling-sand rules for the sand and water tiles of one layer, stepped in parallel over awake chunks.
+ * @date 2025-08-07
+ * @details Every Step() moves each sand and water tile at most one tile: sand falls straight or diagonally down,
+ * sinking through water; water falls the same way and spreads sideways when pushed by the tile above or the
+ * water beside it, or where it can drop over an edge, so pools spread out and come to rest. Stone and every
+ * other value stay put.
+ *
+ * Only awake chunks are scanned, and only inside their awake rect: the tiles that moved last step (plus one tile
+ * around them) and anything written through FillSpan or streamed in since (TileLayer::edits). Settled ground
+ * costs nothing. A step runs in four passes over a 2 x 2 checkerboard of chunks; the chunks of one pass are a
+ * chunk apart and tiles move one tile, so no two jobs touch the same tile and the result doesn't depend on the
+ * thread count. Chunks next to awake ones are allocated before the passes and freed again if they stay empty.
+ * A neighbour the layer's ChunkStore may still hold isn't allocated, it acts as a wall until it streams in.
+ *
+ * Tiles only move inside bounds, its edges act as walls. The simulation's own moves aren't recorded as undo
+ * history; Changed() lists where the last step moved tiles so the owner can cut them out of it (TileHistory::
+ * Forget), which would otherwise write the old values back wherever the sand went since.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Tilemap.h"
+#include "JobSystem.h"
+
+class SandSimulation
+{
+public:
+    explicit SandSimulation(const TileRect &bounds) : m_bounds(bounds) {}
+
+    const TileRect &Bounds() const { return m_bounds; }
+
+    /// @brief chunks that will be scanned by the next Step()
+    size_t AwakeChunks() const { return m_awake; }
+
+    /// @brief tiles moved from or to by the last Step(), one rect per chunk that moved any
+    const std::vector<TileRect> &Changed() const { return m_changed; }
+
+    /// @brief scan the tiles in rect on the next Step(), e.g. after writing tiles without FillSpan
+    void Wake(const TileRect &rect)
+    {
+        const TileRect area = Intersect(rect, m_bounds);
+        if (area.Empty())
+            return;
+        for (int cy = TileChunk::ChunkCoord(area.y0); cy <= TileChunk::ChunkCoord(area.y1 - 1); ++cy)
+        {
+            for (int cx = TileChunk::ChunkCoord(area.x0); cx <= TileChunk::ChunkCoord(area.x1 - 1); ++cx)
+            {
+                State &state = StateOf(TileChunk::Key(cx, cy));
+                m_awake += state.next.Empty();
+                state.next.Merge(Intersect(area, ChunkRect(cx, cy)));
+            }
+        }
+    }
+
+    /// @brief advance one tick on layer; the first step on a layer wakes all of its chunks inside the bounds
+    /// @return true if any tile moved
+    bool Step(TileLayer &layer, JobSystem &jobs)
+    {
+        if (m_layer != &layer)
+        {
+            m_layer = &layer;
+            m_states.clear();
+            m_awake = 0;
+            for (const auto &[key, chunk] : layer.chunks)
+                Wake(ChunkRect(TileChunk::KeyX(key), TileChunk::KeyY(key)));
+        }
+        layer.edits = &m_edits;
+        for (const TileRect &edit : m_edits)
+            Wake({edit.x0 - 1, edit.y0 - 1, edit.x1 + 1, edit.y1 + 1}); // the tiles above an erased one may fall now
+        m_edits.clear();
+        m_stamp = m_stamp == UINT16_MAX ? 1 : m_stamp + 1; // 0 is what fresh chunks hold
+
+        Prepare(layer);
+        for (int parity = 0; parity < 4; ++parity)
+        {
+            m_pass.clear();
+            for (Work &work : m_work)
+            {
+                if (((work.cx & 1) | (work.cy & 1) << 1) == parity)
+                    m_pass.push_back(&work);
+            }
+            jobs.ParallelFor(m_pass.size(), [this](size_t i)
+                             { Simulate(*m_pass[i]); });
+        }
+        return Finish(layer, jobs);
+    }
+
+private:
+    struct State
+    {
+        TileRect awake;                                       // scanned this step, clipped to the chunk
+        TileRect next;                                        // scanned next step
+        TileRect changed;                                     // tiles moved from or to by this chunk's job this step
+        TileRect masks;                                       // tiles of this chunk whose autotile masks may have changed
+        bool written = false;                                 // a tile of this chunk changed this step
+        bool touched = false;                                 // listed in m_touched
+        bool allocated = false;                               // allocated empty by the simulation, never written since
+        std::array<uint16_t, TileChunk::SIZE * TileChunk::SIZE> moved{}; // step stamp of the last move into each tile
+    };
+
+    // an awake chunk and its neighbourhood, [4] being the chunk itself; gathered before the passes
+    struct Work
+    {
+        int cx = 0, cy = 0;
+        std::array<TileChunk *, 9> chunks{};
+        std::array<State *, 9> states{};
+    };
+
+    static TileRect ChunkRect(int cx, int cy)
+    {
+        return {cx << TileChunk::SHIFT, cy << TileChunk::SHIFT, (cx + 1) << TileChunk::SHIFT, (cy + 1) << TileChunk::SHIFT};
+    }
+
+    static TileRect Intersect(const TileRect &a, const TileRect &b)
+    {
+        return {std::max(a.x0, b.x0), std::max(a.y0, b.y0), std::min(a.x1, b.x1), std::min(a.y1, b.y1)};
+    }
+
+    State &StateOf(uint64_t key)
+    {
+        std::unique_ptr<State> &state = m_states[key];
+        if (!state)
+            state = std::make_unique<State>();
+        return *state;
+    }
+
+    /// @brief turn last step's wake-ups into this step's work, allocating the chunks tiles may move into
+    void Prepare(TileLayer &layer)
+    {
+        m_work.clear();
+        for (auto it = m_states.begin(); it != m_states.end();)
+        {
+            State &state = *it->second;
+            state.awake = state.next;
+            state.next = {};
+            if (layer.chunks.find(it->first) == layer.chunks.end())
+            {
+                it = m_states.erase(it); // erased since, nothing left to move here
+                continue;
+            }
+            if (!state.awake.Empty())
+                m_work.push_back({TileChunk::KeyX(it->first), TileChunk::KeyY(it->first)});
+            ++it;
+        }
+
+        for (Work &work : m_work)
+        {
+            for (int i = 0; i < 9; ++i)
+            {
+                const int cx = work.cx + i % 3 - 1, cy = work.cy + i / 3 - 1;
+                if (Intersect(ChunkRect(cx, cy), m_bounds).Empty())
+                    continue; // tiles never move there
+                const uint64_t key = TileChunk::Key(cx, cy);
+                if (layer.store && !layer.chunks.count(key) && layer.store->Stored(key))
+                    continue; // allocating it empty would replace the stored chunk on save
+                auto [it, created] = layer.chunks.try_emplace(key);
+                work.states[i] = &StateOf(key);
+                if (created)
+                {
+                    it->second = std::make_unique<TileChunk>();
+                    work.states[i]->allocated = true;
+                }
+                work.chunks[i] = it->second.get();
+            }
+        }
+        m_awake = 0;
+    }
+
+    /// @brief move the sand and water tiles in one chunk's awake rect, bottom row first
+    void Simulate(Work &work)
+    {
+        State &state = *work.states[4];
+        TileChunk &chunk = *work.chunks[4];
+        const TileRect area = state.awake;
+        const int baseX = work.cx << TileChunk::SHIFT, baseY = work.cy << TileChunk::SHIFT;
+        const bool leftToRight = (m_stamp & 1) != 0; // alternate so nothing drifts one way
+        const int width = area.x1 - area.x0;
+
+        // a tile within one tile of the chunk, nullptr outside the bounds or in a chunk that isn't loaded yet
+        auto at = [&](int x, int y, State *&owner, int &index) -> ecs::Tile *
+        {
+            if (!m_bounds.Contains(x, y))
+                return nullptr;
+            const int dx = TileChunk::ChunkCoord(x) - work.cx, dy = TileChunk::ChunkCoord(y) - work.cy;
+            const int slot = (dy + 1) * 3 + dx + 1;
+            if (!work.chunks[slot])
+                return nullptr;
+            index = TileChunk::LocalCoord(y) * TileChunk::SIZE + TileChunk::LocalCoord(x);
+            owner = work.states[slot];
+            return work.chunks[slot]->tiles.data() + index;
+        };
+
+        for (int y = area.y1 - 1; y >= area.y0; --y)
+        {
+            ecs::Tile *row = chunk.Row(y - baseY);
+            for (int i = 0; i < width; ++i)
+            {
+                const int x = leftToRight ? area.x0 + i : area.x1 - 1 - i;
+                const int local = x - baseX;
+                const int value = row[local].value;
+                if (value != TILE_SAND && value != TILE_WATER)
+                    continue;
+                const int index = (y - baseY) * TileChunk::SIZE + local;
+                if (state.moved[index] == m_stamp)
+                    continue; // moved here this step
+
+                // targets in order of preference; the diagonal and sideways order is a hash of position and step
+                const int first = Hash(x, y) & 1 ? 1 : -1;
+                int targets[5][2] = {{0, 1}, {first, 1}, {-first, 1}, {first, 0}, {-first, 0}};
+                const int count = value == TILE_SAND ? 3 : 5;
+                for (int t = 0; t < count; ++t)
+                {
+                    const int tx = x + targets[t][0], ty = y + targets[t][1];
+                    State *owner = nullptr;
+                    int targetIndex = 0;
+                    ecs::Tile *target = at(tx, ty, owner, targetIndex);
+                    if (!target)
+                        continue;
+                    const bool open = target->value == 0 || (value == TILE_SAND && target->value == TILE_WATER);
+                    if (!open)
+                        continue;
+                    if (ty == y)
+                    {
+                        // water only spreads when pushed, from above or by the water behind it, or toward an edge it
+                        // can drop over, so lone drops rest; gaps between water only close rightward (they drift left
+                        // and out) since closing them both ways would swap two tiles back and forth forever
+                        State *ignored = nullptr;
+                        int unused = 0;
+                        const ecs::Tile *above = at(x, y - 1, ignored, unused);
+                        const ecs::Tile *behind = at(2 * x - tx, y, ignored, unused);
+                        const ecs::Tile *beyond = at(2 * tx - x, y, ignored, unused);
+                        const ecs::Tile *below = at(tx, ty + 1, ignored, unused);
+                        const bool pushed = (above && (above->value == TILE_SAND || above->value == TILE_WATER)) ||
+                                            (behind && behind->value == TILE_WATER && (tx > x || !beyond || beyond->value != TILE_WATER));
+                        const bool edge = below && below->value == 0;
+                        if (!pushed && !edge)
+                            continue;
+                    }
+
+                    std::swap(row[local].value, target->value);
+                    owner->moved[targetIndex] = m_stamp;
+                    state.moved[index] = m_stamp; // water pushed up by sinking sand rests for this step
+                    state.changed.Merge({std::min(x, tx), std::min(y, ty), std::max(x, tx) + 1, std::max(y, ty) + 1});
+                    break;
+                }
+            }
+        }
+    }
+
+    /// @brief wake the neighbourhood of every move, refresh counts and masks, free chunks that stayed empty
+    /// @return true if any tile moved
+    bool Finish(TileLayer &layer, JobSystem &jobs)
+    {
+        m_touched.clear();
+        m_changed.clear();
+        TileRect changed;
+        for (Work &work : m_work)
+        {
+            State &state = *work.states[4];
+            if (state.changed.Empty())
+                continue;
+            changed.Merge(state.changed);
+            m_changed.push_back(state.changed);
+            const TileRect grown = {state.changed.x0 - 1, state.changed.y0 - 1, state.changed.x1 + 1, state.changed.y1 + 1};
+            for (int i = 0; i < 9; ++i)
+            {
+                State *neighbour = work.states[i];
+                if (!neighbour)
+                    continue;
+                const TileRect chunkRect = ChunkRect(work.cx + i % 3 - 1, work.cy + i / 3 - 1);
+                const TileRect wake = Intersect(Intersect(grown, chunkRect), m_bounds);
+                if (wake.Empty())
+                    continue;
+                neighbour->next.Merge(wake);
+                neighbour->masks.Merge(wake);
+                neighbour->written |= !Intersect(state.changed, chunkRect).Empty();
+                if (!neighbour->touched)
+                {
+                    neighbour->touched = true;
+                    m_touched.push_back({work.chunks[i], neighbour});
+                }
+            }
+            state.changed = {};
+        }
+
+        // every job below writes only its own chunk
+        jobs.ParallelFor(m_touched.size(), [&](size_t i)
+                         {
+            TileChunk &chunk = *m_touched[i].first;
+            State &state = *m_touched[i].second;
+            if (state.written)
+            {
+                state.allocated = false;
+                int filled = 0;
+                for (const ecs::Tile &tile : chunk.tiles)
+                    filled += tile.value != 0;
+                chunk.filled = filled;
+                chunk.dirty = chunk.stale = true;
+            }
+            Tilemap::UpdateMasks(layer, state.masks); });
+
+        for (auto &[chunk, state] : m_touched)
+        {
+            state->masks = {};
+            state->written = state->touched = false;
+        }
+
+        // chunks that are empty now and have nothing to do next step go, as FillSpan would free them
+        auto release = [&](uint64_t key)
+        {
+            auto it = layer.chunks.find(key);
+            if (it == layer.chunks.end() || it->second->filled != 0)
+                return;
+            auto state = m_states.find(key);
+            if (!state->second->next.Empty())
+                return;
+            layer.chunks.erase(it);
+            if (layer.freedChunks && !state->second->allocated)
+                layer.freedChunks->push_back(key); // only chunks that held tiles, the others were never stored
+            m_states.erase(state);
+        };
+        for (const Work &work : m_work)
+        {
+            for (int i = 0; i < 9; ++i)
+            {
+                if (work.chunks[i])
+                    release(TileChunk::Key(work.cx + i % 3 - 1, work.cy + i / 3 - 1));
+            }
+        }
+
+        for (const auto &[key, state] : m_states)
+            m_awake += !state->next.Empty();
+        if (changed.Empty())
+            return false;
+        layer.dirty.Merge(changed);
+        ++layer.revision;
+        return true;
+    }
+
+    uint32_t Hash(int x, int y) const
+    {
+        uint32_t h = static_cast<uint32_t>(x) * 0x9E3779B1u ^ static_cast<uint32_t>(y) * 0x85EBCA77u ^ m_stamp * 0xC2B2AE3Du;
+        h ^= h >> 15;
+        h *= 0x2C1B3C6Du;
+        return h ^ (h >> 12);
+    }
+
+    TileRect m_bounds;
+    const TileLayer *m_layer = nullptr;                            // layer of the last Step()
+    std::unordered_map<uint64_t, std::unique_ptr<State>> m_states; // by TileChunk::Key
+    std::vector<TileRect> m_edits;                                 // TileLayer::edits target
+    std::vector<TileRect> m_changed;                               // moved by the last step, per chunk
+    std::vector<Work> m_work;                                      // this step's awake chunks
+    std::vector<Work *> m_pass;                                    // those of the current checkerboard pass
+    std::vector<std::pair<TileChunk *, State *>> m_touched;        // chunks whose tiles or masks may have changed
+    size_t m_awake = 0;
+    uint16_t m_stamp = 0; // step counter, tells tiles moved this step apart
+};
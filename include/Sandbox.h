@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <format>
 #include <string>
@@ -31,9 +32,27 @@
 #include "SidePanel.h"
 
 #include "Tilemap.h"
-
-class PhysicsSystem : public ISystem
+#include "TileBrush.h"
+#include "TileHistory.h"
+#include "TileStreamer.h"
+#include "TileGenerator.h"
+#include "Pathfinding.h"
+#include "SandSimulation.h"
+#include "Particles.h"
+#include "FrameArena.h"
+#include "AllocTracker.h"
+#include "Log.h"
+#include "Input.h"
+
+/// @brief what the sandbox's drawn tiles and grid depend on; the map is only redrawn when it changes
+struct MapViewKey
 {
+    int cameraX = 0, cameraY = 0;
+    int width = 0, height = 0;
+    bool grid = false;
+    uint64_t revisions = 0;     // sum of the layer revisions
+    uint32_t visibleLayers = 0; // bit per layer
+    bool operator==(const MapViewKey &) const = default;
 };
 
 class Sandbox : public ISimulation
@@ -43,55 +62,73 @@ public:
             unsigned int flags = FLAG_WINDOW_RESIZABLE, int fps = 60)
         : ISimulation(screenWidth, screenHeight, title, flags, fps)
     {
-        Init();
     }
 
     void Init() override
     {
-        // calculate how many tiles it would take to fit the defined area
-        // Reserve space for the side panel
-        int drawingAreaWidth = m_screenWidth - m_sidePanelWidth;
-
+        // the tilemap is unbounded, chunks are allocated as they are painted
         m_tilemap.tileSize = 20;
-        m_tilemap.tiles.resize((drawingAreaWidth / m_tilemap.tileSize) * (m_screenHeight / m_tilemap.tileSize), ecs::Tile{0}); // Initialize tilemap with empty tiles
-
-        // Initialize the side panel
-        m_sidePanel = std::make_unique<SidePanelGUI>(m_screenWidth - m_sidePanelWidth, 0, m_sidePanelWidth, m_screenHeight, LIGHTGRAY);
-
-        
-        m_sidePanel->SetOnClearCallback([this]()
-                                        { ClearTilemap(); });
-        m_sidePanel->SetOnSaveCallback([this]()
-                                       { SaveTilemap(); });
-        m_sidePanel->SetOnGridToggleCallback([this](bool enabled)
-                                             { m_drawGrid = enabled; });
-        m_sidePanel->SetOnBrushSizeChanged([this](int size)
-                                           { 
-            m_brushSize = size; 
-            std::cout << "Brush size changed to: " << size << std::endl; });
+        m_tilemap.layers.clear();
+        for (const char *name : LAYER_NAMES)
+            Tilemap::AddLayer(m_tilemap, name);
+        m_tilemap.activeLayer = 1; // start on the collision layer
+
+        // Initialize the side panel, it talks to the sandbox through m_events
+        m_sidePanel = std::make_unique<SidePanelGUI>(m_events, m_screenWidth - m_sidePanelWidth, 0, m_sidePanelWidth, m_screenHeight, LIGHTGRAY);
+
+        m_events.UnsubscribeAll();
+        m_events.Subscribe<events::ClearTilemap, &Sandbox::OnClearTilemap>(*this);
+        m_events.Subscribe<events::SaveTilemap, &Sandbox::OnSaveTilemap>(*this);
+        m_events.Subscribe<events::GridToggled, &Sandbox::OnGridToggled>(*this);
+        m_events.Subscribe<events::BrushSizeChanged, &Sandbox::OnBrushSizeChanged>(*this);
+        m_events.Subscribe<events::BrushTypeChanged, &Sandbox::OnBrushTypeChanged>(*this);
+        m_events.Subscribe<events::LayerCycled, &Sandbox::OnLayerCycled>(*this);
+        m_events.Subscribe<events::LayerVisibilityToggled, &Sandbox::OnLayerVisibilityToggled>(*this);
+        m_events.Subscribe<events::GeneratorChanged, &Sandbox::OnGeneratorChanged>(*this);
+        m_events.Subscribe<events::GenerateTilemap, &Sandbox::OnGenerateTilemap>(*this);
         m_sidePanel->Init();
 
-        // load serialized tilemap from a file or string
-        std::string serializedTilemap = "tilemap\n tileSize 20\n 0 0 0 0 0 0 0 0 0 0 \n";
+        m_particles.LoadTextures();
+        m_sparks = m_particles.AddEmitter(EmitterSettings::Sparks(), 16384);
+
+        // stream each layer from its own file around the camera. Recorded and replayed sessions start from an
+        // empty map, so their final state doesn't depend on the files or on load timing.
+        if (Input::GetMode() == Input::Mode::Live)
+        {
+            for (size_t i = 0; i < LAYER_NAMES.size(); ++i)
+                m_streamers[i].Open(LayerPath(i));
+        }
+        // recorded and replayed sessions draw every frame, so they run the same frames as before
+        m_idleRendering = Input::GetMode() == Input::Mode::Live;
+
         // Initialize entities and components here
-        std::cout << "Sandbox initialized." << std::endl;
+        Log::Info("Sandbox initialized.");
     }
 
     void HandleInput() override
     {
         // Handle user input here
-        if (IsKeyPressed(KEY_ESCAPE))
+        if (Input::IsKeyPressed(KEY_ESCAPE))
         {
             CloseWindow(); // Close the window on ESC key press
         }
 
-        if (IsKeyPressed(KEY_G))
+        if (Input::IsKeyPressed(KEY_G))
         {
             m_drawGrid = !m_drawGrid; // Toggle grid visibility
         }
 
+        // I switches between idle rendering and drawing every frame
+        if (Input::IsKeyPressed(KEY_I))
+        {
+            m_idleRendering = !m_idleRendering;
+            if (!m_idleRendering)
+                DisableEventWaiting();
+            Log::Info("Idle rendering {}", m_idleRendering ? "on" : "off");
+        }
+
         // Handle side panel input with proper coordinate transformation
-        Vector2 mousePos = GetMousePosition();
+        Vector2 mousePos = Input::GetMousePosition();
         Vector2 panelOffset = {(float)(m_screenWidth - m_sidePanelWidth), 0.0f};
 
         // Check if mouse is over the side panel area
@@ -100,92 +137,186 @@ public:
         {
             // Handle side panel interactions manually
             HandleSidePanelInput(mousePos, panelOffset);
+            if (m_stroke.active && !Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT) && !Input::IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
+                EndStroke(); // stroke released over the panel, line/rectangle shapes are dropped
         }
         else
         {
             // Only handle tile drawing if mouse is not over the side panel
-            int drawingAreaWidth = m_screenWidth - m_sidePanelWidth;
+            HandleBrushInput(mousePos);
+        }
 
-            if (mousePos.x < drawingAreaWidth) // Only draw tiles in the drawing area
-            {
-                // Draw tiles based on mouse position but don't add them permanently
-                int tileIndex = (static_cast<int>(mousePos.y) / m_tilemap.tileSize) * (drawingAreaWidth / m_tilemap.tileSize) +
-                                (static_cast<int>(mousePos.x) / m_tilemap.tileSize);
-                if (tileIndex < 0 || tileIndex >= static_cast<int>(m_tilemap.tiles.size()))
-                {
-                    std::cout << "Mouse position out of bounds for tilemap." << std::endl;
-                    return; // Prevent out-of-bounds access
-                }
-
-                // Use brush size for tile drawing
-                if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
-                {
-                    DrawBrushTiles(mousePos, 1, drawingAreaWidth); // Draw tiles with brush
-                }
-
-                // Right click to erase tiles while dragging
-                if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
-                {
-                    DrawBrushTiles(mousePos, 0, drawingAreaWidth); // Erase tiles with brush
-                }
-            }
+        // T flood fills the region under the cursor, limited to the visible area
+        if (Input::IsKeyPressed(KEY_T))
+        {
+            int tileX, tileY;
+            ScreenToTile(mousePos, tileX, tileY);
+            m_history.BeginStroke(m_tilemap);
+            TileBrush::FloodFill(m_tilemap, tileX, tileY, m_paintValue, VisibleTiles());
+            m_history.EndStroke(m_tilemap);
         }
 
-        static bool full = false;
-        if (IsKeyPressed(KEY_T) || IsKeyDown(KEY_T))
+        // 1-7 pick the tile value the left button paints: 5 sand, 6 water, 7 stone
+        for (int value = 1; value < static_cast<int>(std::size(TILE_COLORS)); ++value)
         {
-            if (!full)
-            {
-                // add tile
-                bool added = false;
-                for (size_t i = 0; i < m_tilemap.tiles.size() && !added; i++)
-                {
-                    if (m_tilemap.tiles[i].value == 0)
-                    {
-                        m_tilemap.tiles[i].value = 1;
-                        added = true;
-                    }
-                }
-                if (!added)
-                    full = true;
-            }
-            else
+            if (Input::IsKeyPressed(KEY_ZERO + value))
             {
-                std::cout << "full on tiles!\n";
+                m_paintValue = value;
+                Log::Info("Painting tile value {}", value);
             }
         }
 
+        // Arrow keys or middle mouse drag pan the view
+        const float panSpeed = 600.0f * Input::GetFrameTime();
+        if (Input::IsKeyDown(KEY_LEFT))
+            m_camera.x -= panSpeed;
+        if (Input::IsKeyDown(KEY_RIGHT))
+            m_camera.x += panSpeed;
+        if (Input::IsKeyDown(KEY_UP))
+            m_camera.y -= panSpeed;
+        if (Input::IsKeyDown(KEY_DOWN))
+            m_camera.y += panSpeed;
+        if (Input::IsMouseButtonDown(MOUSE_BUTTON_MIDDLE))
+        {
+            Vector2 delta = Input::GetMouseDelta();
+            m_camera.x -= delta.x;
+            m_camera.y -= delta.y;
+        }
+
+        // Ctrl+Z undoes the last stroke, Ctrl+Y or Ctrl+Shift+Z redoes it
+        bool ctrl = Input::IsKeyDown(KEY_LEFT_CONTROL) || Input::IsKeyDown(KEY_RIGHT_CONTROL);
+        bool shift = Input::IsKeyDown(KEY_LEFT_SHIFT) || Input::IsKeyDown(KEY_RIGHT_SHIFT);
+        if (ctrl && !m_stroke.active)
+        {
+            if (Input::IsKeyPressed(KEY_Y) || (shift && Input::IsKeyPressed(KEY_Z)))
+                m_history.Redo(m_tilemap);
+            else if (Input::IsKeyPressed(KEY_Z))
+                m_history.Undo(m_tilemap);
+        }
+
+        // L edits the next layer, H hides or shows it
+        if (Input::IsKeyPressed(KEY_L))
+        {
+            m_events.Enqueue(events::LayerCycled{});
+        }
+        if (Input::IsKeyPressed(KEY_H))
+        {
+            m_events.Enqueue(events::LayerVisibilityToggled{!Tilemap::Active(m_tilemap).visible});
+        }
+
+        // Q sets the start of the debug path, which then follows the cursor over the collision layer
+        if (Input::IsKeyPressed(KEY_Q))
+        {
+            int tileX, tileY;
+            ScreenToTile(mousePos, tileX, tileY);
+            SetPathStart({tileX, tileY});
+        }
+
+        // N picks the next generator
+        if (Input::IsKeyPressed(KEY_N))
+        {
+            m_events.Enqueue(events::GeneratorChanged{NextGeneratorType(m_generator)});
+        }
+
+        // B cycles through the brush types
+        if (Input::IsKeyPressed(KEY_B))
+        {
+            m_events.Enqueue(events::BrushTypeChanged{NextBrushType(m_brushType)});
+        }
+
         // print tilemap
-        if (IsKeyPressed(KEY_P))
+        if (Input::IsKeyPressed(KEY_P))
         {
-            std::cout << Tilemap::Serialize(m_tilemap) << std::endl;
+            FrameString text = MakeFrameString();
+            Tilemap::Serialize(m_tilemap, text);
+            std::cout << text << std::endl;
         }
     }
 
     void Update(float deltaTime) override
     {
+        // sync point: apply everything the GUI queued while handling input
+        {
+            AllocTracker::Scope scope("events");
+            m_events.Dispatch();
+        }
+        {
+            AllocTracker::Scope scope("streaming");
+            const TileRect view = VisibleTiles();
+            for (size_t i = 0; i < LAYER_NAMES.size(); ++i)
+            {
+                m_streamers[i].Update(m_tilemap.layers[i], view);
+                for (const TileStreamer::Arrival &arrival : m_streamers[i].Arrived())
+                    m_history.Resolve(static_cast<int>(i), arrival.key, arrival.stored.get()); // undo needs what edits covered
+            }
+        }
+        {
+            AllocTracker::Scope scope("sand");
+            m_sandTime = std::min(m_sandTime + deltaTime, MAX_SAND_STEPS * SAND_STEP); // slow frames drop steps
+            while (m_sandTime >= SAND_STEP)
+            {
+                if (m_sand.Step(m_tilemap.layers[SAND_LAYER], m_jobs))
+                    m_history.Forget(SAND_LAYER, m_sand.Changed()); // undo would put moved sand back where it was painted
+                m_sandTime -= SAND_STEP;
+            }
+        }
+        {
+            AllocTracker::Scope scope("pathfinding");
+            UpdatePath();
+        }
+        {
+            AllocTracker::Scope scope("particles");
+            m_particles.Update(deltaTime);
+        }
+        m_redraw |= Input::HasActivity() || IsWindowResized() || IsAnimating() || MapView() != m_mapCacheView;
+
         // Update simulation state here
         static float last = 0;
         accumulated_time += deltaTime;
         if ((accumulated_time - last) > 1.0f)
         {
             last = accumulated_time;
-            std::cout << "Updating sandbox with delta time: " << deltaTime << std::endl;
+            Log::Debug("Updating sandbox with delta time: {}", deltaTime);
         }
     }
 
     void Render() override
     {
+        if (m_idleRendering && !m_redraw)
+        {
+            PollInputEvents(); // nothing changed: keep the last frame on screen and sleep until the next event
+            return;
+        }
+        m_redraw = false;
+
         BeginDrawing();
         ClearBackground(RAYWHITE); // Clear the background with white color
 
-        // Draw tiles in the main drawing area
-        DrawTiles();
+        // Draw tiles and the grid in the main drawing area
+        if (m_idleRendering)
+            DrawMapCached();
+        else
+            DrawMap();
 
-        // Draw grid if enabled
-        if (m_drawGrid)
+        DrawPath();
+        m_particles.Draw(m_camera);
+
+        // Outline of the line/rectangle being dragged, it is only written on release
+        if (m_stroke.active && (m_brushType == BrushType::Line || m_brushType == BrushType::Rectangle))
         {
-            DrawGrid(m_screenWidth - m_sidePanelWidth, m_screenHeight, m_tilemap.tileSize);
+            int ts = m_tilemap.tileSize;
+            int ox = static_cast<int>(m_camera.x), oy = static_cast<int>(m_camera.y);
+            if (m_brushType == BrushType::Line)
+            {
+                DrawLine(m_stroke.startX * ts + ts / 2 - ox, m_stroke.startY * ts + ts / 2 - oy,
+                         m_stroke.lastX * ts + ts / 2 - ox, m_stroke.lastY * ts + ts / 2 - oy, RED);
+            }
+            else
+            {
+                int x0 = std::min(m_stroke.startX, m_stroke.lastX), y0 = std::min(m_stroke.startY, m_stroke.lastY);
+                int x1 = std::max(m_stroke.startX, m_stroke.lastX), y1 = std::max(m_stroke.startY, m_stroke.lastY);
+                DrawRectangleLines(x0 * ts - ox, y0 * ts - oy, (x1 - x0 + 1) * ts, (y1 - y0 + 1) * ts, RED);
+            }
         }
 
         // Render side panel using the modular GUI system
@@ -199,16 +330,88 @@ public:
             DrawRectangleLinesEx({panelOffset.x, panelOffset.y, (float)m_sidePanelWidth, (float)m_screenHeight}, 2, BLACK);
 
             // Render the side panel content with offset
+            AllocTracker::Scope scope("GUI render");
             RenderSidePanelWithOffset(panelOffset);
         }
 
+        AllocTracker::DrawOverlay(10, 10);
+
+        // EndDrawing() waits for the next event unless something has to keep moving
+        if (m_idleRendering)
+        {
+            if (IsAnimating())
+                DisableEventWaiting();
+            else
+                EnableEventWaiting();
+        }
         EndDrawing();
     }
 
-    void DrawTiles()
+    /// @brief tile layers and grid of the drawing area
+    void DrawMap()
     {
+        AllocTracker::Scope scope("tilemap draw");
         int drawingAreaWidth = m_screenWidth - m_sidePanelWidth;
-        Tilemap::Draw(m_tilemap, drawingAreaWidth, m_screenHeight); // Draw the tilemap
+        Tilemap::Draw(m_tilemap, m_camera, drawingAreaWidth, m_screenHeight); // Draw the tilemap
+        if (m_drawGrid)
+        {
+            DrawGrid(drawingAreaWidth, m_screenHeight, m_tilemap.tileSize);
+        }
+    }
+
+    /// @brief DrawMap() through a render texture that is only redrawn when the map view changed, so frames
+    /// woken by the side panel, the path or the cursor just blit it
+    void DrawMapCached()
+    {
+        const MapViewKey view = MapView();
+        if (m_mapCache.id == 0 || m_mapCache.texture.width != view.width || m_mapCache.texture.height != view.height)
+        {
+            if (m_mapCache.id != 0)
+                UnloadRenderTexture(m_mapCache);
+            m_mapCache = LoadRenderTexture(view.width, view.height);
+            m_mapCacheView = {};
+        }
+        if (view != m_mapCacheView)
+        {
+            BeginTextureMode(m_mapCache);
+            ClearBackground(RAYWHITE);
+            DrawMap();
+            EndTextureMode();
+            m_mapCacheView = view;
+        }
+        // render textures are stored upside down
+        DrawTextureRec(m_mapCache.texture, {0.0f, 0.0f, (float)view.width, (float)-view.height}, {0.0f, 0.0f}, WHITE);
+    }
+
+    /// @brief everything the drawn tiles and grid depend on
+    MapViewKey MapView() const
+    {
+        MapViewKey view;
+        view.cameraX = static_cast<int>(std::floor(m_camera.x));
+        view.cameraY = static_cast<int>(std::floor(m_camera.y));
+        view.width = m_screenWidth - m_sidePanelWidth;
+        view.height = m_screenHeight;
+        view.grid = m_drawGrid;
+        for (size_t i = 0; i < m_tilemap.layers.size(); ++i)
+        {
+            view.revisions += m_tilemap.layers[i].revision;
+            view.visibleLayers |= static_cast<uint32_t>(m_tilemap.layers[i].visible) << i;
+        }
+        return view;
+    }
+
+    /// @brief true while something changes on screen without input: particles, falling sand, chunks loading, held keys or buttons
+    bool IsAnimating() const
+    {
+        if (m_particles.LiveParticles() > 0 || m_stroke.active || m_sand.AwakeChunks() > 0)
+            return true;
+        for (const TileStreamer &streamer : m_streamers)
+        {
+            if (streamer.PendingLoads() > 0)
+                return true;
+        }
+        const InputFrame &input = Input::GetFrame();
+        return input.keyCount > 0 || input.mouseButtons != 0;
     }
 
     void Cleanup() override
@@ -218,34 +421,50 @@ public:
         {
             m_sidePanel->Cleanup();
         }
-        std::cout << "Cleaning up sandbox." << std::endl;
+        Tilemap::ReleaseCache(m_tilemap);
+        if (m_mapCache.id != 0)
+            UnloadRenderTexture(m_mapCache);
+        m_mapCache = {};
+        DisableEventWaiting();
+        m_particles.UnloadTextures();
+        for (TileStreamer &streamer : m_streamers)
+            streamer.Close(); // saves every changed chunk, quitting never drops edits
+        Log::Info("Cleaning up sandbox.");
     }
 
-    void Run() override
+    uint64_t StateHash() const override
     {
-        Init(); // Initialize the simulation
-        while (!WindowShouldClose())
-        {
-            HandleInput();          // Handle user input
-            Update(GetFrameTime()); // Update the simulation state
-            Render();               // Render the simulation
-        }
-        Cleanup(); // Cleanup resources
+        return Tilemap::Hash(m_tilemap);
     }
 
     void DrawGrid(int screenWidth, int screenHeight, int cellCount)
     {
-        // Draw a grid for debugging purposes
-        for (int i = 0; i < screenWidth; i += cellCount)
+        // Draw a grid for debugging purposes, aligned to the tiles under the camera
+        int offsetX = -(((int)m_camera.x % cellCount) + cellCount) % cellCount;
+        int offsetY = -(((int)m_camera.y % cellCount) + cellCount) % cellCount;
+        for (int i = offsetX; i < screenWidth; i += cellCount)
         {
             DrawLine(i, 0, i, screenHeight, LIGHTGRAY);
         }
-        for (int j = 0; j < screenHeight; j += cellCount)
+        for (int j = offsetY; j < screenHeight; j += cellCount)
         {
             DrawLine(0, j, screenWidth, j, LIGHTGRAY);
         }
     }
 
+    /// @brief tile under a screen position, taking the camera into account
+    void ScreenToTile(Vector2 screen, int &tileX, int &tileY) const
+    {
+        tileX = static_cast<int>(std::floor((screen.x + m_camera.x) / m_tilemap.tileSize));
+        tileY = static_cast<int>(std::floor((screen.y + m_camera.y) / m_tilemap.tileSize));
+    }
+
+    /// @brief tiles shown in the drawing area
+    TileRect VisibleTiles() const
+    {
+        return Tilemap::VisibleTiles(m_tilemap, m_camera, m_screenWidth - m_sidePanelWidth, m_screenHeight);
+    }
+
     void RenderSidePanelWithOffset(Vector2 offset)
     {
         if (!m_sidePanel)
@@ -271,14 +490,14 @@ public:
         DrawRectangle(handleX, sliderRect.y + 2, 10, 16, BLUE);
 
         // Draw brush size label
-        DrawText(TextFormat("Brush Size: %d", m_brushSize), offset.x + 10, offset.y + yOffset - 25, 18, BLACK);
+        DrawText(FrameArena::Frame().Format("Brush Size: {}", m_brushSize), offset.x + 10, offset.y + yOffset - 25, 18, BLACK);
         yOffset += 50;
 
         // Draw clear button
         Rectangle clearButton = {offset.x + 10, offset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
         DrawRectangleRec(clearButton, RED);
         DrawRectangleLinesEx(clearButton, 2, BLACK);
-        DrawText("Clear All", clearButton.x + 15, clearButton.y + 5, 20, BLACK);
+        DrawText(m_streamers[0].IsOpen() ? "Clear (no undo)" : "Clear All", clearButton.x + 15, clearButton.y + 5, 20, BLACK);
         yOffset += 40;
 
         // Draw save button
@@ -299,6 +518,43 @@ public:
         DrawText("Show Grid", offset.x + 40, offset.y + yOffset + 2, 18, BLACK);
         yOffset += 35;
 
+        // Draw brush type button
+        Rectangle brushButton = {offset.x + 10, offset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
+        DrawRectangleRec(brushButton, SKYBLUE);
+        DrawRectangleLinesEx(brushButton, 2, BLACK);
+        DrawText(FrameArena::Frame().Format("Brush: {}", BrushTypeName(m_brushType)), brushButton.x + 15, brushButton.y + 5, 20, BLACK);
+        yOffset += 40;
+
+        // Draw layer button and the active layer's visibility checkbox
+        const TileLayer &layer = Tilemap::Active(m_tilemap);
+        Rectangle layerButton = {offset.x + 10, offset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
+        DrawRectangleRec(layerButton, BEIGE);
+        DrawRectangleLinesEx(layerButton, 2, BLACK);
+        DrawText(FrameArena::Frame().Format("Layer: {}", layer.name), layerButton.x + 15, layerButton.y + 5, 20, BLACK);
+        yOffset += 40;
+
+        Rectangle visibleRect = {offset.x + 10, offset.y + (float)yOffset, 20, 20};
+        DrawRectangleRec(visibleRect, WHITE);
+        DrawRectangleLinesEx(visibleRect, 2, BLACK);
+        if (layer.visible)
+        {
+            DrawRectangle(visibleRect.x + 4, visibleRect.y + 4, 12, 12, GREEN);
+        }
+        DrawText("Layer Visible", offset.x + 40, offset.y + yOffset + 2, 18, BLACK);
+        yOffset += 35;
+
+        // Draw generator selection and generate buttons
+        float half = (float)(m_sidePanelWidth - 30) / 2;
+        Rectangle generatorButton = {offset.x + 10, offset.y + (float)yOffset, half, 30};
+        DrawRectangleRec(generatorButton, LIGHTGRAY);
+        DrawRectangleLinesEx(generatorButton, 2, BLACK);
+        DrawText(GeneratorTypeName(m_generator), generatorButton.x + 8, generatorButton.y + 7, 16, BLACK);
+        Rectangle generateButton = {offset.x + 20 + half, offset.y + (float)yOffset, half, 30};
+        DrawRectangleRec(generateButton, ORANGE);
+        DrawRectangleLinesEx(generateButton, 2, BLACK);
+        DrawText("Generate", generateButton.x + 8, generateButton.y + 7, 16, BLACK);
+        yOffset += 40;
+
         // Draw image browser placeholder
         Rectangle imageBrowser = {offset.x + 10, offset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 150};
         DrawRectangleRec(imageBrowser, LIGHTGRAY);
@@ -315,40 +571,79 @@ public:
 
         // Handle brush size slider
         Rectangle sliderRect = {panelOffset.x + 10, panelOffset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 20};
-        if (CheckCollisionPointRec(mousePos, sliderRect) && IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+        if (CheckCollisionPointRec(mousePos, sliderRect) && Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT))
         {
             float relativeX = mousePos.x - sliderRect.x;
             float sliderValue = relativeX / sliderRect.width;
             sliderValue = Clamp(sliderValue, 0.0f, 1.0f);
-            m_brushSize = 1 + (int)(sliderValue * 9); // Map to 1-10 range
-            std::cout << "Brush size changed to: " << m_brushSize << std::endl;
+            int brushSize = 1 + (int)(sliderValue * 9); // Map to 1-10 range
+            if (brushSize != m_brushSize)
+                m_events.Enqueue(events::BrushSizeChanged{brushSize});
         }
         yOffset += 50;
 
         // Handle clear button
         Rectangle clearButton = {panelOffset.x + 10, panelOffset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
-        if (CheckCollisionPointRec(mousePos, clearButton) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        if (CheckCollisionPointRec(mousePos, clearButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
-            ClearTilemap();
+            m_events.Enqueue(events::ClearTilemap{});
         }
         yOffset += 40;
 
         // Handle save button
         Rectangle saveButton = {panelOffset.x + 10, panelOffset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
-        if (CheckCollisionPointRec(mousePos, saveButton) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        if (CheckCollisionPointRec(mousePos, saveButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
-            SaveTilemap();
+            m_events.Enqueue(events::SaveTilemap{});
         }
         yOffset += 40;
 
         // Handle grid checkbox
         Rectangle checkboxRect = {panelOffset.x + 10, panelOffset.y + (float)yOffset, 20, 20};
-        if (CheckCollisionPointRec(mousePos, checkboxRect) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        if (CheckCollisionPointRec(mousePos, checkboxRect) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
         {
-            m_drawGrid = !m_drawGrid;
+            m_events.Enqueue(events::GridToggled{!m_drawGrid});
         }
         yOffset += 35;
 
+        // Handle brush type button
+        Rectangle brushButton = {panelOffset.x + 10, panelOffset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
+        if (CheckCollisionPointRec(mousePos, brushButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            m_events.Enqueue(events::BrushTypeChanged{NextBrushType(m_brushType)});
+        }
+        yOffset += 40;
+
+        // Handle layer button
+        Rectangle layerButton = {panelOffset.x + 10, panelOffset.y + (float)yOffset, (float)(m_sidePanelWidth - 20), 30};
+        if (CheckCollisionPointRec(mousePos, layerButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            m_events.Enqueue(events::LayerCycled{});
+        }
+        yOffset += 40;
+
+        // Handle layer visibility checkbox
+        Rectangle visibleRect = {panelOffset.x + 10, panelOffset.y + (float)yOffset, 20, 20};
+        if (CheckCollisionPointRec(mousePos, visibleRect) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            m_events.Enqueue(events::LayerVisibilityToggled{!Tilemap::Active(m_tilemap).visible});
+        }
+        yOffset += 35;
+
+        // Handle generator buttons
+        float half = (float)(m_sidePanelWidth - 30) / 2;
+        Rectangle generatorButton = {panelOffset.x + 10, panelOffset.y + (float)yOffset, half, 30};
+        Rectangle generateButton = {panelOffset.x + 20 + half, panelOffset.y + (float)yOffset, half, 30};
+        if (CheckCollisionPointRec(mousePos, generatorButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            m_events.Enqueue(events::GeneratorChanged{NextGeneratorType(m_generator)});
+        }
+        if (CheckCollisionPointRec(mousePos, generateButton) && Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        {
+            m_events.Enqueue(events::GenerateTilemap{});
+        }
+        yOffset += 40;
+
         // Image browser interactions could be added here
     }
 
@@ -357,10 +652,58 @@ private:
     int m_gridSize = 32;                               // Size of each grid cell
     int tileSize = gcd(m_screenWidth, m_screenHeight); // Calculate tile size based on screen dimensions
     Tilemap m_tilemap;                                 // Tilemap for the sandbox
+    Vector2 m_camera = {0.0f, 0.0f};                   // world pixel shown at the top-left of the drawing area
     int m_brushSize = 1;                               // Current brush size
+    int m_paintValue = 1;                              // tile value painted with the left button
+    BrushType m_brushType = BrushType::Square;         // Current brush shape
+
+    // state of the mouse stroke in progress, in tile coordinates
+    struct Stroke
+    {
+        bool active = false;
+        int value = 0;              // tile value being painted, 0 erases
+        int startX = 0, startY = 0; // where the button went down
+        int lastX = 0, lastY = 0;   // cursor tile on the previous frame
+    };
+    Stroke m_stroke;
+    TileHistory m_history; // undo/redo of strokes
+
+    // layers of the edited map, drawn in this order; each streams from its own file
+    static constexpr std::array<const char *, 3> LAYER_NAMES = {"background", "collision", "decoration"};
+    std::array<TileStreamer, LAYER_NAMES.size()> m_streamers; // page chunks in and out around the camera
+
+    static constexpr int GENERATE_CHUNKS = 16;          // side of the generated area, in chunks
+    GeneratorType m_generator = GeneratorType::Terrain; // generator used by GenerateTilemap
+    uint64_t m_seed = 1;                                // seed of the next generated map
+
+    static constexpr int PATH_LAYER = 1;   // paths avoid the filled tiles of the collision layer
+    static constexpr int PATH_WINDOW = 512; // side of the area searched around the path start, in tiles
+    Pathfinder m_pathfinder;
+    bool m_pathActive = false;
+    GridPoint m_pathStart;
+    const std::vector<GridPoint> *m_path = nullptr; // cached path to the cursor, refreshed every Update
+
+    static constexpr int SAND_LAYER = 1;                 // sand and water move on the collision layer
+    static constexpr int SAND_EXTENT = 1024;             // they stay within SAND_EXTENT tiles of the origin
+    static constexpr float SAND_STEP = 1.0f / 60.0f;     // fixed step, seconds
+    static constexpr int MAX_SAND_STEPS = 2;             // steps per frame at most
+    SandSimulation m_sand{{-SAND_EXTENT, -SAND_EXTENT, SAND_EXTENT, SAND_EXTENT}};
+    float m_sandTime = 0.0f; // time not stepped yet
+
+    ParticleSystem m_particles; // effects, drawn over the tiles in world pixels
+    size_t m_sparks = 0;        // emitter index of the brush sparks
+
+    // idle rendering: frames are only drawn after something changed, the loop sleeps on window events in between
+    bool m_idleRendering = false;     // I toggles, on by default in live sessions
+    bool m_redraw = true;             // something on screen changed since the last drawn frame
+    RenderTexture2D m_mapCache = {};  // tiles and grid as of m_mapCacheView
+    MapViewKey m_mapCacheView;
+
+    static std::string LayerPath(size_t layer) { return std::format("tilemap.{}.region", LAYER_NAMES[layer]); }
 
     // GUI components
     static constexpr int m_sidePanelWidth = 200; // Width of the side panel
+    EditorEventBus m_events;                     // GUI -> sandbox events, dispatched at the start of Update
     std::unique_ptr<SidePanelGUI> m_sidePanel;   // Side panel GUI
 
     float accumulated_time = 0.0f;                   // Accumulator for delta time
@@ -370,55 +713,183 @@ private:
     void CreateSystem(Args &&...args)
     {
         // Create a system and add it to the list of systems
-        m_systems.emplace_back(std::make_unique<T>(std::forward<Args>(args)...));
+        auto &system = m_systems.emplace_back(std::make_unique<T>(std::forward<Args>(args)...));
+        system->OnAttach(m_registry);
     }
 
+    // Event handlers, called from m_events.Dispatch()
+    void OnClearTilemap(const events::ClearTilemap &) { ClearTilemap(); }
+    void OnSaveTilemap(const events::SaveTilemap &) { SaveTilemap(); }
+    void OnGridToggled(const events::GridToggled &event) { m_drawGrid = event.enabled; }
+    void OnBrushSizeChanged(const events::BrushSizeChanged &event)
+    {
+        m_brushSize = event.size;
+        Log::Debug("Brush size changed to: {}", m_brushSize);
+    }
+    void OnBrushTypeChanged(const events::BrushTypeChanged &event)
+    {
+        m_brushType = event.type;
+        EndStroke();
+    }
+    void OnLayerCycled(const events::LayerCycled &)
+    {
+        EndStroke(); // a stroke stays on one layer
+        m_tilemap.activeLayer = (m_tilemap.activeLayer + 1) % static_cast<int>(m_tilemap.layers.size());
+        Log::Info("Editing layer: {}", Tilemap::Active(m_tilemap).name);
+    }
+    void OnLayerVisibilityToggled(const events::LayerVisibilityToggled &event) { Tilemap::Active(m_tilemap).visible = event.visible; }
+    void OnGeneratorChanged(const events::GeneratorChanged &event) { m_generator = event.type; }
+    void OnGenerateTilemap(const events::GenerateTilemap &) { GenerateTilemap(); }
+
     // Helper functions for GUI callbacks
     void ClearTilemap()
     {
-        for (auto &tile : m_tilemap.tiles)
+        if (m_streamers[0].IsOpen())
         {
-            tile.value = 0;
+            // the region files drop their chunks without loading them, so no stroke could bring them back, and
+            // replaying older strokes over the cleared map would only restore pieces of it
+            EndStroke();
+            Tilemap::Clear(m_tilemap);
+            m_history.Clear();
+            Log::Info("Tilemap cleared, this can't be undone while streaming.");
+            return;
         }
-        std::cout << "Tilemap cleared!" << std::endl;
+        m_history.BeginStroke(m_tilemap);
+        Tilemap::Clear(m_tilemap);
+        m_history.EndStroke(m_tilemap);
+        Log::Info("Tilemap cleared!");
     }
 
     void SaveTilemap()
     {
-        std::string serialized = Tilemap::Serialize(m_tilemap);
-        std::cout << "Saving tilemap:\n"
-                  << serialized << std::endl;
-
-        // Here you could write to a file
-        // std::ofstream file("tilemap.txt");
-        // file << serialized;
-        // file.close();
+        if (!m_streamers[0].IsOpen())
+        {
+            FrameString text = MakeFrameString();
+            Tilemap::Serialize(m_tilemap, text);
+            std::cout << "Saving tilemap:\n"
+                      << text << std::endl;
+            return;
+        }
+        // only changed chunks are written, on the loader threads; untouched layers write nothing
+        for (size_t i = 0; i < LAYER_NAMES.size(); ++i)
+        {
+            size_t written = m_streamers[i].Save(m_tilemap.layers[i]);
+            if (written > 0)
+                Log::Info("Saving {} changed chunks to {}", written, LayerPath(i));
+        }
+    }
+
+    /// @brief replace GENERATE_CHUNKS x GENERATE_CHUNKS chunks around the view on the active layer, as one undo step
+    void GenerateTilemap()
+    {
+        EndStroke();
+        const TileRect view = VisibleTiles();
+        const int cx = TileChunk::ChunkCoord((view.x0 + view.x1) / 2) - GENERATE_CHUNKS / 2;
+        const int cy = TileChunk::ChunkCoord((view.y0 + view.y1) / 2) - GENERATE_CHUNKS / 2;
+        const TileRect area = {cx << TileChunk::SHIFT, cy << TileChunk::SHIFT,
+                               (cx + GENERATE_CHUNKS) << TileChunk::SHIFT, (cy + GENERATE_CHUNKS) << TileChunk::SHIFT};
+
+        m_history.BeginStroke(m_tilemap);
+        size_t tiles = TileGenerator::Generate(m_tilemap, m_tilemap.activeLayer, m_generator, m_seed, area, m_jobs);
+        m_history.EndStroke(m_tilemap);
+        Log::Info("Generated {} tiles of {} with seed {}", tiles, GeneratorTypeName(m_generator), m_seed);
+        ++m_seed; // the next press gives a different map, a replayed session the same sequence
     }
 
-    void DrawBrushTiles(Vector2 mousePos, int tileValue, int drawingAreaWidth)
+    void SetPathStart(GridPoint start)
     {
-        int centerTileX = static_cast<int>(mousePos.x / m_tilemap.tileSize);
-        int centerTileY = static_cast<int>(mousePos.y / m_tilemap.tileSize);
-        int tilesPerRow = drawingAreaWidth / m_tilemap.tileSize;
-        int brushRadius = (m_brushSize - 1) / 2;
+        m_pathStart = start;
+        m_pathActive = true;
+        TileLayer &layer = m_tilemap.layers[PATH_LAYER];
+        m_pathfinder.Reset(layer, {start.x - PATH_WINDOW / 2, start.y - PATH_WINDOW / 2, start.x + PATH_WINDOW / 2, start.y + PATH_WINDOW / 2});
+        Tilemap::ClearDirty(layer); // Reset() copied the current tiles
+        Log::Info("Path start: {}, {}", start.x, start.y);
+    }
 
-        // Draw tiles in a square brush pattern
-        for (int dy = -brushRadius; dy <= brushRadius; dy++)
+    /// @brief pass the collision layer's edits to the pathfinder and look up the path to the cursor
+    void UpdatePath()
+    {
+        m_path = nullptr;
+        if (!m_pathActive)
+            return;
+        TileLayer &layer = m_tilemap.layers[PATH_LAYER];
+        if (!layer.dirty.Empty())
         {
-            for (int dx = -brushRadius; dx <= brushRadius; dx++)
+            m_pathfinder.OnTilesChanged(layer, layer.dirty);
+            Tilemap::ClearDirty(layer);
+        }
+        int tileX, tileY;
+        ScreenToTile(Input::GetMousePosition(), tileX, tileY);
+        m_path = m_pathfinder.FindPath(m_pathStart, {tileX, tileY});
+    }
+
+    void DrawPath()
+    {
+        if (!m_path)
+            return;
+        const int ts = m_tilemap.tileSize;
+        const int ox = static_cast<int>(m_camera.x) - ts / 2, oy = static_cast<int>(m_camera.y) - ts / 2;
+        for (size_t i = 1; i < m_path->size(); ++i)
+        {
+            const GridPoint &a = (*m_path)[i - 1], &b = (*m_path)[i];
+            DrawLine(a.x * ts - ox, a.y * ts - oy, b.x * ts - ox, b.y * ts - oy, MAGENTA);
+        }
+    }
+
+    /// @brief paint with the current brush. Left button paints, right button erases.
+    void HandleBrushInput(Vector2 mousePos)
+    {
+        int tileX, tileY;
+        ScreenToTile(mousePos, tileX, tileY);
+
+        bool left = Input::IsMouseButtonDown(MOUSE_BUTTON_LEFT);
+        bool right = Input::IsMouseButtonDown(MOUSE_BUTTON_RIGHT);
+        if (!m_stroke.active && (left || right))
+        {
+            m_stroke = {true, left ? m_paintValue : 0, tileX, tileY, tileX, tileY};
+            m_history.BeginStroke(m_tilemap);
+            if (m_brushType == BrushType::Fill)
+                TileBrush::FloodFill(m_tilemap, tileX, tileY, m_stroke.value, VisibleTiles());
+        }
+        if (!m_stroke.active)
+            return;
+
+        switch (m_brushType)
+        {
+        case BrushType::Square:
+        case BrushType::Circle:
+            // connect to last frame's position so fast strokes leave no gaps
+            if (left || right)
+                TileBrush::DrawLine(m_tilemap, m_stroke.lastX, m_stroke.lastY, tileX, tileY, m_brushType, m_brushSize, m_stroke.value);
+            break;
+        case BrushType::Line:
+        case BrushType::Rectangle:
+            if (!left && !right) // shape is committed on release
             {
-                int tileX = centerTileX + dx;
-                int tileY = centerTileY + dy;
-                int index = tileY * tilesPerRow + tileX;
-
-                // Check bounds to ensure we don't go out of screen or tilemap bounds
-                if (tileX >= 0 && tileX < tilesPerRow &&
-                    tileY >= 0 && tileY < (m_screenHeight / m_tilemap.tileSize) &&
-                    index >= 0 && index < static_cast<int>(m_tilemap.tiles.size()))
-                {
-                    m_tilemap.tiles[index].value = tileValue;
-                }
+                if (m_brushType == BrushType::Line)
+                    TileBrush::DrawLine(m_tilemap, m_stroke.startX, m_stroke.startY, tileX, tileY, BrushType::Circle, m_brushSize, m_stroke.value);
+                else
+                    TileBrush::FillRect(m_tilemap, m_stroke.startX, m_stroke.startY, tileX, tileY, m_stroke.value);
             }
+            break;
+        default:
+            break;
         }
+
+        // sparks fly from the cursor when the button goes down and whenever the brush reaches a new tile
+        bool pressed = Input::IsMouseButtonPressed(MOUSE_BUTTON_LEFT) || Input::IsMouseButtonPressed(MOUSE_BUTTON_RIGHT);
+        if ((left || right) && (pressed || tileX != m_stroke.lastX || tileY != m_stroke.lastY))
+            m_particles.Emitter(m_sparks).Burst(mousePos.x + m_camera.x, mousePos.y + m_camera.y, 12);
+
+        m_stroke.lastX = tileX;
+        m_stroke.lastY = tileY;
+        if (!left && !right)
+            EndStroke();
+    }
+
+    void EndStroke()
+    {
+        m_stroke.active = false;
+        m_history.EndStroke(m_tilemap); // everything written since the button went down is one undo step
     }
 };
@@ -9,12 +9,15 @@
 
 #include <memory>
 #include <vector>
-#include <functional>
 
 #include <raylib.h>
 
 #include "GUI.h"
 #include "GUIComponents.h"
+#include "Events.h"
+#include "Log.h"
+#include "TileBrush.h"
+#include "TileGenerator.h"
 
 namespace GUIConstants
 {
@@ -22,12 +25,63 @@ namespace GUIConstants
     static constexpr int SIDE_PANEL_HEIGHT = 600; // Default height of the side panel
 }
 
+// events emitted by the tile editor GUI, delivered when the owner dispatches the bus
+namespace events
+{
+    struct ClearTilemap
+    {
+    };
+
+    struct SaveTilemap
+    {
+    };
+
+    struct GridToggled
+    {
+        bool enabled = true;
+    };
+
+    struct BrushSizeChanged
+    {
+        int size = 1;
+    };
+
+    struct BrushTypeChanged
+    {
+        BrushType type = BrushType::Square;
+    };
+
+    // make the next tile layer the one being edited
+    struct LayerCycled
+    {
+    };
+
+    struct LayerVisibilityToggled
+    {
+        bool visible = true; // new visibility of the active layer
+    };
+
+    struct GeneratorChanged
+    {
+        GeneratorType type = GeneratorType::Terrain;
+    };
+
+    // replace the area around the view with the selected generator's output
+    struct GenerateTilemap
+    {
+    };
+}
+
+using EditorEventBus = EventBus<events::ClearTilemap, events::SaveTilemap, events::GridToggled, events::BrushSizeChanged,
+                                events::BrushTypeChanged, events::LayerCycled, events::LayerVisibilityToggled,
+                                events::GeneratorChanged, events::GenerateTilemap>;
+
 // a piece of GUI that takes up a portion of the side of the screen.
 class SidePanelGUI : public IGUI
 {
 public:
-    SidePanelGUI(int x, int y, int width = GUIConstants::SIDE_PANEL_WIDTH, int height = GUIConstants::SIDE_PANEL_HEIGHT, Color backgroundColor = LIGHTGRAY)
-        : m_x(x), m_y(y), m_width(width), m_height(height), m_backgroundColor(backgroundColor)
+    SidePanelGUI(EditorEventBus &events, int x, int y, int width = GUIConstants::SIDE_PANEL_WIDTH, int height = GUIConstants::SIDE_PANEL_HEIGHT, Color backgroundColor = LIGHTGRAY)
+        : m_events(events), m_x(x), m_y(y), m_width(width), m_height(height), m_backgroundColor(backgroundColor)
     {
     }
 
@@ -50,13 +104,7 @@ public:
             Rectangle{10, (float)yOffset, (float)(m_width - 20), 20},
             1.0f, 10.0f, 1.0f,
             "Brush Size:");
-        brushSizeSlider->SetOnValueChanged(
-            [this](float value)
-            {
-                m_brushSize = static_cast<int>(value);
-                if (m_onBrushSizeChanged)
-                    m_onBrushSizeChanged(m_brushSize);
-            });
+        brushSizeSlider->SetOnValueChanged<&SidePanelGUI::OnBrushSizeSlider>(*this);
         m_components.push_back(std::move(brushSizeSlider));
         yOffset += 50;
 
@@ -65,9 +113,7 @@ public:
             Rectangle{10, (float)yOffset, (float)(m_width - 20), 30},
             "Clear All",
             RED);
-        clearButton->SetOnClick([this]()
-                                {
-            if (m_onClearCallback) m_onClearCallback(); });
+        clearButton->SetOnClick<&SidePanelGUI::OnClearClicked>(*this);
         m_components.push_back(std::move(clearButton));
         yOffset += 40;
 
@@ -77,9 +123,7 @@ public:
             "Save",
             GREEN);
 
-        saveButton->SetOnClick([this]()
-                               {
-            if (m_onSaveCallback) m_onSaveCallback(); });
+        saveButton->SetOnClick<&SidePanelGUI::OnSaveClicked>(*this);
         m_components.push_back(std::move(saveButton));
         yOffset += 40;
 
@@ -88,12 +132,53 @@ public:
             Rectangle{10, (float)yOffset, (float)(m_width - 20), 25},
             "Show Grid",
             true);
-        gridCheckbox->SetOnChanged([this](bool checked)
-                                   {
-            if (m_onGridToggleCallback) m_onGridToggleCallback(checked); });
+        gridCheckbox->SetOnChanged<&SidePanelGUI::OnGridToggled>(*this);
         m_components.push_back(std::move(gridCheckbox));
         yOffset += 35;
 
+        // Add brush type button, cycles through the brush shapes
+        auto brushButton = std::make_unique<GUIButton>(
+            Rectangle{10, (float)yOffset, (float)(m_width - 20), 30},
+            "Brush Type",
+            SKYBLUE);
+        brushButton->SetOnClick<&SidePanelGUI::OnBrushTypeClicked>(*this);
+        m_components.push_back(std::move(brushButton));
+        yOffset += 40;
+
+        // Add layer button and visibility checkbox for the layer being edited
+        auto layerButton = std::make_unique<GUIButton>(
+            Rectangle{10, (float)yOffset, (float)(m_width - 20), 30},
+            "Next Layer",
+            BEIGE);
+        layerButton->SetOnClick<&SidePanelGUI::OnLayerClicked>(*this);
+        m_components.push_back(std::move(layerButton));
+        yOffset += 40;
+
+        auto layerCheckbox = std::make_unique<GUICheckbox>(
+            Rectangle{10, (float)yOffset, (float)(m_width - 20), 25},
+            "Layer Visible",
+            true);
+        layerCheckbox->SetOnChanged<&SidePanelGUI::OnLayerVisibilityToggled>(*this);
+        m_components.push_back(std::move(layerCheckbox));
+        yOffset += 35;
+
+        // Add generator selection and generate buttons, side by side
+        float half = (float)(m_width - 30) / 2;
+        auto generatorButton = std::make_unique<GUIButton>(
+            Rectangle{10, (float)yOffset, half, 30},
+            "Generator",
+            LIGHTGRAY);
+        generatorButton->SetOnClick<&SidePanelGUI::OnGeneratorClicked>(*this);
+        m_components.push_back(std::move(generatorButton));
+
+        auto generateButton = std::make_unique<GUIButton>(
+            Rectangle{20 + half, (float)yOffset, half, 30},
+            "Generate",
+            ORANGE);
+        generateButton->SetOnClick<&SidePanelGUI::OnGenerateClicked>(*this);
+        m_components.push_back(std::move(generateButton));
+        yOffset += 40;
+
         // Add image browser for tile textures
         auto imageBrowser = std::make_unique<GUIImageBrowser>(
             Rectangle{10, (float)yOffset, (float)(m_width - 20), 150});
@@ -159,33 +244,41 @@ public:
         }
         catch (const std::exception &e)
         {
-            std::cerr << "Error removing GUI component: " << e.what() << std::endl;
+            Log::Error("Error removing GUI component: {}", e.what());
         }
     }
 
-    // Callback setters
-    void SetOnClearCallback(std::function<void()> callback) { m_onClearCallback = callback; }
-    void SetOnSaveCallback(std::function<void()> callback) { m_onSaveCallback = callback; }
-    void SetOnGridToggleCallback(std::function<void(bool)> callback) { m_onGridToggleCallback = callback; }
-    void SetOnBrushSizeChanged(std::function<void(int)> callback) { m_onBrushSizeChanged = callback; }
-
 private:
+    // component handlers, they only queue events for the owner to dispatch
+    void OnBrushSizeSlider(float value)
+    {
+        m_brushSize = static_cast<int>(value);
+        m_events.Enqueue(events::BrushSizeChanged{m_brushSize});
+    }
+    void OnClearClicked() { m_events.Enqueue(events::ClearTilemap{}); }
+    void OnSaveClicked() { m_events.Enqueue(events::SaveTilemap{}); }
+    void OnGridToggled(bool checked) { m_events.Enqueue(events::GridToggled{checked}); }
+    void OnBrushTypeClicked()
+    {
+        m_brushType = NextBrushType(m_brushType);
+        m_events.Enqueue(events::BrushTypeChanged{m_brushType});
+    }
+    void OnLayerClicked() { m_events.Enqueue(events::LayerCycled{}); }
+    void OnLayerVisibilityToggled(bool checked) { m_events.Enqueue(events::LayerVisibilityToggled{checked}); }
+    void OnGeneratorClicked()
+    {
+        m_generator = NextGeneratorType(m_generator);
+        m_events.Enqueue(events::GeneratorChanged{m_generator});
+    }
+    void OnGenerateClicked() { m_events.Enqueue(events::GenerateTilemap{}); }
+
     using Components = std::vector<std::unique_ptr<IGUIComponent>>;
+    EditorEventBus &m_events;        // where component interactions are posted
     int m_x, m_y, m_width, m_height; // Position and size of the side panel
     Color m_backgroundColor;         // Background color of the side panel
     Components m_components;         // Components in the side panel
     int m_brushSize = 1;             // Current brush size
-    enum class BrushType
-    {
-        Circle,
-        Square
-    }; // Type of brush to use
-    BrushType m_brushType = BrushType::Circle; // Default brush type
-    bool folded = false;                       // Whether the side panel is folded or not
-
-    // Callbacks
-    std::function<void()> m_onClearCallback;
-    std::function<void()> m_onSaveCallback;
-    std::function<void(bool)> m_onGridToggleCallback;
-    std::function<void(int)> m_onBrushSizeChanged;
+    BrushType m_brushType = BrushType::Square;          // Current brush type
+    GeneratorType m_generator = GeneratorType::Terrain; // Generator used by the Generate button
+    bool folded = false;                                // Whether the side panel is folded or not
 };
@@ -6,19 +6,30 @@ extern "C"
 }
 #include <entt/entt.hpp>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include "Input.h"
+#include "FrameArena.h"
+#include "AllocTracker.h"
+#include "Log.h"
+#include "JobSystem.h"
+
 class ISimulation
 {
 public:
     ISimulation(int screenWidth = 800, int screenHeight = 600, const char *title = "Simulation",
                 unsigned int flags = FLAG_WINDOW_RESIZABLE, int targetFPS = 60)
-        : m_screenWidth(screenWidth), m_screenHeight(screenHeight)
+        : m_screenWidth(screenWidth), m_screenHeight(screenHeight), m_targetFPS(targetFPS)
     {
         SetConfigFlags(flags);                            // Set window configuration flags
         InitWindow(m_screenWidth, m_screenHeight, title); // Initialize the window with the
         SetTargetFPS(targetFPS);                          // Set the target frames per second
         if (!IsWindowReady())
         {
-            fprintf(stderr, "Failed to create window: %s\n", title);
+            Log::Error("Failed to create window: {}", title);
             exit(EXIT_FAILURE); // Exit if window creation fails
         }
     }
@@ -32,21 +43,141 @@ public:
     virtual void Update(float deltaTime) = 0;
     virtual void Render() = 0;
     virtual void Cleanup() = 0;
+
+    /// @brief hash of the state a replayed session must reproduce, 0 if the simulation doesn't support it
+    virtual uint64_t StateHash() const { return 0; }
+
     virtual void Run()
     {
-
         Init();
+        double start = GetTime();
         while (!WindowShouldClose())
         {
+            Input::BeginFrame(); // sample (or replay) this frame's input
+            if (Input::IsPlaybackFinished())
+                break;
+
             HandleInput();
-            Update(GetFrameTime());
+            Update(Input::GetFrameTime());
             Render();
+            FrameArena::Frame().Reset(); // frame temporaries are gone from here on
+            AllocTracker::EndFrame();
+        }
+        double elapsed = GetTime() - start;
+        Log::Flush(); // the results below come after everything logged during the run
+        if (Input::GetMode() == Input::Mode::Playback)
+        {
+            uint32_t frames = Input::GetFrameIndex();
+            printf("Replay took %.3f s, %.3f ms/frame\n", elapsed, frames ? elapsed * 1000.0 / frames : 0.0);
+            AllocTracker::PrintSummary(std::cout);
+        }
+        m_replayMatched = Input::Finish(StateHash()); // before Cleanup, which may tear down the state
+        Cleanup();
+    }
+
+    /// @brief true if the simulation implements PublishSnapshot() and RenderSnapshot() for RunThreaded()
+    virtual bool SupportsThreadedRun() const { return false; }
+
+    /// @brief simulation thread, after Update: copy everything RenderSnapshot() draws into the next snapshot
+    virtual void PublishSnapshot() {}
+
+    /// @brief window thread: draw the latest published snapshot, without touching the simulation state
+    virtual void RenderSnapshot() {}
+
+    /// @brief Run() with the simulation on its own thread. It steps HandleInput and Update at a fixed rate
+    /// (the target FPS) and publishes a snapshot after each step; the calling thread owns the window, samples
+    /// input for the simulation and only draws the newest snapshot, so a slow frame on one side doesn't hold
+    /// up the other. Live and recording sessions only, recordings replay with Run().
+    void RunThreaded()
+    {
+        Init();
+        const double step = 1.0 / (m_targetFPS > 0 ? m_targetFPS : 60);
+        InputMailbox mailbox;
+        std::atomic<bool> stop{false};
+
+        std::thread simulation([&]
+                               {
+            auto next = std::chrono::steady_clock::now();
+            const auto stepDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(step));
+            while (!stop.load(std::memory_order_acquire))
+            {
+                InputFrame frame = mailbox.Take();
+                frame.deltaTime = static_cast<float>(step); // fixed steps, however fast the window draws
+                Input::BeginFrame(frame);
+                HandleInput();
+                Update(frame.deltaTime);
+                PublishSnapshot();
+                FrameArena::Frame().Reset(); // this thread's arena
+
+                next += stepDuration;
+                const auto now = std::chrono::steady_clock::now();
+                if (now - next > 5 * stepDuration)
+                    next = now; // far behind (a breakpoint, a stalled machine): drop the backlog instead of racing it
+                std::this_thread::sleep_until(next);
+            } });
+
+        InputFrame sampled;
+        while (!WindowShouldClose())
+        {
+            Input::Sample(sampled);
+            mailbox.Post(sampled);
+            RenderSnapshot();
+            FrameArena::Frame().Reset();
+            AllocTracker::EndFrame();
         }
+        stop.store(true, std::memory_order_release);
+        simulation.join();
+
+        Log::Flush();
+        m_replayMatched = Input::Finish(StateHash());
         Cleanup();
     }
 
+    /// @brief false if the last Run() replayed a recording and ended in a different state
+    bool ReplayMatched() const { return m_replayMatched; }
+
 protected:
+    bool m_replayMatched = true;
     entt::registry m_registry; // Entity registry for the simulation
     int m_screenWidth = 800;   // Default screen width
     int m_screenHeight = 600;  // Default screen height
+    int m_targetFPS = 60;      // also the step rate of RunThreaded(), 0 is uncapped
+    JobSystem m_jobs;          // worker threads shared by the simulation's systems, tilemap and asset work
+
+private:
+    // input sampled by the window thread, waiting for the next simulation step of RunThreaded()
+    class InputMailbox
+    {
+    public:
+        void Post(const InputFrame &frame)
+        {
+            std::lock_guard lock(m_mutex);
+            if (m_pending)
+                m_frame.Merge(frame); // the simulation hasn't stepped since the last sample
+            else
+                m_frame = frame;
+            m_pending = true;
+            m_latest = frame;
+        }
+
+        /// @return the samples since the last call merged, or the last sample again if there are none
+        InputFrame Take()
+        {
+            std::lock_guard lock(m_mutex);
+            if (!m_pending)
+            {
+                InputFrame frame = m_latest;
+                frame.mouseWheel = 0.0f; // already consumed
+                return frame;
+            }
+            m_pending = false;
+            return m_frame;
+        }
+
+    private:
+        std::mutex m_mutex;
+        InputFrame m_frame;  // merged samples not taken yet
+        InputFrame m_latest; // the last sample
+        bool m_pending = false;
+    };
 };
@@ -0,0 +1,187 @@
+/**
+ * @file SystemPipeline.h
+ * @brief Fixed list of systems known at compile time, held by value and updated without virtual calls.
+ * @date 2025-08-01
+ * @details SystemPipeline<PhysicsSystem, CollisionSystem, TextInterface> stores the systems in a tuple and updates
+ * them in order with a fold expression. Each call names the concrete type (system.T::OnUpdate), so it is a direct
+ * call the compiler can inline, unlike the std::vector<std::unique_ptr<ISystem>> path that stays for systems
+ * added at runtime, e.g. from an editor.
+ *
+ * Every system declares the components it touches as Reads and Writes ComponentLists. A Parallel<A, B> stage
+ * runs its systems concurrently when the pipeline was attached with a JobSystem, and it is a compile error for a
+ * system in it to write a component another one in the same stage reads or writes. Sequential stages may share
+ * components; their order is the pipeline order.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+#include <entt/entt.hpp>
+
+#include "Systems.h"
+#include "JobSystem.h"
+#include "AllocTracker.h"
+
+/// @brief pipeline stage whose systems may run at the same time, they must not touch each other's written components
+template <typename... Systems>
+struct Parallel
+{
+};
+
+namespace pipeline
+{
+    template <typename T, typename List>
+    struct Contains;
+    template <typename T, typename... Ts>
+    struct Contains<T, ComponentList<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)>
+    {
+    };
+
+    template <typename A, typename B>
+    struct Overlaps;
+    template <typename... As, typename B>
+    struct Overlaps<ComponentList<As...>, B> : std::bool_constant<(Contains<As, B>::value || ...)>
+    {
+    };
+
+    template <typename T>
+    concept DeclaresAccess = std::is_base_of_v<ISystem, T> && requires {
+        typename T::Reads;
+        typename T::Writes;
+    };
+
+    /// @brief true if A and B can't run at the same time: one writes what the other reads or writes
+    template <typename A, typename B>
+    constexpr bool Conflict = Overlaps<typename A::Writes, typename B::Writes>::value ||
+                              Overlaps<typename A::Writes, typename B::Reads>::value ||
+                              Overlaps<typename A::Reads, typename B::Writes>::value;
+
+    template <typename... Systems>
+    struct ConflictFree : std::true_type
+    {
+    };
+    template <typename First, typename... Rest>
+    struct ConflictFree<First, Rest...> : std::bool_constant<!(Conflict<First, Rest> || ...) && ConflictFree<Rest...>::value>
+    {
+    };
+
+    // systems of one stage, as a tuple
+    template <typename Stage>
+    struct StageSystems
+    {
+        using type = std::tuple<Stage>;
+    };
+    template <typename... Systems>
+    struct StageSystems<Parallel<Systems...>>
+    {
+        using type = std::tuple<Systems...>;
+    };
+
+    template <typename... Stages>
+    using SystemTuple = decltype(std::tuple_cat(std::declval<typename StageSystems<Stages>::type>()...));
+
+    template <typename T, typename Tuple>
+    struct Count;
+    template <typename T, typename... Ts>
+    struct Count<T, std::tuple<Ts...>> : std::integral_constant<size_t, (size_t{std::is_same_v<T, Ts>} + ... + 0)>
+    {
+    };
+
+    template <typename Tuple>
+    struct Unique;
+    template <typename... Ts>
+    struct Unique<std::tuple<Ts...>> : std::bool_constant<((Count<Ts, std::tuple<Ts...>>::value == 1) && ...)>
+    {
+    };
+
+    template <typename Stage>
+    struct StageChecks
+    {
+        static_assert(DeclaresAccess<Stage>, "pipeline systems derive from ISystem and declare Reads and Writes");
+    };
+    template <typename... Systems>
+    struct StageChecks<Parallel<Systems...>>
+    {
+        static_assert((DeclaresAccess<Systems> && ...), "pipeline systems derive from ISystem and declare Reads and Writes");
+        static_assert(ConflictFree<Systems...>::value, "systems in a Parallel stage write components another one of them uses");
+    };
+}
+
+template <typename... Stages>
+class SystemPipeline
+{
+    using Systems = pipeline::SystemTuple<Stages...>;
+    static_assert(pipeline::Unique<Systems>::value, "a system type appears twice in the pipeline");
+    static_assert((sizeof(pipeline::StageChecks<Stages>) && ...)); // instantiates the per-stage checks
+
+public:
+    SystemPipeline() = default;
+    SystemPipeline(const SystemPipeline &) = delete; // systems may have connected registry signals to themselves
+    SystemPipeline &operator=(const SystemPipeline &) = delete;
+
+    /// @brief OnAttach every system, in pipeline order; with jobs, Parallel stages and the systems themselves use it
+    void Attach(entt::registry &registry, JobSystem *jobs = nullptr)
+    {
+        m_jobs = jobs;
+        std::apply([&](auto &...system)
+                   { ((system.UseJobs(jobs), system.OnAttach(registry)), ...); }, m_systems);
+    }
+
+    /// @brief update every stage in order
+    /// @return true if any system reported an update
+    bool Update(entt::registry &registry, float deltaTime)
+    {
+        bool updated = false;
+        ((updated |= UpdateStage(static_cast<Stages *>(nullptr), registry, deltaTime)), ...); // comma fold: in order
+        return updated;
+    }
+
+    template <typename T>
+    T &Get() { return std::get<T>(m_systems); }
+    template <typename T>
+    const T &Get() const { return std::get<T>(m_systems); }
+
+    static constexpr size_t Size() { return std::tuple_size_v<Systems>; }
+
+private:
+    template <typename T>
+    bool UpdateSystem(entt::registry &registry, float deltaTime)
+    {
+        T &system = std::get<T>(m_systems);
+        AllocTracker::Scope scope(system.T::Name());
+        return system.T::OnUpdate(registry, deltaTime); // qualified, so not a virtual call
+    }
+
+    template <typename T>
+    bool UpdateStage(T *, entt::registry &registry, float deltaTime)
+    {
+        return UpdateSystem<T>(registry, deltaTime);
+    }
+
+    template <typename... Parallels>
+    bool UpdateStage(Parallel<Parallels...> *, entt::registry &registry, float deltaTime)
+    {
+        if (!m_jobs)
+        {
+            bool any = false;
+            ((any |= UpdateSystem<Parallels>(registry, deltaTime)), ...);
+            return any;
+        }
+
+        bool updated[sizeof...(Parallels)] = {};
+        m_jobs->ParallelFor(sizeof...(Parallels), [&](size_t index)
+                            {
+            size_t i = 0;
+            ((i++ == index ? (void)(updated[index] = UpdateSystem<Parallels>(registry, deltaTime)) : void()), ...); });
+        bool any = false;
+        for (bool systemUpdated : updated)
+            any |= systemUpdated;
+        return any;
+    }
+
+    Systems m_systems;
+    JobSystem *m_jobs = nullptr;
+};
@@ -23,32 +23,78 @@ extern "C"
 #include <entt/entt.hpp>
 
 #include "Components.h"
+#include "Events.h"
+#include "JobSystem.h"
+
+/// @brief component types a system touches, declared as `using Reads = ComponentList<...>` and
+/// `using Writes = ComponentList<...>` so SystemPipeline can check at compile time which systems may run together
+template <typename... Components>
+struct ComponentList
+{
+};
 
 class ISystem
 {
 public:
     virtual ~ISystem() = default;
 
+    /// @brief called once when the system is added to a simulation, e.g. to connect registry signals
+    virtual void OnAttach(entt::registry &registry) {}
+
     virtual bool OnUpdate(entt::registry &registry, float deltaTime) = 0;
+
+    /// @brief label for diagnostics such as the allocation report; a string literal
+    virtual const char *Name() const { return "system"; }
+
+    /// @brief job system the update may spread its work over; without one it runs on the calling thread
+    void UseJobs(JobSystem *jobs) { m_jobs = jobs; }
+
+protected:
+    JobSystem *m_jobs = nullptr;
 };
 
-// basic system to test the interface. Just writes deltaTime to the screen
+// basic system to test the interface. Makes every Text entity drawable.
+// New Text components are picked up through on_construct instead of scanning a view every frame.
 class TextInterface : public ISystem
 {
 public:
+    using Reads = ComponentList<ecs::Text>;
+    using Writes = ComponentList<ecs::Drawable>;
+
+    const char *Name() const override { return "text"; }
+
+    void OnAttach(entt::registry &registry) override
+    {
+        m_onTextCreated = registry.on_construct<ecs::Text>().connect<&TextInterface::OnTextCreated>(*this);
+        m_rescan = true; // text created before the system was attached
+    }
+
     bool OnUpdate(entt::registry &registry, float deltaTime) override
     {
         if (!m_enabled)
             return false;
 
-        auto view = registry.view<ecs::Text>(entt::exclude<ecs::Drawable>);
         bool updated = false;
-
-        view.each([&](entt::entity e, const ecs::Text &textComponent)
-                  {
-            registry.emplace<ecs::Drawable>(e, ecs::Drawable{textComponent.color});
-            if(!updated) 
+        if (m_rescan)
+        {
+            // fallback after attach or a queue overflow, the only time this system walks a view
+            auto view = registry.view<ecs::Text>(entt::exclude<ecs::Drawable>);
+            view.each([&](entt::entity e, const ecs::Text &textComponent)
+                      {
+                registry.emplace<ecs::Drawable>(e, ecs::Drawable{textComponent.color});
                 updated = true; });
+            m_rescan = false;
+        }
+
+        for (entt::entity e : m_created)
+        {
+            if (registry.valid(e) && registry.all_of<ecs::Text>(e) && !registry.all_of<ecs::Drawable>(e))
+            {
+                registry.emplace<ecs::Drawable>(e, ecs::Drawable{registry.get<ecs::Text>(e).color});
+                updated = true;
+            }
+        }
+        m_created.Clear();
 
         return updated;
     }
@@ -59,5 +105,14 @@ public:
     }
 
 private:
+    void OnTextCreated(entt::registry &, entt::entity e)
+    {
+        if (!m_created.Push(e))
+            m_rescan = true;
+    }
+
     bool m_enabled = true;
-};
\ No newline at end of file
+    bool m_rescan = false;
+    EventQueue<entt::entity> m_created; // Text entities constructed since the last update
+    entt::scoped_connection m_onTextCreated;
+};
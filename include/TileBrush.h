@@ -0,0 +1,164 @@
+/**
+ * @file TileBrush.h
+ * @brief Shape brushes for the tile editor.
+ * @date 2025-07-22
+ * @details Every shape is decomposed into horizontal runs and written with Tilemap::FillSpan, so a brush
+ * costs one bounds clip and one std::fill per row instead of a bounds check per tile.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Tilemap.h"
+
+enum class BrushType
+{
+    Square,
+    Circle,
+    Line,      // drag to draw a straight line with the current brush
+    Rectangle, // drag to fill a rectangle
+    Fill,      // flood fill the region under the cursor
+    Count
+};
+
+inline const char *BrushTypeName(BrushType type)
+{
+    switch (type)
+    {
+    case BrushType::Square:
+        return "Square";
+    case BrushType::Circle:
+        return "Circle";
+    case BrushType::Line:
+        return "Line";
+    case BrushType::Rectangle:
+        return "Rectangle";
+    case BrushType::Fill:
+        return "Fill";
+    default:
+        return "?";
+    }
+}
+
+inline BrushType NextBrushType(BrushType type)
+{
+    return static_cast<BrushType>((static_cast<int>(type) + 1) % static_cast<int>(BrushType::Count));
+}
+
+struct TileBrush
+{
+    /// @brief fill the rectangle spanned by two corners (inclusive, any order)
+    static void FillRect(Tilemap &tm, int ax, int ay, int bx, int by, int value)
+    {
+        int x0 = std::min(ax, bx), x1 = std::max(ax, bx);
+        int y0 = std::min(ay, by), y1 = std::max(ay, by);
+        for (int y = y0; y <= y1; ++y)
+            Tilemap::FillSpan(tm, y, x0, x1, value);
+    }
+
+    /// @brief filled disc, one span per row
+    static void FillCircle(Tilemap &tm, int cx, int cy, int radius, int value)
+    {
+        const float r = radius + 0.5f; // rounds the outline so radius 1 is a plus, not a single tile
+        for (int dy = -radius; dy <= radius; ++dy)
+        {
+            int half = static_cast<int>(std::sqrt(r * r - static_cast<float>(dy * dy)));
+            Tilemap::FillSpan(tm, cy + dy, cx - half, cx + half, value);
+        }
+    }
+
+    /// @brief stamp a square or circle brush of the given size centered on (cx, cy)
+    static void Stamp(Tilemap &tm, BrushType type, int cx, int cy, int size, int value)
+    {
+        int radius = (size - 1) / 2;
+        if (type == BrushType::Circle)
+            FillCircle(tm, cx, cy, radius, value);
+        else
+            FillRect(tm, cx - radius, cy - radius, cx + radius, cy + radius, value);
+    }
+
+    /// @brief Bresenham line from a to b (inclusive), stamping the brush at every step
+    static void DrawLine(Tilemap &tm, int ax, int ay, int bx, int by, BrushType stamp, int size, int value)
+    {
+        int dx = std::abs(bx - ax), sx = ax < bx ? 1 : -1;
+        int dy = -std::abs(by - ay), sy = ay < by ? 1 : -1;
+        int err = dx + dy;
+        while (true)
+        {
+            if (size <= 1)
+                Tilemap::FillSpan(tm, ay, ax, ax, value);
+            else
+                Stamp(tm, stamp, ax, ay, size, value);
+
+            if (ax == bx && ay == by)
+                break;
+            int e2 = 2 * err;
+            if (e2 >= dy)
+            {
+                err += dy;
+                ax += sx;
+            }
+            if (e2 <= dx)
+            {
+                err += dx;
+                ay += sy;
+            }
+        }
+    }
+
+    /// @brief scanline flood fill of the 4-connected region containing (x, y), clipped to limit
+    /// @details the map is unbounded, so the fill needs a limit (the editor passes the visible area).
+    /// Each popped seed is widened to its full run, written with one FillSpan, and the rows above and below
+    /// are scanned once over that run to push one seed per unfilled run. Work is linear in the region size,
+    /// so filling a million tiles takes one call.
+    static void FloodFill(Tilemap &tm, int x, int y, int value, const TileRect &limit)
+    {
+        if (!limit.Contains(x, y))
+            return;
+        Tilemap::Reader reader{Tilemap::Active(tm)};
+        const int target = reader.Get(x, y);
+        if (target == value)
+            return;
+
+        struct Seed
+        {
+            int x, y;
+        };
+        static thread_local std::vector<Seed> seeds; // reused between fills, grows to the largest frontier seen
+        seeds.clear();
+        seeds.push_back({x, y});
+
+        while (!seeds.empty())
+        {
+            Seed seed = seeds.back();
+            seeds.pop_back();
+            if (reader.Get(seed.x, seed.y) != target)
+                continue; // filled through another seed
+
+            int left = seed.x, right = seed.x;
+            while (left > limit.x0 && reader.Get(left - 1, seed.y) == target)
+                --left;
+            while (right < limit.x1 - 1 && reader.Get(right + 1, seed.y) == target)
+                ++right;
+            Tilemap::FillSpan(tm, seed.y, left, right, value);
+            reader.Reset(); // FillSpan may have allocated or freed the cached chunk
+
+            for (int ny : {seed.y - 1, seed.y + 1})
+            {
+                if (ny < limit.y0 || ny >= limit.y1)
+                    continue;
+                for (int nx = left; nx <= right; ++nx)
+                {
+                    if (reader.Get(nx, ny) != target)
+                        continue;
+                    seeds.push_back({nx, ny});
+                    while (nx < right && reader.Get(nx + 1, ny) == target)
+                        ++nx; // one seed per run
+                }
+            }
+        }
+    }
+};
@@ -0,0 +1,325 @@
+/**
+ * @file TileGenerator.h
+ * @brief Seeded procedural generators that fill a tile layer chunk by chunk.
+ * @date 2025-07-25
+ * @details Every generator is a pure function of (seed, chunk coordinates): random numbers come from hashing
+ * the seed with world tile coordinates, never from a shared stream. Chunks can therefore be generated in any
+ * order on any number of threads and still come out identical, and neighbouring chunks line up.
+ *   Terrain - side-view ground under a value-noise surface, with noise caves and ore
+ *   Caves   - cellular automaton over random fill. Each chunk is simulated with a border as wide as the
+ *             number of steps, so its tiles see the same neighbourhood as in an unbounded run.
+ *   Rooms   - BSP rooms inside fixed 128-tile regions, linked to the neighbouring regions through doors
+ *             placed by hashing the shared border
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Tilemap.h"
+#include "JobSystem.h"
+
+enum class GeneratorType
+{
+    Terrain,
+    Caves,
+    Rooms,
+    Count
+};
+
+inline const char *GeneratorTypeName(GeneratorType type)
+{
+    switch (type)
+    {
+    case GeneratorType::Terrain:
+        return "Terrain";
+    case GeneratorType::Caves:
+        return "Caves";
+    case GeneratorType::Rooms:
+        return "Rooms";
+    default:
+        return "?";
+    }
+}
+
+inline GeneratorType NextGeneratorType(GeneratorType type)
+{
+    return static_cast<GeneratorType>((static_cast<int>(type) + 1) % static_cast<int>(GeneratorType::Count));
+}
+
+struct TileGenerator
+{
+    /// @brief fill out with the generated tiles of chunk (cx, cy)
+    static void GenerateChunk(GeneratorType type, uint64_t seed, int cx, int cy, TileChunk &out)
+    {
+        switch (type)
+        {
+        case GeneratorType::Terrain:
+            Terrain(seed, cx, cy, out);
+            break;
+        case GeneratorType::Caves:
+            Caves(seed, cx, cy, out);
+            break;
+        case GeneratorType::Rooms:
+            Rooms(seed, cx, cy, out);
+            break;
+        default:
+            break;
+        }
+        out.filled = 0;
+        for (const ecs::Tile &tile : out.tiles)
+            out.filled += tile.value != 0;
+    }
+
+    /// @brief generate the chunks overlapping area in parallel, results in key order
+    static void GenerateChunks(GeneratorType type, uint64_t seed, const TileRect &area, JobSystem &jobs,
+                               std::vector<uint64_t> &keys, std::vector<TileChunk> &chunks)
+    {
+        keys.clear();
+        for (int cy = TileChunk::ChunkCoord(area.y0); cy <= TileChunk::ChunkCoord(area.y1 - 1); ++cy)
+            for (int cx = TileChunk::ChunkCoord(area.x0); cx <= TileChunk::ChunkCoord(area.x1 - 1); ++cx)
+                keys.push_back(TileChunk::Key(cx, cy));
+        chunks.resize(keys.size());
+        jobs.ParallelFor(keys.size(), [&](size_t i)
+                         { GenerateChunk(type, seed, TileChunk::KeyX(keys[i]), TileChunk::KeyY(keys[i]), chunks[i]); });
+    }
+
+    /// @brief replace the chunks overlapping area on one layer with generated ones
+    /// @details chunks are generated in parallel, then written on the calling thread one run of equal tiles at
+    /// a time through FillLayerSpan, so undo recording, dirty flags and streaming all see the change.
+    /// @return number of tiles generated
+    static size_t Generate(Tilemap &tm, int layer, GeneratorType type, uint64_t seed, const TileRect &area, JobSystem &jobs)
+    {
+        std::vector<uint64_t> keys;
+        std::vector<TileChunk> chunks;
+        GenerateChunks(type, seed, area, jobs, keys, chunks);
+
+        for (size_t i = 0; i < keys.size(); ++i)
+        {
+            const int x = TileChunk::KeyX(keys[i]) << TileChunk::SHIFT, y = TileChunk::KeyY(keys[i]) << TileChunk::SHIFT;
+            for (int ly = 0; ly < TileChunk::SIZE; ++ly)
+            {
+                const ecs::Tile *row = chunks[i].Row(ly);
+                for (int from = 0; from < TileChunk::SIZE;)
+                {
+                    int to = from;
+                    while (to + 1 < TileChunk::SIZE && row[to + 1].value == row[from].value)
+                        ++to;
+                    Tilemap::FillLayerSpan(tm, layer, y + ly, x + from, x + to, row[from].value);
+                    from = to + 1;
+                }
+            }
+        }
+        return keys.size() * TileChunk::SIZE * TileChunk::SIZE;
+    }
+
+    // --- random numbers from coordinates ---
+
+    static uint64_t Mix(uint64_t value)
+    {
+        // splitmix64 finalizer
+        value += 0x9E3779B97F4A7C15ull;
+        value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+        value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+        return value ^ (value >> 31);
+    }
+
+    static uint64_t Hash(uint64_t seed, int x, int y, uint64_t salt = 0)
+    {
+        return Mix(seed ^ Mix(static_cast<uint32_t>(x) ^ (static_cast<uint64_t>(static_cast<uint32_t>(y)) << 32) ^ Mix(salt)));
+    }
+
+    /// @return uniform value in [0, 1)
+    static float Hash01(uint64_t seed, int x, int y, uint64_t salt = 0)
+    {
+        return static_cast<float>(Hash(seed, x, y, salt) >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /// @brief smooth value noise in [0, 1) on a lattice with the given cell size in tiles
+    static float ValueNoise(uint64_t seed, float x, float y, float cell, uint64_t salt)
+    {
+        const float fx = x / cell, fy = y / cell;
+        const int ix = static_cast<int>(std::floor(fx)), iy = static_cast<int>(std::floor(fy));
+        float tx = fx - ix, ty = fy - iy;
+        tx = tx * tx * (3.0f - 2.0f * tx);
+        ty = ty * ty * (3.0f - 2.0f * ty);
+        const float a = Hash01(seed, ix, iy, salt), b = Hash01(seed, ix + 1, iy, salt);
+        const float c = Hash01(seed, ix, iy + 1, salt), d = Hash01(seed, ix + 1, iy + 1, salt);
+        return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty;
+    }
+
+    /// @brief four octaves of value noise, in [0, 1)
+    static float Fractal(uint64_t seed, float x, float y, float cell, uint64_t salt)
+    {
+        float sum = 0.0f, amplitude = 0.5f;
+        for (int octave = 0; octave < 4; ++octave)
+        {
+            sum += amplitude * ValueNoise(seed, x, y, cell, salt + octave);
+            cell *= 0.5f;
+            amplitude *= 0.5f;
+        }
+        return sum / 0.9375f;
+    }
+
+private:
+    static constexpr int TILE_GROUND = 1;
+    static constexpr int TILE_ORE = 2;
+    static constexpr int TILE_GRASS = 3;
+
+    static void Terrain(uint64_t seed, int cx, int cy, TileChunk &out)
+    {
+        const int baseX = cx << TileChunk::SHIFT, baseY = cy << TileChunk::SHIFT;
+        std::array<int, TileChunk::SIZE> surface;
+        for (int lx = 0; lx < TileChunk::SIZE; ++lx)
+            surface[lx] = static_cast<int>((Fractal(seed, static_cast<float>(baseX + lx), 0.0f, 96.0f, 1) - 0.5f) * 64.0f);
+
+        for (int ly = 0; ly < TileChunk::SIZE; ++ly)
+        {
+            ecs::Tile *row = out.Row(ly);
+            const int y = baseY + ly;
+            for (int lx = 0; lx < TileChunk::SIZE; ++lx)
+            {
+                const int x = baseX + lx, depth = y - surface[lx];
+                int value = 0;
+                if (depth >= 0)
+                    value = depth < 2 ? TILE_GRASS : TILE_GROUND;
+                if (depth > 6 && Fractal(seed, static_cast<float>(x), static_cast<float>(y), 24.0f, 11) > 0.66f)
+                    value = 0; // caves
+                else if (value == TILE_GROUND && depth > 12 && Hash01(seed, x, y, 21) < 0.02f)
+                    value = TILE_ORE;
+                row[lx].value = value;
+            }
+        }
+    }
+
+    static void Caves(uint64_t seed, int cx, int cy, TileChunk &out)
+    {
+        constexpr int STEPS = 5;
+        constexpr int PAD = STEPS; // each step is only exact one tile further in from the border
+        constexpr int SIDE = TileChunk::SIZE + 2 * PAD;
+        constexpr int STRIDE = SIDE + 2; // plus a ring of permanent wall, so the neighbour sum needs no bounds checks
+        std::array<uint8_t, STRIDE * STRIDE> cells, next;
+        cells.fill(1);
+        next.fill(1);
+
+        const int originX = (cx << TileChunk::SHIFT) - PAD, originY = (cy << TileChunk::SHIFT) - PAD;
+        for (int y = 0; y < SIDE; ++y)
+            for (int x = 0; x < SIDE; ++x)
+                cells[(y + 1) * STRIDE + x + 1] = Hash01(seed, originX + x, originY + y, 31) < 0.45f;
+
+        for (int step = 0; step < STEPS; ++step)
+        {
+            for (int y = 1; y <= SIDE; ++y)
+            {
+                const uint8_t *above = &cells[(y - 1) * STRIDE], *row = &cells[y * STRIDE], *below = &cells[(y + 1) * STRIDE];
+                for (int x = 1; x <= SIDE; ++x)
+                {
+                    const int walls = above[x - 1] + above[x] + above[x + 1] + row[x - 1] + row[x + 1] + below[x - 1] + below[x] + below[x + 1];
+                    next[y * STRIDE + x] = walls >= 5 || (walls >= 4 && row[x]);
+                }
+            }
+            cells.swap(next);
+        }
+
+        for (int ly = 0; ly < TileChunk::SIZE; ++ly)
+        {
+            ecs::Tile *row = out.Row(ly);
+            const uint8_t *cellRow = &cells[(ly + PAD + 1) * STRIDE + PAD + 1];
+            for (int lx = 0; lx < TileChunk::SIZE; ++lx)
+                row[lx].value = cellRow[lx] ? TILE_GROUND : 0;
+        }
+    }
+
+    // rooms are laid out per region, every chunk of a region recomputes the same layout
+    static constexpr int REGION_SHIFT = 7;
+    static constexpr int REGION_SIZE = 1 << REGION_SHIFT;
+    static_assert(REGION_SIZE % TileChunk::SIZE == 0, "a chunk must lie inside one region");
+
+    /// @brief position along the border between region (rx, ry) and its right (below = false) or lower neighbour
+    static int Door(uint64_t seed, int rx, int ry, bool below)
+    {
+        return 8 + static_cast<int>(Hash(seed, rx, ry, below ? 42 : 41) % (REGION_SIZE - 16));
+    }
+
+    static void Rooms(uint64_t seed, int cx, int cy, TileChunk &out)
+    {
+        const int rx = (cx << TileChunk::SHIFT) >> REGION_SHIFT, ry = (cy << TileChunk::SHIFT) >> REGION_SHIFT;
+        const int regionX = rx << REGION_SHIFT, regionY = ry << REGION_SHIFT;
+
+        std::vector<TileRect> carved; // open space in region coordinates
+        struct Node
+        {
+            TileRect area;
+            int depth;
+        };
+        std::vector<Node> stack = {{{0, 0, REGION_SIZE, REGION_SIZE}, 0}};
+        uint64_t rng = Hash(seed, rx, ry, 51);
+        auto next = [&rng](int range)
+        { rng = Mix(rng); return range > 0 ? static_cast<int>(rng % static_cast<uint64_t>(range)) : 0; };
+
+        // each split pushes both halves; a leaf gets a room and is linked to the previous leaf
+        int lastX = -1, lastY = -1, firstX = 0, firstY = 0;
+        auto corridor = [&carved](int ax, int ay, int bx, int by)
+        {
+            carved.push_back({std::min(ax, bx), ay, std::max(ax, bx) + 2, ay + 2});
+            carved.push_back({bx, std::min(ay, by), bx + 2, std::max(ay, by) + 2});
+        };
+        while (!stack.empty())
+        {
+            Node node = stack.back();
+            stack.pop_back();
+            const int w = node.area.x1 - node.area.x0, h = node.area.y1 - node.area.y0;
+            const bool splitX = w >= h;
+            const int length = splitX ? w : h;
+            if (node.depth < 4 && length >= 40)
+            {
+                const int at = length / 2 - length / 6 + next(length / 3);
+                Node a = node, b = node;
+                a.depth = b.depth = node.depth + 1;
+                if (splitX)
+                    a.area.x1 = b.area.x0 = node.area.x0 + at;
+                else
+                    a.area.y1 = b.area.y0 = node.area.y0 + at;
+                stack.push_back(b);
+                stack.push_back(a);
+                continue;
+            }
+
+            const int roomW = std::max(6, w - 4 - next(w / 2)), roomH = std::max(6, h - 4 - next(h / 2));
+            const int x0 = node.area.x0 + 2 + next(w - roomW - 3), y0 = node.area.y0 + 2 + next(h - roomH - 3);
+            carved.push_back({x0, y0, x0 + roomW, y0 + roomH});
+            const int centerX = x0 + roomW / 2, centerY = y0 + roomH / 2;
+            if (lastX >= 0)
+                corridor(lastX, lastY, centerX, centerY);
+            else
+                firstX = centerX, firstY = centerY;
+            lastX = centerX;
+            lastY = centerY;
+        }
+
+        // doors on all four borders, placed by the region on the left/top of each border. A corridor runs
+        // horizontally along its start row and then vertically along its end column, so pick the ends that
+        // cross each border at the door.
+        const int right = Door(seed, rx, ry, false), below = Door(seed, rx, ry, true);
+        const int left = Door(seed, rx - 1, ry, false), above = Door(seed, rx, ry - 1, true);
+        corridor(REGION_SIZE - 2, right, firstX, firstY);
+        corridor(0, left, firstX, firstY);
+        corridor(firstX, firstY, below, REGION_SIZE - 2);
+        corridor(firstX, firstY, above, 0);
+
+        const int localX = (cx << TileChunk::SHIFT) - regionX, localY = (cy << TileChunk::SHIFT) - regionY;
+        out.tiles.fill(ecs::Tile{TILE_GROUND});
+        for (const TileRect &rect : carved)
+        {
+            const int x0 = std::max(rect.x0, localX) - localX, x1 = std::min(rect.x1, localX + TileChunk::SIZE) - localX;
+            const int y0 = std::max(rect.y0, localY) - localY, y1 = std::min(rect.y1, localY + TileChunk::SIZE) - localY;
+            for (int y = y0; y < y1; ++y)
+                std::fill(out.Row(y) + x0, out.Row(y) + std::max(x0, x1), ecs::Tile{0});
+        }
+    }
+};
@@ -0,0 +1,308 @@
+/**
+ * @file TileHistory.h
+ * @brief Undo/redo for tilemap edits, stored as run-length deltas.
+ * @date 2025-07-23
+ * @details A stroke is everything written between BeginStroke and EndStroke. While a stroke is open the
+ * tilemap's recording hook collects a TileRun for every stretch of tiles that actually changed, so a stroke
+ * costs memory proportional to the tiles it changed, not the map. Undo writes the old values back in reverse
+ * order, redo replays the new values, both one FillSpan per run on the layer it was recorded on. The total size of all stored strokes is
+ * capped, and the oldest strokes are forgotten first. The stroke in progress is held to the same cap: one that
+ * outgrows it stops recording and can't be undone. Forget() cuts the tiles that changed without being recorded,
+ * e.g. moved by the sand simulation, out of the stored runs, since replaying them would undo those changes too.
+ * The stroke in progress keeps recording and is cut when it ends. Tiles written into a streaming placeholder
+ * are recorded with unknown old values until Resolve() fills them in from the stored chunk.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <span>
+#include <vector>
+
+#include "Tilemap.h"
+#include "Log.h"
+
+class TileHistory
+{
+public:
+    static constexpr size_t DEFAULT_MEMORY_BUDGET = 16 * 1024 * 1024; // bytes of TileRuns kept for undo + redo
+
+    explicit TileHistory(size_t memoryBudget = DEFAULT_MEMORY_BUDGET)
+        : m_memoryBudget(memoryBudget)
+    {
+    }
+
+    /// @brief start collecting changes to tm, nested calls are ignored
+    void BeginStroke(Tilemap &tm)
+    {
+        if (m_recording)
+            return;
+        m_current.clear();
+        tm.recording = &m_current;
+        tm.recordingLimit = m_memoryBudget / sizeof(TileRun);
+        m_recording = true;
+    }
+
+    /// @brief stop collecting and push the stroke to the undo stack if it changed anything
+    void EndStroke(Tilemap &tm)
+    {
+        if (!m_recording)
+            return;
+        const bool overflowed = tm.recording != &m_current; // FillSpan dropped it at the limit
+        tm.recording = nullptr;
+        m_recording = false;
+        if (overflowed)
+        {
+            // replaying the older strokes would write their values under the unrecorded ones, as when TrimToBudget()
+            // drops a stroke larger than the budget along with everything before it
+            Log::Warn("Edit too large to undo (over {} KiB).", m_memoryBudget / 1024);
+            Clear();
+            m_pending.clear();
+            return;
+        }
+        if (m_current.empty())
+        {
+            m_pending.clear();
+            return;
+        }
+
+        // a new edit invalidates the redo branch
+        for (const Stroke &stroke : m_redo)
+            m_bytes -= stroke.runs.size() * sizeof(TileRun);
+        m_redo.clear();
+
+        Stroke &stroke = m_undo.emplace_back();
+        stroke.runs.assign(m_current.begin(), m_current.end());
+        for (const TileRun &run : m_current)
+        {
+            stroke.layers |= LayerBit(run.layer);
+            stroke.unresolved |= run.oldValue == TileRun::UNKNOWN;
+        }
+        m_bytes += m_current.size() * sizeof(TileRun);
+        m_current.clear();
+        for (const Forgotten &forgotten : m_pending)
+            Cut(stroke, forgotten.layer, {&forgotten.rect, 1});
+        m_pending.clear();
+        if (stroke.runs.empty())
+            m_undo.pop_back(); // everything it wrote moved since
+        TrimToBudget();
+    }
+
+    bool Undo(Tilemap &tm)
+    {
+        if (m_recording || m_undo.empty())
+            return false;
+        const Stroke &stroke = m_undo.back();
+        for (auto run = stroke.runs.rbegin(); run != stroke.runs.rend(); ++run)
+            Tilemap::FillLayerSpan(tm, run->layer, run->y, run->x, run->x + run->count - 1, run->oldValue);
+        m_redo.push_back(std::move(m_undo.back()));
+        m_undo.pop_back();
+        return true;
+    }
+
+    bool Redo(Tilemap &tm)
+    {
+        if (m_recording || m_redo.empty())
+            return false;
+        const Stroke &stroke = m_redo.back();
+        for (const TileRun &run : stroke.runs)
+            Tilemap::FillLayerSpan(tm, run.layer, run.y, run.x, run.x + run.count - 1, run.newValue);
+        m_undo.push_back(std::move(m_redo.back()));
+        m_redo.pop_back();
+        return true;
+    }
+
+    void Clear()
+    {
+        m_undo.clear();
+        m_redo.clear();
+        m_bytes = 0;
+    }
+
+    /// @brief the tiles of layer in rects changed without being recorded: undo and redo leave them alone from now on.
+    /// Strokes that wrote nothing else are dropped; the stroke in progress is cut when it ends.
+    void Forget(int layer, std::span<const TileRect> rects)
+    {
+        if (rects.empty())
+            return;
+        auto cut = [&](Stroke &stroke)
+        {
+            Cut(stroke, layer, rects);
+            return stroke.runs.empty();
+        };
+        std::erase_if(m_undo, cut);
+        std::erase_if(m_redo, cut);
+        if (m_recording)
+        {
+            for (const TileRect &rect : rects)
+                Defer(layer, rect);
+        }
+    }
+
+    /// @brief chunk key of layer streamed in under a placeholder (see ChunkStore): the tiles written to it before it
+    /// did get their old values from stored, null if nothing was stored. Call it for every arrival before undoing.
+    void Resolve(int layer, uint64_t key, const TileChunk *stored)
+    {
+        const int x = TileChunk::KeyX(key) << TileChunk::SHIFT, y = TileChunk::KeyY(key) << TileChunk::SHIFT;
+        const TileRect chunk = {x, y, x + TileChunk::SIZE, y + TileChunk::SIZE};
+        auto resolve = [&](Stroke &stroke)
+        {
+            if (!stroke.unresolved || !(stroke.layers & LayerBit(layer)))
+                return;
+            m_bytes -= stroke.runs.size() * sizeof(TileRun);
+            ResolveRuns(stroke.runs, layer, chunk, stored);
+            m_bytes += stroke.runs.size() * sizeof(TileRun);
+            stroke.unresolved = std::any_of(stroke.runs.begin(), stroke.runs.end(), [](const TileRun &run)
+                                            { return run.oldValue == TileRun::UNKNOWN; });
+        };
+        std::for_each(m_undo.begin(), m_undo.end(), resolve);
+        std::for_each(m_redo.begin(), m_redo.end(), resolve);
+        if (m_recording)
+            ResolveRuns(m_current, layer, chunk, stored);
+        TrimToBudget();
+    }
+
+    size_t UndoCount() const { return m_undo.size(); }
+    size_t RedoCount() const { return m_redo.size(); }
+
+    /// @brief bytes of run data currently held
+    size_t MemoryUsage() const { return m_bytes; }
+
+private:
+    struct Stroke
+    {
+        std::vector<TileRun> runs;
+        uint64_t layers = 0;     // LayerBit of every layer the runs write to
+        bool unresolved = false; // some runs still have TileRun::UNKNOWN old values
+    };
+
+    // a rect the stroke in progress must be cut by when it ends
+    struct Forgotten
+    {
+        int layer;
+        TileRect rect;
+    };
+    static constexpr size_t MAX_PENDING = 64; // past this the rects are merged into one, cutting more but never less
+
+    // layers past 63 share bits, a stroke's bits only ever let Cut() skip it
+    static uint64_t LayerBit(int layer) { return uint64_t{1} << (layer & 63); }
+
+    /// @brief remove the tiles of layer inside rects from the stroke's runs, splitting the runs they cross
+    void Cut(Stroke &stroke, int layer, std::span<const TileRect> rects)
+    {
+        if (!(stroke.layers & LayerBit(layer)))
+            return;
+        const size_t before = stroke.runs.size();
+        m_cut.clear();
+        for (const TileRun &run : stroke.runs)
+        {
+            if (run.layer == layer)
+                CutRun(run, rects);
+            else
+                m_cut.push_back(run);
+        }
+        std::swap(stroke.runs, m_cut);
+        m_bytes = m_bytes - before * sizeof(TileRun) + stroke.runs.size() * sizeof(TileRun);
+    }
+
+    /// @brief append to m_cut what is left of run outside rects
+    void CutRun(TileRun run, std::span<const TileRect> rects)
+    {
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            const TileRect &rect = rects[i];
+            const int end = run.x + run.count;
+            if (run.y < rect.y0 || run.y >= rect.y1 || end <= rect.x0 || run.x >= rect.x1)
+                continue;
+            if (run.x < rect.x0)
+            {
+                TileRun left = run;
+                left.count = rect.x0 - run.x;
+                CutRun(left, rects.subspan(i + 1));
+            }
+            if (end > rect.x1)
+            {
+                run.count = end - rect.x1;
+                run.x = rect.x1;
+                CutRun(run, rects.subspan(i + 1));
+            }
+            return;
+        }
+        m_cut.push_back(run);
+    }
+
+    /// @brief give the runs of layer inside chunk that have unknown old values the stored ones, splitting the runs
+    /// that cross its border. Tiles stored with the value they were written are dropped, as RecordSpan() would.
+    void ResolveRuns(std::vector<TileRun> &runs, int layer, const TileRect &chunk, const TileChunk *stored)
+    {
+        static constexpr std::array<ecs::Tile, TileChunk::SIZE> EMPTY_ROW{};
+        m_cut.clear();
+        for (const TileRun &run : runs)
+        {
+            const int end = run.x + run.count;
+            if (run.layer != layer || run.oldValue != TileRun::UNKNOWN || run.y < chunk.y0 || run.y >= chunk.y1 ||
+                end <= chunk.x0 || run.x >= chunk.x1)
+            {
+                m_cut.push_back(run);
+                continue;
+            }
+            if (run.x < chunk.x0)
+                m_cut.push_back({run.x, run.y, chunk.x0 - run.x, run.oldValue, run.newValue, run.layer});
+            const int from = std::max(run.x, chunk.x0), to = std::min(end, chunk.x1) - 1;
+            const ecs::Tile *row = stored ? stored->Row(run.y - chunk.y0) : EMPTY_ROW.data();
+            Tilemap::RecordSpan(m_cut, row + (from - chunk.x0), layer, run.y, from, to, run.newValue);
+            if (end > chunk.x1)
+                m_cut.push_back({chunk.x1, run.y, end - chunk.x1, run.oldValue, run.newValue, run.layer});
+        }
+        std::swap(runs, m_cut);
+    }
+
+    void Defer(int layer, const TileRect &rect)
+    {
+        for (Forgotten &pending : m_pending)
+        {
+            const bool overlap = rect.x0 < pending.rect.x1 && pending.rect.x0 < rect.x1 && rect.y0 < pending.rect.y1 && pending.rect.y0 < rect.y1;
+            if (pending.layer == layer && overlap)
+            {
+                pending.rect.Merge(rect); // sand keeps moving in the same places, step after step
+                return;
+            }
+        }
+        if (m_pending.size() == MAX_PENDING)
+        {
+            for (Forgotten &pending : m_pending)
+            {
+                if (pending.layer == layer)
+                {
+                    pending.rect.Merge(rect);
+                    return;
+                }
+            }
+        }
+        m_pending.push_back({layer, rect});
+    }
+
+    void TrimToBudget()
+    {
+        while (m_bytes > m_memoryBudget && !m_undo.empty())
+        {
+            if (m_undo.size() == 1)
+                Log::Warn("Edit too large to undo ({} KiB).", m_bytes / 1024);
+            m_bytes -= m_undo.front().runs.size() * sizeof(TileRun);
+            m_undo.pop_front(); // oldest edit goes first
+        }
+    }
+
+    size_t m_memoryBudget;
+    size_t m_bytes = 0; // run data held by m_undo and m_redo
+    bool m_recording = false;
+    std::vector<TileRun> m_current; // runs of the stroke in progress, capacity is reused between strokes
+    std::vector<Forgotten> m_pending; // changed under the stroke in progress
+    std::vector<TileRun> m_cut;       // Cut() output, swapped with the runs it cut
+    std::deque<Stroke> m_undo;
+    std::vector<Stroke> m_redo;
+};
@@ -0,0 +1,324 @@
+/**
+ * @file TileRegion.h
+ * @brief On-disk store for tilemap chunks: run-length encoded payloads plus an index of their offsets.
+ * @date 2025-07-24
+ * @details Layout, all values little-endian as written by the host:
+ *   header   "TREG", uint16 version, uint16 chunk size, uint64 index offset, uint32 index entries
+ *   payloads one per chunk, a sequence of (uint16 count, int32 value) runs covering the chunk row-major
+ *   index    (uint64 key, uint64 offset, uint32 size) per chunk
+ * Writes append new payloads after the current index and then append a fresh index, so the header always
+ * points at a complete index even if the program dies mid-save. Replaced payloads and old indices are counted
+ * as dead bytes; once they are more than half of a file past COMPACT_MIN_BYTES, Flush() copies the live payloads into a fresh file and
+ * renames it over this one, so the file stays within twice its live data however often chunks are rewritten.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "Tilemap.h"
+#include "Log.h"
+
+class TileRegionFile
+{
+public:
+    /// @brief open an existing region file or create an empty one
+    bool Open(const std::string &path)
+    {
+        m_index.clear();
+        m_path = path;
+        if (!std::filesystem::exists(path))
+        {
+            std::ofstream create(path, std::ios::binary);
+            if (!create)
+            {
+                Log::Error("Failed to create tile region: {}", path);
+                return false;
+            }
+        }
+        m_file.open(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!m_file)
+        {
+            Log::Error("Failed to open tile region: {}", path);
+            return false;
+        }
+
+        m_file.seekg(0, std::ios::end);
+        const uint64_t size = static_cast<uint64_t>(m_file.tellg());
+        if (size == 0)
+        {
+            m_end = HEADER_SIZE;
+            m_dead = m_indexBytes = 0;
+            return Flush(); // fresh file, write an empty index
+        }
+
+        char magic[sizeof(FILE_MAGIC)] = {};
+        uint16_t version = 0, chunkSize = 0;
+        uint64_t indexOffset = 0;
+        uint32_t entries = 0;
+        m_file.seekg(0);
+        m_file.read(magic, sizeof(magic));
+        ReadValue(version);
+        ReadValue(chunkSize);
+        ReadValue(indexOffset);
+        ReadValue(entries);
+        if (!m_file || std::memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0 || version != FILE_VERSION ||
+            chunkSize != TileChunk::SIZE || indexOffset + uint64_t(entries) * INDEX_ENTRY_SIZE > size)
+        {
+            Log::Error("Not a valid tile region: {}", path);
+            m_file.close();
+            return false;
+        }
+
+        m_file.seekg(static_cast<std::streamoff>(indexOffset));
+        uint64_t live = 0; // payload bytes the index points at
+        for (uint32_t i = 0; i < entries; ++i)
+        {
+            uint64_t key = 0;
+            Entry entry;
+            ReadValue(key);
+            ReadValue(entry.offset);
+            ReadValue(entry.size);
+            m_index[key] = entry;
+            live += entry.size;
+        }
+        m_end = size;
+        m_indexBytes = uint64_t(entries) * INDEX_ENTRY_SIZE;
+        m_dead = size - std::min(size, HEADER_SIZE + live + m_indexBytes);
+        return static_cast<bool>(m_file);
+    }
+
+    bool IsOpen() const { return m_file.is_open(); }
+    bool Contains(uint64_t key) const { return m_index.count(key) != 0; }
+    size_t ChunkCount() const { return m_index.size(); }
+
+    /// @brief keys of every stored chunk, in no particular order
+    std::vector<uint64_t> Keys() const
+    {
+        std::vector<uint64_t> keys;
+        keys.reserve(m_index.size());
+        for (const auto &[key, entry] : m_index)
+            keys.push_back(key);
+        return keys;
+    }
+
+    /// @brief decode the stored chunk into out
+    /// @return false if the chunk isn't stored or the payload is damaged
+    bool Read(uint64_t key, TileChunk &out)
+    {
+        auto it = m_index.find(key);
+        if (it == m_index.end())
+            return false;
+        m_buffer.resize(it->second.size);
+        m_file.seekg(static_cast<std::streamoff>(it->second.offset));
+        m_file.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        if (!m_file)
+        {
+            m_file.clear();
+            return false;
+        }
+
+        size_t tile = 0;
+        out.filled = 0;
+        for (size_t at = 0; at + RUN_SIZE <= m_buffer.size(); at += RUN_SIZE)
+        {
+            uint16_t count;
+            int32_t value;
+            std::memcpy(&count, m_buffer.data() + at, sizeof(count));
+            std::memcpy(&value, m_buffer.data() + at + sizeof(count), sizeof(value));
+            if (tile + count > out.tiles.size())
+                return false;
+            std::fill_n(out.tiles.begin() + tile, count, ecs::Tile{value});
+            out.filled += value != 0 ? count : 0;
+            tile += count;
+        }
+        out.dirty = false;
+        return tile == out.tiles.size();
+    }
+
+    /// @brief append the chunk's payload and point the index at it. An empty or null chunk is removed instead.
+    /// The change is only reachable from the file once Flush() has written the index.
+    void Write(uint64_t key, const TileChunk *chunk)
+    {
+        auto old = m_index.find(key);
+        if (old != m_index.end())
+            m_dead += old->second.size;
+        if (!chunk || chunk->filled == 0)
+        {
+            if (old != m_index.end())
+                m_index.erase(old);
+            return;
+        }
+
+        m_buffer.clear();
+        for (size_t tile = 0; tile < chunk->tiles.size();)
+        {
+            const int32_t value = chunk->tiles[tile].value;
+            size_t end = tile + 1;
+            while (end < chunk->tiles.size() && chunk->tiles[end].value == value)
+                ++end;
+            const uint16_t count = static_cast<uint16_t>(end - tile); // a chunk has at most 1024 tiles
+            char run[RUN_SIZE];
+            std::memcpy(run, &count, sizeof(count));
+            std::memcpy(run + sizeof(count), &value, sizeof(value));
+            m_buffer.insert(m_buffer.end(), run, run + RUN_SIZE);
+            tile = end;
+        }
+
+        m_file.seekp(static_cast<std::streamoff>(m_end));
+        m_file.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+        m_index[key] = {m_end, static_cast<uint32_t>(m_buffer.size())};
+        m_end += m_buffer.size();
+    }
+
+    /// @brief drop every chunk from the index, reachable from the file once Flush() has written the index
+    void RemoveAll()
+    {
+        for (const auto &[key, entry] : m_index)
+            m_dead += entry.size;
+        m_index.clear();
+    }
+
+    /// @brief append the index and switch the header over to it, then compact the file if it is mostly dead bytes
+    bool Flush()
+    {
+        const uint64_t indexOffset = m_end;
+        m_file.seekp(static_cast<std::streamoff>(indexOffset));
+        WriteIndex(m_file, m_index);
+        m_end += m_index.size() * INDEX_ENTRY_SIZE;
+        m_file.flush(); // index is on disk before the header points at it
+
+        m_file.seekp(0);
+        WriteHeader(m_file, indexOffset, m_index.size());
+        m_file.flush();
+        if (!m_file)
+        {
+            Log::Error("Failed to write tile region index.");
+            m_file.clear();
+            return false;
+        }
+        m_dead += m_indexBytes; // the previous index
+        m_indexBytes = m_index.size() * INDEX_ENTRY_SIZE;
+        if (m_end > COMPACT_MIN_BYTES && m_dead > m_end / 2)
+            Compact(); // the file is complete either way, a failed compaction leaves it as it is
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_file.is_open())
+            m_file.close();
+        m_index.clear();
+    }
+
+    /// @brief bytes no longer reachable from the index: replaced or removed payloads and old indices
+    uint64_t DeadBytes() const { return m_dead; }
+
+private:
+    static constexpr char FILE_MAGIC[4] = {'T', 'R', 'E', 'G'};
+    static constexpr uint16_t FILE_VERSION = 1;
+    static constexpr uint64_t HEADER_SIZE = 4 + 2 + 2 + 8 + 4;
+    static constexpr uint64_t INDEX_ENTRY_SIZE = 8 + 8 + 4;
+    static constexpr size_t RUN_SIZE = sizeof(uint16_t) + sizeof(int32_t);
+    static constexpr uint64_t COMPACT_MIN_BYTES = 64 * 1024; // smaller files aren't worth rewriting
+
+    struct Entry
+    {
+        uint64_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    template <typename T>
+    static void WriteValue(std::ostream &out, const T &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    static void WriteHeader(std::ostream &out, uint64_t indexOffset, size_t entries)
+    {
+        out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+        WriteValue(out, FILE_VERSION);
+        WriteValue(out, static_cast<uint16_t>(TileChunk::SIZE));
+        WriteValue(out, indexOffset);
+        WriteValue(out, static_cast<uint32_t>(entries));
+    }
+
+    static void WriteIndex(std::ostream &out, const std::unordered_map<uint64_t, Entry> &index)
+    {
+        for (const auto &[key, entry] : index)
+        {
+            WriteValue(out, key);
+            WriteValue(out, entry.offset);
+            WriteValue(out, entry.size);
+        }
+    }
+
+    /// @brief copy the live payloads and a fresh index into a new file and rename it over this one
+    bool Compact()
+    {
+        const std::string temp = m_path + ".tmp";
+        std::ofstream out(temp, std::ios::binary | std::ios::trunc);
+        std::unordered_map<uint64_t, Entry> index;
+        uint64_t end = HEADER_SIZE;
+        out.seekp(static_cast<std::streamoff>(HEADER_SIZE));
+        for (const auto &[key, entry] : m_index)
+        {
+            m_buffer.resize(entry.size);
+            m_file.seekg(static_cast<std::streamoff>(entry.offset));
+            m_file.read(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            out.write(m_buffer.data(), static_cast<std::streamsize>(m_buffer.size()));
+            index[key] = {end, entry.size};
+            end += entry.size;
+        }
+        WriteIndex(out, index);
+        out.seekp(0);
+        WriteHeader(out, end, index.size());
+        out.close();
+        if (!m_file || !out)
+        {
+            Log::Error("Failed to compact tile region: {}", m_path);
+            m_file.clear();
+            std::filesystem::remove(temp);
+            return false;
+        }
+
+        m_file.close(); // Windows doesn't replace a file that is open
+        std::error_code error;
+        std::filesystem::rename(temp, m_path, error);
+        m_file.open(m_path, std::ios::binary | std::ios::in | std::ios::out);
+        if (error)
+        {
+            Log::Error("Failed to replace tile region {}: {}", m_path, error.message());
+            std::filesystem::remove(temp, error);
+            return false; // the old file was reopened unchanged
+        }
+        Log::Info("Compacted {} from {} to {} KiB", m_path, m_end / 1024, (end + index.size() * INDEX_ENTRY_SIZE) / 1024);
+        m_index = std::move(index);
+        m_end = end + m_index.size() * INDEX_ENTRY_SIZE;
+        m_indexBytes = m_index.size() * INDEX_ENTRY_SIZE;
+        m_dead = 0;
+        return static_cast<bool>(m_file);
+    }
+
+    template <typename T>
+    void ReadValue(T &value)
+    {
+        m_file.read(reinterpret_cast<char *>(&value), sizeof(T));
+    }
+
+    std::fstream m_file;
+    std::unordered_map<uint64_t, Entry> m_index;
+    std::string m_path;
+    uint64_t m_end = 0;         // where the next payload goes
+    uint64_t m_dead = 0;        // bytes before m_end the index doesn't reach, see Compact()
+    uint64_t m_indexBytes = 0;  // size of the index the header points at
+    std::vector<char> m_buffer; // encode/decode scratch, reused
+};
@@ -0,0 +1,461 @@
+/**
+ * @file TileStreamer.h
+ * @brief Streams the chunks of one tile layer between a TileRegionFile and memory around the view.
+ * @date 2025-07-24
+ * @details All file access happens on one loader thread fed by a FIFO job queue, so a chunk evicted and then
+ * requested again is always written before it is read back. The main thread only touches the layer in
+ * Update(), its sync point: finished loads are moved in, chunks near the view that aren't resident are
+ * requested, and once more chunks than the budget are resident the ones farthest from the view are evicted.
+ *
+ * The streamer is the layer's ChunkStore and keeps a copy of the file's index on the main thread, so writes never
+ * wait on the disk: a chunk the file doesn't hold is written in memory right away, and a write to one it holds
+ * goes into a placeholder while the chunk is requested. When the load arrives the written tiles are laid over
+ * the stored ones, so streamed-in tiles never overwrite an edit and an edit never replaces a stored chunk with
+ * a partial one. Arrived() hands the stored tiles under each placeholder to TileHistory::Resolve().
+ * Tilemap::ClearLayer erases the file's chunks through the same hook.
+ * Every edit is kept: a dirty chunk is written through on eviction, Save() writes the resident chunks changed
+ * since they were loaded or last saved, and Close() saves before it stops.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Tilemap.h"
+#include "TileRegion.h"
+#include "Log.h"
+
+class TileStreamer : public ChunkStore
+{
+public:
+    static constexpr size_t DEFAULT_RESIDENT_CHUNKS = 4096; // about 16 MiB of tiles
+    static constexpr int DEFAULT_MARGIN_CHUNKS = 2;         // chunks loaded ahead around the view
+
+    explicit TileStreamer(size_t residentBudget = DEFAULT_RESIDENT_CHUNKS, int marginChunks = DEFAULT_MARGIN_CHUNKS)
+        : m_residentBudget(residentBudget), m_marginChunks(marginChunks)
+    {
+    }
+
+    ~TileStreamer() override { Close(); }
+
+    TileStreamer(const TileStreamer &) = delete;
+    TileStreamer &operator=(const TileStreamer &) = delete;
+
+    /// @brief start the loader thread on a region file. The file itself is opened on that thread, this returns
+    /// once it has read the file's index.
+    void Open(const std::string &path)
+    {
+        Close();
+        m_stop = false;
+        m_opened = false;
+        m_thread = std::thread(&TileStreamer::LoaderMain, this, path);
+        std::unique_lock lock(m_loadedMutex);
+        m_loadReady.wait(lock, [this]
+                         { return m_opened; });
+    }
+
+    /// @brief save the layer last updated, finish queued writes, write the index and stop the loader thread
+    void Close()
+    {
+        if (!m_thread.joinable())
+            return;
+        if (m_layer)
+        {
+            FinishLoads(*m_layer); // placeholders are merged before they are saved
+            Save(*m_layer);
+            m_layer->freedChunks = nullptr;
+            m_layer->store = nullptr;
+            m_layer = nullptr;
+        }
+        Enqueue({Job::Flush});
+        {
+            std::lock_guard lock(m_jobMutex);
+            m_stop = true;
+        }
+        m_jobReady.notify_one();
+        m_thread.join();
+        m_stored.clear();
+        m_inFlight.clear();
+        m_placeholders.clear();
+        m_arrived.clear();
+        m_deleted.clear();
+        m_freed.clear();
+        m_loaded.clear();
+    }
+
+    bool IsOpen() const { return m_thread.joinable(); }
+
+    /// @brief sync point, call once per frame with the tiles in view. The layer must outlive the streamer or Close().
+    void Update(TileLayer &layer, const TileRect &view)
+    {
+        if (!IsOpen())
+            return;
+        m_layer = &layer;
+        layer.freedChunks = &m_freed;
+        layer.store = this;
+        CollectFreed();
+
+        IntegrateLoads(layer);
+
+        const TileRect keep = KeepRegion(view);
+        RequestLoads(layer, keep);
+        if (layer.chunks.size() > m_residentBudget)
+            Evict(layer, keep);
+    }
+
+    /// @brief write every chunk changed since it was loaded or last saved, and the chunks erased since then
+    /// @return number of chunks written
+    size_t Save(TileLayer &layer)
+    {
+        if (!IsOpen())
+            return 0;
+        size_t written = 0;
+        bool changed = false;
+        CollectFreed();
+        for (uint64_t key : m_deleted)
+        {
+            if (layer.chunks.count(key) == 0)
+            {
+                Enqueue({Job::Store, key}); // a null chunk removes it from the index
+                m_stored.erase(key);
+                changed = true;
+            }
+        }
+        m_deleted.clear();
+
+        for (auto &[key, chunk] : layer.chunks)
+        {
+            if (!chunk->dirty)
+                continue;
+            chunk->dirty = false;
+            Enqueue({Job::Store, key, std::make_unique<TileChunk>(*chunk)}); // copy, the map keeps being edited
+            m_stored.insert(key);
+            ++written;
+        }
+        if (changed || written > 0)
+            Enqueue({Job::Flush}); // an untouched layer leaves its file alone
+        return written;
+    }
+
+    /// @brief loads requested but not yet integrated
+    size_t PendingLoads() const { return m_inFlight.size(); }
+
+    /// @brief a stored chunk that streamed in under a placeholder
+    struct Arrival
+    {
+        uint64_t key = 0;
+        std::unique_ptr<TileChunk> stored; // tiles the file held, null if it turned out damaged
+    };
+
+    /// @brief stored chunks merged with their placeholders by the last Update(), for TileHistory::Resolve()
+    const std::vector<Arrival> &Arrived() const { return m_arrived; }
+
+    bool Stored(uint64_t key) const override
+    {
+        if (!IsOpen() || (m_layer && m_layer->chunks.count(key)))
+            return false;
+        if (m_deleted.count(key) || std::find(m_freed.begin(), m_freed.end(), key) != m_freed.end())
+            return false; // erased since the last save, the file's copy is going away
+        return m_stored.count(key) != 0;
+    }
+
+    TileChunk *Placeholder(uint64_t key) override
+    {
+        if (!Stored(key))
+            return nullptr;
+        auto [it, created] = m_placeholders.try_emplace(key);
+        if (created)
+        {
+            it->second = std::make_unique<TileChunk>();
+            it->second->tiles.fill(ecs::Tile{TileRun::UNKNOWN});
+            if (!m_inFlight.count(key))
+                Request(key);
+        }
+        return it->second.get();
+    }
+
+    void EraseStored() override
+    {
+        if (!IsOpen())
+            return;
+        Enqueue({Job::Clear}); // after every queued write, before every later one
+        m_stored.clear();
+        m_inFlight.clear();     // loads queued before the clear read chunks that no longer exist, their tickets lapse
+        m_placeholders.clear(); // and the writes waiting for them are erased along with the rest
+        m_deleted.clear();
+        m_freed.clear();
+    }
+
+private:
+    struct Job
+    {
+        enum Kind
+        {
+            Load,
+            Store,
+            Flush,
+            Clear
+        } kind;
+        uint64_t key = 0;
+        std::unique_ptr<TileChunk> chunk; // Store: data to write, Load: result (null if not in the file)
+        uint64_t ticket = 0;              // Load: matched against m_inFlight, a load whose ticket lapsed is dropped
+    };
+
+    void Enqueue(Job job)
+    {
+        {
+            std::lock_guard lock(m_jobMutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_jobReady.notify_one();
+    }
+
+    void LoaderMain(std::string path)
+    {
+        TileRegionFile file;
+        bool ok = file.Open(path);
+        if (ok)
+            Log::Info("Streaming tiles from {} ({} chunks)", path, file.ChunkCount());
+        {
+            std::lock_guard lock(m_loadedMutex);
+            if (ok)
+            {
+                for (uint64_t key : file.Keys())
+                    m_stored.insert(key);
+            }
+            m_opened = true;
+        }
+        m_loadReady.notify_one();
+
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock lock(m_jobMutex);
+                m_jobReady.wait(lock, [this]
+                                { return m_stop || !m_jobs.empty(); });
+                if (m_jobs.empty())
+                    break; // stopped and drained
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            switch (job.kind)
+            {
+            case Job::Load:
+                if (ok && file.Contains(job.key))
+                {
+                    job.chunk = std::make_unique<TileChunk>();
+                    if (!file.Read(job.key, *job.chunk))
+                    {
+                        Log::Error("Damaged tile chunk {}, {}", TileChunk::KeyX(job.key), TileChunk::KeyY(job.key));
+                        job.chunk.reset();
+                    }
+                }
+                {
+                    std::lock_guard lock(m_loadedMutex);
+                    m_loaded.push_back(std::move(job));
+                }
+                m_loadReady.notify_one();
+                break;
+            case Job::Store:
+                if (ok)
+                    file.Write(job.key, job.chunk.get());
+                break;
+            case Job::Flush:
+                if (ok)
+                    file.Flush();
+                break;
+            case Job::Clear:
+                if (ok)
+                    file.RemoveAll();
+                break;
+            }
+        }
+        file.Close();
+    }
+
+    /// @brief chunk range in view plus the margin, as a TileRect of chunk coordinates
+    TileRect KeepRegion(const TileRect &view) const
+    {
+        return {TileChunk::ChunkCoord(view.x0) - m_marginChunks, TileChunk::ChunkCoord(view.y0) - m_marginChunks,
+                TileChunk::ChunkCoord(view.x1 - 1) + m_marginChunks + 1, TileChunk::ChunkCoord(view.y1 - 1) + m_marginChunks + 1};
+    }
+
+    /// @brief chunks FillSpan freed become deletions for the next Save()
+    void CollectFreed()
+    {
+        for (uint64_t key : m_freed)
+            m_deleted.insert(key);
+        m_freed.clear();
+    }
+
+    void Request(uint64_t key)
+    {
+        m_inFlight.insert_or_assign(key, ++m_lastTicket);
+        Enqueue({Job::Load, key, nullptr, m_lastTicket});
+    }
+
+    /// @brief wait for every requested load and move it in, so no placeholder is left behind
+    void FinishLoads(TileLayer &layer)
+    {
+        while (!m_inFlight.empty())
+        {
+            {
+                std::unique_lock lock(m_loadedMutex);
+                m_loadReady.wait(lock, [this]
+                                 { return !m_loaded.empty(); });
+            }
+            IntegrateLoads(layer);
+        }
+    }
+
+    void IntegrateLoads(TileLayer &layer)
+    {
+        m_arrived.clear();
+        {
+            std::lock_guard lock(m_loadedMutex);
+            m_integrating.swap(m_loaded); // hold the lock only for the swap
+        }
+        for (Job &job : m_integrating)
+            Integrate(layer, job);
+        m_integrating.clear();
+    }
+
+    void Integrate(TileLayer &layer, Job &job)
+    {
+        auto pending = m_inFlight.find(job.key);
+        if (pending == m_inFlight.end() || pending->second != job.ticket)
+            return; // requested before EraseStored(), the file no longer holds what it read
+        m_inFlight.erase(pending);
+        if (!job.chunk)
+            m_stored.erase(job.key); // damaged, missing from now on
+
+        std::unique_ptr<TileChunk> chunk = std::move(job.chunk);
+        auto placeholder = m_placeholders.find(job.key);
+        if (placeholder != m_placeholders.end())
+        {
+            std::unique_ptr<TileChunk> stored = std::move(chunk);
+            chunk = std::move(placeholder->second);
+            m_placeholders.erase(placeholder);
+            Merge(*chunk, stored.get());
+            if (chunk->filled == 0)
+            {
+                chunk.reset();
+                if (stored)
+                    m_deleted.insert(job.key); // everything it held was erased, the next Save() removes it
+            }
+            m_arrived.push_back({job.key, std::move(stored)});
+        }
+        if (!chunk)
+            return;
+
+        const int x = TileChunk::KeyX(job.key) << TileChunk::SHIFT, y = TileChunk::KeyY(job.key) << TileChunk::SHIFT;
+        layer.chunks.emplace(job.key, std::move(chunk));
+        layer.dirty.Merge({x, y, x + TileChunk::SIZE, y + TileChunk::SIZE});
+        if (layer.edits)
+            layer.edits->push_back({x, y, x + TileChunk::SIZE, y + TileChunk::SIZE});
+        ++layer.revision;
+        Tilemap::UpdateMasks(layer, {x - 1, y - 1, x + TileChunk::SIZE + 1, y + TileChunk::SIZE + 1}); // masks aren't stored
+    }
+
+    /// @brief lay the tiles written into a placeholder over the stored ones, null if nothing is stored
+    static void Merge(TileChunk &placeholder, const TileChunk *stored)
+    {
+        placeholder.filled = 0;
+        for (size_t i = 0; i < placeholder.tiles.size(); ++i)
+        {
+            if (placeholder.tiles[i].value == TileRun::UNKNOWN)
+                placeholder.tiles[i] = stored ? stored->tiles[i] : ecs::Tile{};
+            placeholder.filled += placeholder.tiles[i].value != 0;
+        }
+        placeholder.dirty = true;
+    }
+
+    void RequestLoads(const TileLayer &layer, const TileRect &keep)
+    {
+        for (int cy = keep.y0; cy < keep.y1; ++cy)
+        {
+            for (int cx = keep.x0; cx < keep.x1; ++cx)
+            {
+                const uint64_t key = TileChunk::Key(cx, cy);
+                if (!m_stored.count(key) || layer.chunks.count(key) || m_deleted.count(key) || m_inFlight.count(key))
+                    continue; // not in the file, resident, erased since the last save, or already requested
+                Request(key);
+            }
+        }
+    }
+
+    void Evict(TileLayer &layer, const TileRect &keep)
+    {
+        const int centerX = (keep.x0 + keep.x1) / 2, centerY = (keep.y0 + keep.y1) / 2;
+        auto distance = [&](uint64_t key)
+        { return std::max(std::abs(TileChunk::KeyX(key) - centerX), std::abs(TileChunk::KeyY(key) - centerY)); };
+
+        m_candidates.clear();
+        for (const auto &[key, chunk] : layer.chunks)
+        {
+            if (!keep.Contains(TileChunk::KeyX(key), TileChunk::KeyY(key)))
+                m_candidates.push_back(key);
+        }
+        // evict an extra eighth of the budget so this doesn't run again on the next frame
+        const size_t target = m_residentBudget - m_residentBudget / 8;
+        const size_t count = std::min(m_candidates.size(), layer.chunks.size() - target);
+        if (count == 0)
+        {
+            Log::Warn("Tile residency budget is smaller than the view.");
+            return;
+        }
+        std::nth_element(m_candidates.begin(), m_candidates.begin() + (count - 1), m_candidates.end(),
+                         [&](uint64_t a, uint64_t b)
+                         { return distance(a) > distance(b); });
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto it = layer.chunks.find(m_candidates[i]);
+            if (it->second->dirty)
+            {
+                Enqueue({Job::Store, it->first, std::move(it->second)}); // written through, reloaded later if needed
+                m_stored.insert(it->first);
+            }
+            layer.chunks.erase(it);
+        }
+    }
+
+    size_t m_residentBudget;
+    int m_marginChunks;
+
+    // main thread only
+    TileLayer *m_layer = nullptr;                      // layer of the last Update(), saved by Close()
+    std::unordered_set<uint64_t> m_stored;             // the file's index once every queued job is done, set up by LoaderMain()
+    std::unordered_set<uint64_t> m_deleted;            // chunks freed since the last save
+    std::vector<uint64_t> m_freed;                     // TileLayer::freedChunks target
+    std::vector<uint64_t> m_candidates;                // eviction scratch
+    std::unordered_map<uint64_t, uint64_t> m_inFlight; // loads requested but not yet integrated, by key to ticket
+    uint64_t m_lastTicket = 0;
+    std::unordered_map<uint64_t, std::unique_ptr<TileChunk>> m_placeholders; // writes to chunks in flight, see Placeholder()
+    std::vector<Arrival> m_arrived;
+    std::vector<Job> m_integrating;                    // loads being moved into the map, swapped with m_loaded
+
+    // shared with the loader thread
+    std::thread m_thread;
+    std::mutex m_jobMutex;
+    std::condition_variable m_jobReady;
+    std::deque<Job> m_jobs;
+    bool m_stop = false;
+    std::mutex m_loadedMutex;
+    std::condition_variable m_loadReady; // signalled once the index is read and per finished load, for Open() and Close()
+    std::vector<Job> m_loaded;
+    bool m_opened = false;
+};
@@ -1,68 +1,606 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <format>
 
-#Include <raylib>
+#include <raylib.h>
+
+#include "Components.h"
+#include "Autotile.h"
+#include "JobSystem.h"
 
 // map tile values to raylib colors
 static constexpr Color TILE_COLORS[] = {
-    WHITE, // 0: empty tile
-    BLACK, // 1: filled tile
-    RED,   // 2: special tile (example)
-    GREEN, // 3: another special tile (example)
-    BLUE   // 4: yet another special tile (example)
+    WHITE,    // 0: empty tile
+    BLACK,    // 1: filled tile
+    RED,      // 2: special tile (example)
+    GREEN,    // 3: another special tile (example)
+    BLUE,     // 4: yet another special tile (example)
+    BEIGE,    // 5: sand, falls and piles up (SandSimulation)
+    DARKBLUE, // 6: water, falls and spreads (SandSimulation)
+    GRAY      // 7: stone, holds sand and water up
+};
+
+// tile values with behaviour, see SandSimulation.h
+static constexpr int TILE_SAND = 5;
+static constexpr int TILE_WATER = 6;
+static constexpr int TILE_STONE = 7;
+
+/// @brief half-open rectangle of tile coordinates [x0, x1) x [y0, y1)
+struct TileRect
+{
+    int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+    bool Empty() const { return x0 >= x1 || y0 >= y1; }
+    bool Contains(int x, int y) const { return x >= x0 && x < x1 && y >= y0 && y < y1; }
+
+    void Merge(const TileRect &other)
+    {
+        if (other.Empty())
+            return;
+        if (Empty())
+        {
+            *this = other;
+            return;
+        }
+        x0 = std::min(x0, other.x0);
+        y0 = std::min(y0, other.y0);
+        x1 = std::max(x1, other.x1);
+        y1 = std::max(y1, other.y1);
+    }
 };
 
+/// @brief run of tiles in one row of one layer that changed from oldValue to newValue, the unit of undo history
+struct TileRun
+{
+    static constexpr int32_t UNKNOWN = INT32_MIN; // oldValue of a tile written before its stored chunk streamed in
+
+    int32_t x = 0, y = 0;
+    int32_t count = 0;
+    int32_t oldValue = 0;
+    int32_t newValue = 0;
+    int32_t layer = 0;
+};
+
+/// @brief fixed square block of tiles, the unit of allocation of a Tilemap
+struct TileChunk
+{
+    static constexpr int SHIFT = 5;
+    static constexpr int SIZE = 1 << SHIFT; // tiles per chunk side
+    static constexpr int MASK = SIZE - 1;
+
+    std::array<ecs::Tile, SIZE * SIZE> tiles{}; // row-major
+    std::array<uint8_t, SIZE * SIZE> masks{};   // autotile neighbour mask per tile, kept current by Tilemap::UpdateMasks
+    int filled = 0;                             // non-empty tiles, the chunk is freed when this drops to 0
+    bool dirty = false;                         // written since it was last saved
+    bool stale = true;                          // written since its render cache was baked
+
+    ecs::Tile *Row(int localY) { return tiles.data() + localY * SIZE; }
+    const ecs::Tile *Row(int localY) const { return tiles.data() + localY * SIZE; }
+
+    // tile -> chunk coordinate, floors for negative coordinates too
+    static int ChunkCoord(int tile) { return tile >> SHIFT; }
+    static int LocalCoord(int tile) { return tile & MASK; }
+
+    static uint64_t Key(int cx, int cy)
+    {
+        return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy);
+    }
+    static int KeyX(uint64_t key) { return static_cast<int32_t>(key >> 32); }
+    static int KeyY(uint64_t key) { return static_cast<int32_t>(key & 0xFFFFFFFFu); }
+};
+
+struct TileLayer;
+
+/// @brief backing store of a layer whose chunks aren't all resident, e.g. TileStreamer
+struct ChunkStore
+{
+    virtual ~ChunkStore() = default;
+
+    /// @return true if the chunk isn't resident but the store holds tiles for it
+    virtual bool Stored(uint64_t key) const = 0;
+
+    /// @brief chunk that takes the writes to a stored chunk until it streams in, null if it isn't Stored(). Its
+    /// tiles hold TileRun::UNKNOWN until written; once the stored ones arrive the written tiles are laid over them.
+    virtual TileChunk *Placeholder(uint64_t key) = 0;
+
+    /// @brief forget every stored chunk, called once the resident ones are cleared
+    virtual void EraseStored() = 0;
+};
+
+/// @brief one sparse, unbounded grid of chunks. Chunks are allocated on the first non-empty write and freed once
+/// empty, so memory follows the painted area and coordinates may be negative.
+struct TileLayer
+{
+    using ChunkMap = std::unordered_map<uint64_t, std::unique_ptr<TileChunk>>;
+
+    std::string name;
+    bool visible = true;                           // hidden layers are skipped by Tilemap::Draw
+    ChunkMap chunks;                               // allocated chunks by TileChunk::Key
+    TileRect dirty;                                // tiles written since the last ClearDirty()
+    uint64_t revision = 0;                         // bumped by every write, for caches of the whole layer
+    std::vector<uint64_t> *freedChunks = nullptr;  // when set, FillSpan appends the keys of chunks it frees
+    std::vector<TileRect> *edits = nullptr;        // when set, FillSpan and streamed-in chunks append the tiles they wrote
+    ChunkStore *store = nullptr;                   // when set, FillSpan writes the chunks it holds into their placeholders
+    std::unordered_map<uint64_t, Texture2D> baked; // render cache, one autotile frame per tile, rebuilt for stale chunks
+};
+
+/// @brief stack of layers sharing one tile size and coordinate space. Edits go to the active layer.
 struct Tilemap
 {
-    int tileSize = 32;            // pixels per tile side
-    std::vector<ecs::Tile> tiles; // array of tiles
+    int tileSize = 32;                                         // pixels per tile side
+    std::vector<TileLayer> layers = std::vector<TileLayer>(1); // drawn first to last
+    int activeLayer = 0;                                       // layer written by FillSpan and read by Get
+    std::vector<TileRun> *recording = nullptr;                 // when set, FillSpan appends the runs it actually changes
+    size_t recordingLimit = SIZE_MAX;                          // runs recording may hold, past it FillSpan empties and unsets it
+
+    static TileLayer &Active(Tilemap &tm) { return tm.layers[tm.activeLayer]; }
+    static const TileLayer &Active(const Tilemap &tm) { return tm.layers[tm.activeLayer]; }
+
+    static TileLayer &AddLayer(Tilemap &tm, std::string name)
+    {
+        TileLayer &layer = tm.layers.emplace_back();
+        layer.name = std::move(name);
+        return layer;
+    }
+
+    static const TileChunk *FindChunk(const TileLayer &layer, int cx, int cy)
+    {
+        auto it = layer.chunks.find(TileChunk::Key(cx, cy));
+        return it == layer.chunks.end() ? nullptr : it->second.get();
+    }
+
+    /// @return the active layer's tile value at (x, y), 0 where nothing was painted
+    static int Get(const Tilemap &tm, int x, int y)
+    {
+        const TileChunk *chunk = FindChunk(Active(tm), TileChunk::ChunkCoord(x), TileChunk::ChunkCoord(y));
+        return chunk ? chunk->Row(TileChunk::LocalCoord(y))[TileChunk::LocalCoord(x)].value : 0;
+    }
+
+    /// @brief read access that remembers the last chunk, for scans that mostly stay inside one chunk
+    struct Reader
+    {
+        const TileLayer &layer;
+        uint64_t key = 0;
+        bool cached = false; // every key is a valid chunk, so "nothing cached" needs its own flag
+        const TileChunk *chunk = nullptr;
+
+        int Get(int x, int y)
+        {
+            uint64_t k = TileChunk::Key(TileChunk::ChunkCoord(x), TileChunk::ChunkCoord(y));
+            if (k != key || !cached)
+            {
+                key = k;
+                cached = true;
+                chunk = FindChunk(layer, TileChunk::ChunkCoord(x), TileChunk::ChunkCoord(y));
+            }
+            return chunk ? chunk->Row(TileChunk::LocalCoord(y))[TileChunk::LocalCoord(x)].value : 0;
+        }
+
+        /// @brief forget the cached chunk, call after writes that may allocate or free chunks
+        void Reset() { cached = false; }
+    };
+
+    /// @brief set tiles [x0, x1] of row y on the active layer to value
+    static void FillSpan(Tilemap &tm, int y, int x0, int x1, int value)
+    {
+        FillLayerSpan(tm, tm.activeLayer, y, x0, x1, value);
+    }
+
+    /// @brief the single write primitive: set tiles [x0, x1] of row y on the given layer to value
+    /// @details the run is split at chunk borders and each piece is one std::fill over contiguous memory.
+    /// Writing empty tiles never allocates, and a chunk whose last tile is cleared is freed. A chunk that is only
+    /// in the layer's store is written into its placeholder without waiting for it, so neither a write nor an
+    /// erase is lost when it streams in; the recording gets TileRun::UNKNOWN for the tiles whose old values
+    /// are still in the store.
+    static void FillLayerSpan(Tilemap &tm, int layerIndex, int y, int x0, int x1, int value)
+    {
+        if (x0 > x1)
+            return;
+        TileLayer &layer = tm.layers[layerIndex];
+        const int cy = TileChunk::ChunkCoord(y);
+        const int localY = TileChunk::LocalCoord(y);
+        for (int cx = TileChunk::ChunkCoord(x0); cx <= TileChunk::ChunkCoord(x1); ++cx)
+        {
+            const int base = cx << TileChunk::SHIFT;
+            const int from = std::max(x0, base), to = std::min(x1, base + TileChunk::SIZE - 1);
+            const int count = to - from + 1;
+
+            const uint64_t key = TileChunk::Key(cx, cy);
+            auto it = layer.chunks.find(key);
+            if (it == layer.chunks.end() && layer.store)
+            {
+                if (TileChunk *placeholder = layer.store->Placeholder(key))
+                {
+                    ecs::Tile *segment = placeholder->Row(localY) + (from - base);
+                    Record(tm, segment, layerIndex, y, from, to, value);
+                    std::fill(segment, segment + count, ecs::Tile{value});
+                    continue;
+                }
+            }
+            if (it == layer.chunks.end())
+            {
+                if (value == 0)
+                    continue; // already empty
+                it = layer.chunks.emplace(key, std::make_unique<TileChunk>()).first;
+            }
+            TileChunk &chunk = *it->second;
+            ecs::Tile *segment = chunk.Row(localY) + (from - base);
+
+            Record(tm, segment, layerIndex, y, from, to, value);
+            int wasFilled = 0;
+            for (int i = 0; i < count; ++i)
+                wasFilled += segment[i].value != 0;
+            std::fill(segment, segment + count, ecs::Tile{value});
+            chunk.filled += (value != 0 ? count : 0) - wasFilled;
+            chunk.dirty = chunk.stale = true;
+
+            if (chunk.filled == 0)
+            {
+                layer.chunks.erase(it);
+                if (layer.freedChunks)
+                    layer.freedChunks->push_back(key);
+            }
+        }
+        layer.dirty.Merge({x0, y, x1 + 1, y + 1});
+        if (layer.edits)
+            layer.edits->push_back({x0, y, x1 + 1, y + 1});
+        ++layer.revision;
+        UpdateMasks(layer, {x0 - 1, y - 1, x1 + 2, y + 2}); // the span and the tiles bordering it
+    }
+
+    /// @brief recompute the autotile masks of the tiles in rect. Chunks whose masks change become stale.
+    /// @details cost is proportional to the rect, so an edit only pays for the tiles it touched and their neighbours
+    static void UpdateMasks(TileLayer &layer, const TileRect &rect)
+    {
+        Reader reader{layer};
+        for (int y = rect.y0; y < rect.y1; ++y)
+        {
+            const int cy = TileChunk::ChunkCoord(y), localY = TileChunk::LocalCoord(y);
+            for (int cx = TileChunk::ChunkCoord(rect.x0); cx <= TileChunk::ChunkCoord(rect.x1 - 1); ++cx)
+            {
+                auto it = layer.chunks.find(TileChunk::Key(cx, cy));
+                if (it == layer.chunks.end())
+                    continue; // empty tiles have no mask
+                TileChunk &chunk = *it->second;
+                const int base = cx << TileChunk::SHIFT;
+                const int from = std::max(rect.x0, base), to = std::min(rect.x1 - 1, base + TileChunk::SIZE - 1);
+                for (int x = from; x <= to; ++x)
+                {
+                    const int index = localY * TileChunk::SIZE + (x - base);
+                    const int value = chunk.tiles[index].value;
+                    uint8_t mask = 0;
+                    if (value != 0)
+                    {
+                        mask |= reader.Get(x, y - 1) == value ? Autotile::N : 0;
+                        mask |= reader.Get(x + 1, y - 1) == value ? Autotile::NE : 0;
+                        mask |= reader.Get(x + 1, y) == value ? Autotile::E : 0;
+                        mask |= reader.Get(x + 1, y + 1) == value ? Autotile::SE : 0;
+                        mask |= reader.Get(x, y + 1) == value ? Autotile::S : 0;
+                        mask |= reader.Get(x - 1, y + 1) == value ? Autotile::SW : 0;
+                        mask |= reader.Get(x - 1, y) == value ? Autotile::W : 0;
+                        mask |= reader.Get(x - 1, y - 1) == value ? Autotile::NW : 0;
+                    }
+                    if (chunk.masks[index] != mask)
+                    {
+                        chunk.masks[index] = mask;
+                        chunk.stale = true;
+                    }
+                }
+            }
+        }
+    }
+
+    /// @brief UpdateMasks for a large rect on a job system, one job per row of chunks so no two jobs write the same chunk
+    static void UpdateMasks(TileLayer &layer, const TileRect &rect, JobSystem &jobs)
+    {
+        if (rect.Empty())
+            return;
+        const int firstRow = TileChunk::ChunkCoord(rect.y0);
+        const size_t rows = static_cast<size_t>(TileChunk::ChunkCoord(rect.y1 - 1) - firstRow + 1);
+        jobs.ParallelFor(rows, [&](size_t row)
+                         {
+            const int y = (firstRow + static_cast<int>(row)) << TileChunk::SHIFT;
+            UpdateMasks(layer, {rect.x0, std::max(rect.y0, y), rect.x1, std::min(rect.y1, y + TileChunk::SIZE)}); });
+    }
+
+    /// @brief erase every tile of one layer, through FillSpan so an open recording sees the change
+    /// @details chunks that are only in the layer's store are erased there without being loaded, so a recording
+    /// covers the resident tiles alone and can't undo the whole clear
+    static void ClearLayer(Tilemap &tm, int layerIndex)
+    {
+        TileLayer &layer = tm.layers[layerIndex];
+        std::vector<uint64_t> keys = SortedKeys(layer);
+        for (uint64_t key : keys)
+        {
+            int x = TileChunk::KeyX(key) << TileChunk::SHIFT, y = TileChunk::KeyY(key) << TileChunk::SHIFT;
+            for (int row = 0; row < TileChunk::SIZE; ++row)
+                FillLayerSpan(tm, layerIndex, y + row, x, x + TileChunk::SIZE - 1, 0);
+        }
+        if (layer.store)
+            layer.store->EraseStored();
+    }
+
+    /// @brief erase every tile of every layer
+    static void Clear(Tilemap &tm)
+    {
+        for (int layer = 0; layer < static_cast<int>(tm.layers.size()); ++layer)
+            ClearLayer(tm, layer);
+    }
+
+    static void ClearDirty(TileLayer &layer) { layer.dirty = {}; }
+
+    /// @brief RecordSpan into tm's recording if one is open, dropping it once it outgrows recordingLimit
+    static void Record(Tilemap &tm, const ecs::Tile *segment, int layer, int y, int x0, int x1, int value)
+    {
+        if (!tm.recording)
+            return;
+        RecordSpan(*tm.recording, segment, layer, y, x0, x1, value);
+        if (tm.recording->size() > tm.recordingLimit)
+        {
+            tm.recording->clear(); // too large to keep, the recorder finds it unset
+            tm.recording = nullptr;
+        }
+    }
+
+    /// @brief append the tiles of segment (covering x0..x1) that differ from value, one run per stretch of equal old values
+    static void RecordSpan(std::vector<TileRun> &runs, const ecs::Tile *segment, int layer, int y, int x0, int x1, int value)
+    {
+        for (int x = x0; x <= x1; ++x)
+        {
+            int old = segment[x - x0].value;
+            if (old == value)
+                continue; // unchanged tiles cost nothing, so re-stamping the same spot records nothing
+            TileRun *last = runs.empty() ? nullptr : &runs.back();
+            if (last && last->layer == layer && last->y == y && last->x + last->count == x && last->oldValue == old && last->newValue == value)
+                ++last->count;
+            else
+                runs.push_back({x, y, 1, old, value, layer});
+        }
+    }
+
+    /// @brief chunk keys in a stable order, so output doesn't depend on hash map iteration
+    static std::vector<uint64_t> SortedKeys(const TileLayer &layer)
+    {
+        std::vector<uint64_t> keys;
+        SortedKeys(layer, keys);
+        return keys;
+    }
+
+    /// @brief SortedKeys into a caller's vector, e.g. a FrameVector
+    template <typename Keys>
+    static void SortedKeys(const TileLayer &layer, Keys &keys)
+    {
+        keys.clear();
+        keys.reserve(layer.chunks.size());
+        for (const auto &[key, chunk] : layer.chunks)
+            keys.push_back(key);
+        std::sort(keys.begin(), keys.end());
+    }
 
     static std::string Serialize(const Tilemap &tm)
     {
         std::string result;
-        result += std::format("tilemap\n tileSize {}\n", tm.tileSize);
-        for (size_t i = 0; i < tm.tiles.size(); ++i)
+        Serialize(tm, result);
+        return result;
+    }
+
+    /// @brief append the text form of tm to out; temporaries use out's allocator, so a FrameString keeps it off the heap
+    template <typename String>
+    static void Serialize(const Tilemap &tm, String &out)
+    {
+        using KeyAllocator = typename std::allocator_traits<typename String::allocator_type>::template rebind_alloc<uint64_t>;
+        std::vector<uint64_t, KeyAllocator> keys(KeyAllocator(out.get_allocator()));
+        auto append = std::back_inserter(out);
+        std::format_to(append, "tilemap\n tileSize {}\n chunkSize {}\n", tm.tileSize, TileChunk::SIZE);
+        for (const TileLayer &layer : tm.layers)
         {
-            const auto &tile = tm.tiles[i];
-            if (i % static_cast<size_t>(tm.tileSize) == 0 && i != 0)
+            std::format_to(append, "layer {}\n", layer.name);
+            SortedKeys(layer, keys);
+            for (uint64_t key : keys)
             {
-                result += "\n"; // New line for every row
+                const TileChunk &chunk = *layer.chunks.at(key);
+                std::format_to(append, "chunk {} {}\n", TileChunk::KeyX(key), TileChunk::KeyY(key));
+                for (int y = 0; y < TileChunk::SIZE; ++y)
+                {
+                    const ecs::Tile *row = chunk.Row(y);
+                    for (int x = 0; x < TileChunk::SIZE; ++x)
+                        std::format_to(append, "{} ", row[x].value);
+                    out += '\n'; // New line for every row
+                }
             }
-            result += std::to_string(tile.value) + " ";
         }
-        return result;
     }
 
-    static void Draw(const Tilemap &tm, int screenWidth, int screenHeight)
+    /// @brief FNV-1a hash of the tile size and the contents of every layer, used to verify replayed sessions
+    static uint64_t Hash(const Tilemap &tm)
+    {
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](uint64_t value, int bytes)
+        {
+            for (int i = 0; i < bytes; ++i)
+                hash = (hash ^ ((value >> (i * 8)) & 0xFFu)) * 1099511628211ull;
+        };
+        mix(static_cast<uint32_t>(tm.tileSize), 4);
+        for (const TileLayer &layer : tm.layers)
+        {
+            mix(layer.chunks.size(), 8); // separates the layers
+            for (uint64_t key : SortedKeys(layer))
+            {
+                mix(key, 8);
+                for (const ecs::Tile &tile : layer.chunks.at(key)->tiles)
+                    mix(static_cast<uint32_t>(tile.value), 4);
+            }
+        }
+        return hash;
+    }
+
+    /// @brief tiles touched by the screen area [0, screenWidth) x [0, screenHeight) when its top-left corner shows world pixel camera
+    static TileRect VisibleTiles(const Tilemap &tm, Vector2 camera, int screenWidth, int screenHeight)
+    {
+        const float ts = static_cast<float>(tm.tileSize);
+        return {static_cast<int>(std::floor(camera.x / ts)), static_cast<int>(std::floor(camera.y / ts)),
+                static_cast<int>(std::ceil((camera.x + screenWidth) / ts)), static_cast<int>(std::ceil((camera.y + screenHeight) / ts))};
+    }
+
+    /// @brief draw the visible layers in order. camera is the world pixel shown at the top-left corner.
+    static void Draw(Tilemap &tm, Vector2 camera, int screenWidth, int screenHeight)
+    {
+        const TileRect view = VisibleTiles(tm, camera, screenWidth, screenHeight);
+        for (TileLayer &layer : tm.layers)
+        {
+            if (layer.visible)
+                DrawLayer(layer, tm.tileSize, view, camera, &Tilemap::DrawBaked);
+        }
+    }
+
+    /// @brief Draw() through a render backend, which gets one Chunk(layer, key, chunk, dest) call per chunk in view
+    template <typename Backend>
+    static void Draw(Tilemap &tm, Vector2 camera, int screenWidth, int screenHeight, Backend &backend)
     {
-        int tilesPerRow = screenWidth / tm.tileSize;
-        const auto &tiles = tm.tiles;
-        const size_t tileCount = tiles.size();
-        if (tileCount == 0)
+        const TileRect view = VisibleTiles(tm, camera, screenWidth, screenHeight);
+        for (TileLayer &layer : tm.layers)
         {
-            std::cout << "No tiles to draw." << std::endl;
-            return; // No tiles to draw
+            if (layer.visible)
+                DrawLayer(layer, tm.tileSize, view, camera, [&backend](TileLayer &drawn, uint64_t key, TileChunk &chunk, Rectangle dest)
+                          { backend.Chunk(drawn, key, chunk, dest); });
+        }
+    }
+
+    /// @brief drawChunk(layer, key, chunk, dest) for every chunk in view, dest being its screen rectangle
+    template <typename DrawChunk>
+    static void DrawLayer(TileLayer &layer, int tileSize, const TileRect &view, Vector2 camera, DrawChunk &&drawChunk)
+    {
+        const float chunkPixels = static_cast<float>(TileChunk::SIZE * tileSize);
+        const float originX = std::floor(camera.x), originY = std::floor(camera.y);
+        const int cx0 = TileChunk::ChunkCoord(view.x0), cx1 = TileChunk::ChunkCoord(view.x1 - 1);
+        const int cy0 = TileChunk::ChunkCoord(view.y0), cy1 = TileChunk::ChunkCoord(view.y1 - 1);
+
+        for (int cy = cy0; cy <= cy1; ++cy)
+        {
+            for (int cx = cx0; cx <= cx1; ++cx)
+            {
+                const uint64_t key = TileChunk::Key(cx, cy);
+                auto chunk = layer.chunks.find(key);
+                if (chunk == layer.chunks.end())
+                {
+                    if (!layer.baked.empty())
+                        ReleaseBaked(layer, key); // freed or evicted since it was drawn
+                    continue; // empty space costs one lookup per chunk
+                }
+
+                Rectangle dest = {static_cast<float>(cx) * chunkPixels - originX, static_cast<float>(cy) * chunkPixels - originY, chunkPixels, chunkPixels};
+                drawChunk(layer, key, *chunk->second, dest);
+            }
         }
-        for (size_t i = 0; i < tileCount; ++i)
+
+        // drop textures of chunks that scrolled out of view, once there are noticeably more than are on screen
+        const size_t onScreen = static_cast<size_t>((cx1 - cx0 + 1) * (cy1 - cy0 + 1));
+        if (layer.baked.size() > 2 * onScreen + 16)
         {
-            const ecs::Tile &tile = tiles[i];
-            if (tile.value > 0)
+            for (auto it = layer.baked.begin(); it != layer.baked.end();)
             {
-                int x = static_cast<int>(i % static_cast<size_t>(tilesPerRow));
-                int y = static_cast<int>(i / static_cast<size_t>(tilesPerRow));
-                int wh = tm.tileSize;
-                if (static_cast<size_t>(tile.value) < sizeof(TILE_COLORS) / sizeof(TILE_COLORS[0]))
+                const int cx = TileChunk::KeyX(it->first), cy = TileChunk::KeyY(it->first);
+                if (cx < cx0 || cx > cx1 || cy < cy0 || cy > cy1)
                 {
-                    DrawRectangle(x * wh, y * wh, wh, wh, TILE_COLORS[tile.value]); // Use color based on tile value
+                    UnloadTexture(it->second);
+                    it = layer.baked.erase(it);
                 }
                 else
+                    ++it;
+            }
+        }
+    }
+
+    /// @brief unload every cached texture, call while the window is still open
+    static void ReleaseCache(Tilemap &tm)
+    {
+        for (TileLayer &layer : tm.layers)
+        {
+            for (auto &[key, texture] : layer.baked)
+                UnloadTexture(texture);
+            layer.baked.clear();
+        }
+    }
+
+    static constexpr int BAKED_SIZE = TileChunk::SIZE * Autotile::TEXELS; // baked texture side in texels
+
+    /// @brief one textured quad for the chunk, re-baked first if its tiles or masks changed
+    static void DrawBaked(TileLayer &layer, uint64_t key, TileChunk &chunk, Rectangle dest)
+    {
+        Texture2D &texture = Bake(layer, key, chunk);
+        DrawTexturePro(texture, {0, 0, (float)BAKED_SIZE, (float)BAKED_SIZE}, dest, {0, 0}, 0.0f, WHITE);
+    }
+
+    /// @brief the chunk's autotiled texels, BAKED_SIZE x BAKED_SIZE row by row; empty tiles are BLANK
+    static void ShadeChunk(const TileChunk &chunk, Color *pixels)
+    {
+        constexpr size_t colorCount = sizeof(TILE_COLORS) / sizeof(TILE_COLORS[0]);
+        for (int ty = 0; ty < TileChunk::SIZE; ++ty)
+        {
+            for (int tx = 0; tx < TileChunk::SIZE; ++tx)
+            {
+                const int index = ty * TileChunk::SIZE + tx;
+                const int value = chunk.tiles[index].value;
+                Color *texel = pixels + (ty * BAKED_SIZE + tx) * Autotile::TEXELS;
+                if (value <= 0)
                 {
-                    DrawRectangle(x * wh, y * wh, wh, wh, BLACK); // Fallback color if value is out of range
+                    for (int y = 0; y < Autotile::TEXELS; ++y)
+                        std::fill_n(texel + y * BAKED_SIZE, Autotile::TEXELS, BLANK); // empty tiles show the layers below
+                    continue;
+                }
+
+                const Color color = static_cast<size_t>(value) < colorCount ? TILE_COLORS[value] : BLACK; // Fallback color if value is out of range
+                const auto &shades = Autotile::FRAME_SHADES[Autotile::FRAME_OF_MASK[chunk.masks[index]]];
+                for (int y = 0; y < Autotile::TEXELS; ++y)
+                {
+                    for (int x = 0; x < Autotile::TEXELS; ++x)
+                    {
+                        const int shade = shades[y * Autotile::TEXELS + x];
+                        texel[y * BAKED_SIZE + x] = {static_cast<unsigned char>(color.r * shade / 255), static_cast<unsigned char>(color.g * shade / 255),
+                                                     static_cast<unsigned char>(color.b * shade / 255), color.a};
+                    }
                 }
             }
         }
     }
+
+private:
+    /// @return the chunk's cached texture, drawing its tiles into it first if they changed
+    static Texture2D &Bake(TileLayer &layer, uint64_t key, TileChunk &chunk)
+    {
+        auto [it, created] = layer.baked.try_emplace(key);
+        if (!created && !chunk.stale)
+            return it->second;
+
+        static std::array<Color, BAKED_SIZE * BAKED_SIZE> pixels;
+        ShadeChunk(chunk, pixels.data());
+        if (created)
+        {
+            Image image = {pixels.data(), BAKED_SIZE, BAKED_SIZE, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+            it->second = LoadTextureFromImage(image);
+        }
+        else
+            UpdateTexture(it->second, pixels.data());
+        chunk.stale = false;
+        return it->second;
+    }
+
+    static void ReleaseBaked(TileLayer &layer, uint64_t key)
+    {
+        auto it = layer.baked.find(key);
+        if (it == layer.baked.end())
+            return;
+        UnloadTexture(it->second);
+        layer.baked.erase(it);
+    }
 };
@@ -0,0 +1,56 @@
+/**
+ * @file TripleBuffer.h
+ * @brief Lock-free hand-over of the latest value from one writer thread to one reader thread.
+ * @date 2025-08-03
+ * @details Three copies of T: the writer fills Back() and Publish()es it, the reader Acquire()s the newest
+ * published copy and reads Front() until it acquires again. Publish swaps the back copy with the middle one
+ * and Acquire swaps the front copy with it, so neither side ever waits for the other and the reader never sees
+ * a copy that is being written. Values the reader didn't pick up in time are overwritten, it always gets the
+ * latest. Back() holds an older value after a publish, the writer has to rewrite it completely.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer &) = delete;
+    TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+    /// @brief writer: the copy to fill next
+    T &Back() { return m_buffers[m_back]; }
+
+    /// @brief writer: hand Back() to the reader
+    void Publish()
+    {
+        m_back = m_middle.exchange(static_cast<uint8_t>(m_back | FRESH), std::memory_order_acq_rel) & INDEX;
+    }
+
+    /// @brief reader: switch Front() to the newest published copy
+    /// @return false if nothing was published since the last call, Front() stays as it was
+    bool Acquire()
+    {
+        if (!(m_middle.load(std::memory_order_relaxed) & FRESH))
+            return false;
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    /// @brief reader: the copy acquired last
+    const T &Front() const { return m_buffers[m_front]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;
+    static constexpr uint8_t FRESH = 0x4; // set on the middle index by Publish, cleared by Acquire
+
+    std::array<T, 3> m_buffers{};
+    uint8_t m_back = 0;               // writer only
+    std::atomic<uint8_t> m_middle{1}; // swapped by both
+    uint8_t m_front = 2;              // reader only
+};
@@ -1,27 +1,127 @@
 #include <iostream> // for printouts
+#include <cstring>
+#include <string>
 
+#define ALLOC_TRACKER_IMPLEMENTATION // the global operator new/delete replacements live here (TRACK_ALLOCATIONS builds)
+#include "AllocTracker.h"
 #include "Components.h"
 #include "Simulation.h"
 #include "Maths.h"
+#include "Input.h"
 #include "Sandbox.h"
+#include "Benchmark.h"
+#include "AssetArchive.h"
+#include "Log.h"
+
+#ifdef RUN_GRAVITY_GAME
+#include "GravityGame.h"
+#endif
 
 static constexpr int SCREEN_WIDTH = 800;  // Default screen width
 static constexpr int SCREEN_HEIGHT = 600; // Default screen height
 static constexpr const char *TITLE = "Gravity Game"; // Default window title
 static constexpr unsigned FLAGS = FLAG_WINDOW_HIGHDPI;
+static constexpr int TARGET_FPS = 60;
+static constexpr const char *ASSET_ARCHIVE = "assets.pak"; // mounted at startup when it exists
 
-int main()
+// command line options:
+//   --record <file>   record this session's input
+//   --replay <file>   play back a recorded session and verify its final state
+//   --headless        hidden window and no frame cap, for running replays as benchmarks
+//   --gravity         run the gravity game instead of the sandbox (needs RUN_GRAVITY_GAME)
+//   --threaded        step the simulation on its own thread and only draw on the main one, if it supports that
+//   --bench [filter]  run the console benchmarks (those whose name contains filter) and exit
+//   --check [filter]  run the benchmarks' correctness checks only, each workload once and without timings, and exit
+//   --update-golden   with --bench or --check, record the golden images instead of comparing frames with them
+//   --pack <dir> <file> [--decode]  pack the files under dir into an asset archive and exit; --decode stores images as pixels
+struct RunOptions
 {
-    Sandbox sandbox(SCREEN_WIDTH, SCREEN_HEIGHT, TITLE, FLAGS);
-    sandbox.Run(); 
+    std::string recordPath;
+    std::string replayPath;
+    bool headless = false;
+    bool gravity = false;
+    bool threaded = false;
+    bool bench = false;
+    bool checkOnly = false;
+    std::string benchFilter;
+    bool updateGolden = false;
+    std::string packDirectory;
+    std::string packArchive;
+    bool packDecoded = false;
+};
+
+static RunOptions ParseRunOptions(int argc, char **argv)
+{
+    RunOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+            options.recordPath = argv[++i];
+        else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+            options.replayPath = argv[++i];
+        else if (std::strcmp(argv[i], "--headless") == 0)
+            options.headless = true;
+        else if (std::strcmp(argv[i], "--gravity") == 0)
+            options.gravity = true;
+        else if (std::strcmp(argv[i], "--threaded") == 0)
+            options.threaded = true;
+        else if (std::strcmp(argv[i], "--bench") == 0 || std::strcmp(argv[i], "--check") == 0)
+        {
+            options.bench = true;
+            options.checkOnly = std::strcmp(argv[i], "--check") == 0;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                options.benchFilter = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--update-golden") == 0)
+            options.updateGolden = true;
+        else if (std::strcmp(argv[i], "--pack") == 0 && i + 2 < argc)
+        {
+            options.packDirectory = argv[++i];
+            options.packArchive = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--decode") == 0)
+            options.packDecoded = true;
+        else
+            Log::Warn("Unknown argument: {}", argv[i]);
+    }
+    return options;
 }
 
+template <typename TSimulation>
+static int RunSimulation(const RunOptions &options)
+{
+    unsigned flags = options.headless ? (FLAGS | FLAG_WINDOW_HIDDEN) : FLAGS;
+    int fps = options.headless ? 0 : TARGET_FPS; // replays carry their own frame times, so run flat out
+
+    TSimulation simulation(SCREEN_WIDTH, SCREEN_HEIGHT, TITLE, flags, fps);
+    if (!options.replayPath.empty() && !Input::StartPlayback(options.replayPath))
+        return EXIT_FAILURE;
+    if (!options.recordPath.empty() && !Input::StartRecording(options.recordPath))
+        return EXIT_FAILURE;
 
-#ifdef RUN_GRAVITY_GAME
-#include "GravityGame.h"
-void RunGravityGame()
+    if (options.threaded && simulation.SupportsThreadedRun() && options.replayPath.empty())
+        simulation.RunThreaded();
+    else
+    {
+        if (options.threaded)
+            Log::Warn("--threaded needs a simulation that publishes snapshots and a live session, running single-threaded");
+        simulation.Run();
+    }
+    return simulation.ReplayMatched() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv)
 {
-    GravityGame game(SCREEN_WIDTH, SCREEN_HEIGHT, TITLE);
-    game.Run();
+    RunOptions options = ParseRunOptions(argc, argv);
+    if (options.bench)
+        return RunBenchmarks(options.benchFilter, options.updateGolden, options.checkOnly) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!options.packArchive.empty())
+        return AssetArchive::Pack(options.packDirectory, options.packArchive, options.packDecoded) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (std::filesystem::exists(ASSET_ARCHIVE))
+        AssetArchive::Mounted().Open(ASSET_ARCHIVE);
+#ifdef RUN_GRAVITY_GAME
+    if (options.gravity)
+        return RunSimulation<GravityGame>(options);
+#endif
+    return RunSimulation<Sandbox>(options);
 }
-#endif
\ No newline at end of file